@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "LogHandler.h"
+#include "LogHandlerConfig.h"
+#include "LogLevel.h"
+#include "LogMessage.h"
+#include "LogOverflow.h"
+
+namespace tinylog
+{
+    class LogFormatter;
+    class LogWriter;
+
+    /**
+     * AsyncMergingLogHandler is an asynchronous LogHandler designed for many
+     * concurrently logging threads.
+     *
+     * Unlike AsyncRingLogHandler, logging threads never share a queue: each
+     * thread lazily gets its own single-producer/single-consumer buffer the
+     * first time it logs to this handler, so handleMessage() touches no cache
+     * lines written by other logging threads.
+     *
+     * A single I/O thread drains all of the per-thread buffers and performs a
+     * k-way merge on LogMessage::getTimestamp(), so the output stays in global
+     * timestamp order.  The merge works on the messages available at the start
+     * of each drain round: a thread that was descheduled between taking its
+     * timestamp and publishing the message may still see that message written
+     * in the following round.
+     *
+     * Buffers belonging to threads that have exited are released once the I/O
+     * thread has drained them.  An exiting thread wakes the I/O thread, so
+     * this also happens when nothing else is being logged.
+     *
+     * When a thread's buffer is full the handler's LogOverflowPolicy decides
+     * whether the thread waits or the message is dropped.  Dropped messages are
+     * counted per level, and after the next drain round the I/O thread writes a
+     * "N log messages dropped" line to the LogWriter to mark the gap.
+     * LogOverflowPolicy::DROP_OLDEST is not supported: only the I/O thread may
+     * remove messages from a single-producer/single-consumer buffer.
+     */
+    class AsyncMergingLogHandler : public LogHandler
+    {
+    public:
+        static constexpr size_t kDefaultBufferCapacity = 1024;
+
+        /**
+         * Create an AsyncMergingLogHandler.
+         *
+         * bufferCapacity is the number of messages each per-thread buffer can
+         * hold, and is rounded up to the next power of two.
+         */
+        AsyncMergingLogHandler(
+            std::shared_ptr<LogFormatter> formatter,
+            std::shared_ptr<LogWriter> writer,
+            size_t bufferCapacity = kDefaultBufferCapacity);
+
+        /**
+         * Destroying the handler processes all messages still queued and then
+         * stops the I/O thread.
+         */
+        ~AsyncMergingLogHandler() override;
+
+        /**
+         * Get the handler's current LogLevel.
+         *
+         * Messages less than this LogLevel will be ignored.  This defaults to
+         * LogLevel::NONE when the handler is constructed.
+         */
+        LogLevel getLevel() const
+        {
+            return level_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * Set the handler's current LogLevel.
+         *
+         * Messages less than this LogLevel will be ignored.
+         */
+        void setLevel(LogLevel level)
+        {
+            return level_.store(level, std::memory_order_release);
+        }
+
+        /**
+         * Get/set what handleMessage() does when the thread's buffer is full.
+         *
+         * Throws std::invalid_argument for LogOverflowPolicy::DROP_OLDEST.
+         */
+        LogOverflowPolicy getOverflowPolicy() const
+        {
+            return overflowPolicy_.load(std::memory_order_relaxed);
+        }
+        void setOverflowPolicy(LogOverflowPolicy policy);
+
+        /**
+         * Get/set the level used by LogOverflowPolicy::DROP_BELOW_LEVEL.
+         *
+         * Messages at or above this level are never dropped.  This defaults to
+         * LogLevel::ERROR.
+         */
+        LogLevel getDropThreshold() const
+        {
+            return dropThreshold_.load(std::memory_order_relaxed);
+        }
+        void setDropThreshold(LogLevel level)
+        {
+            dropThreshold_.store(level, std::memory_order_relaxed);
+        }
+
+        /**
+         * Get the counters of messages dropped because a buffer was full.
+         */
+        const LogDropCounters &getDropCounters() const { return dropCounters_; }
+
+        /**
+         * Get the number of messages each per-thread buffer can hold.
+         */
+        size_t getBufferCapacity() const { return bufferCapacity_; }
+
+        /**
+         * Get the number of per-thread buffers currently owned by the handler.
+         *
+         * This is primarily intended for tests.
+         */
+        size_t getNumBuffers() const;
+
+        void handleMessage(
+            const LogMessage &message, const LogCategory *handlerCategory) override;
+
+        bool keepsMessages() const override { return true; }
+
+        void handleSharedMessage(
+            const SharedLogMessage &message,
+            const LogCategory *handlerCategory) override;
+
+        /**
+         * Block until every message enqueued before flush() was called has been
+         * formatted and written, then flush the LogWriter.
+         */
+        void flush() override;
+
+        LogHandlerConfig getConfig() const override;
+
+    private:
+        class ThreadBuffer;
+        struct ThreadBufferCache;
+
+        // Forbidden copy constructor and assignment operator
+        AsyncMergingLogHandler(AsyncMergingLogHandler const &) = delete;
+        AsyncMergingLogHandler &operator=(AsyncMergingLogHandler const &) = delete;
+
+        void enqueue(
+            const LogMessage &message,
+            const SharedLogMessage *shared,
+            const LogCategory *handlerCategory);
+        ThreadBuffer &getThreadBuffer();
+        bool hasPendingWork() const;
+        void wakeConsumer();
+        void waitForSpace(ThreadBuffer &buffer);
+        void ioThread();
+        bool drainRound(std::vector<std::shared_ptr<ThreadBuffer>> &buffers);
+        void writeDropSummary();
+
+        /**
+         * A process-unique ID for this handler.
+         *
+         * Thread-local buffer lookups are keyed on this rather than on the
+         * handler address, since a new handler may later reuse the address of
+         * one that has been destroyed.
+         */
+        uint64_t const id_;
+
+        std::atomic<LogLevel> level_{LogLevel::NONE};
+        std::atomic<LogOverflowPolicy> overflowPolicy_{LogOverflowPolicy::BLOCK};
+        std::atomic<LogLevel> dropThreshold_{LogLevel::ERROR};
+        LogDropCounters dropCounters_;
+
+        std::shared_ptr<LogFormatter> const formatter_;
+        std::shared_ptr<LogWriter> const writer_;
+        size_t const bufferCapacity_;
+
+        /**
+         * All buffers that have not been reclaimed yet.
+         *
+         * This is only modified when a thread logs to this handler for the first
+         * time, and when the I/O thread reclaims the buffer of an exited thread.
+         */
+        mutable std::mutex buffersMutex_;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+        std::atomic<uint64_t> buffersVersion_{0};
+
+        /**
+         * Wakeup state.  The mutex and condition variables are only touched when
+         * a thread actually needs to sleep: the consumer when every buffer is
+         * empty, producers when their buffer is full, and flush() callers.
+         */
+        std::mutex mutex_;
+        std::condition_variable consumerCV_;
+        std::condition_variable producerCV_;
+        std::condition_variable flushCV_;
+        std::atomic<bool> consumerWaiting_{false};
+        std::atomic<uint32_t> producersWaiting_{0};
+        std::atomic<uint32_t> flushWaiters_{0};
+        bool stop_{false};
+
+        std::thread ioThread_;
+    };
+
+} // namespace tinylog
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#include "LogHandler.h"
+#include "LogHandlerConfig.h"
+#include "LogLevel.h"
+#include "LogMessage.h"
+#include "LogOverflow.h"
+
+namespace tinylog
+{
+    class LogFormatter;
+    class LogWriter;
+
+    /**
+     * AsyncRingLogHandler is a LogHandler that moves all formatting and I/O off
+     * of the thread that logged the message.
+     *
+     * handleMessage() only puts a reference-counted copy of the LogMessage
+     * into a bounded, lock-free multi-producer ring buffer.  Messages that
+     * arrive through LogCategory::admitMessage() come with a copy that is
+     * shared with any other handlers keeping the message, so they are not
+     * copied again.  A dedicated I/O thread drains the ring in
+     * FIFO order, formats each message with the LogFormatter and hands the
+     * result to the LogWriter.
+     *
+     * What happens when the ring is full is controlled by the handler's
+     * LogOverflowPolicy.  The default, LogOverflowPolicy::BLOCK, waits for the
+     * I/O thread to free up a slot, so no messages are ever lost.  The other
+     * policies trade completeness for bounded latency; dropped messages are
+     * counted per level, and once the ring has drained back below half full
+     * the I/O thread writes a "N log messages dropped" line to the LogWriter
+     * to mark the gap.
+     */
+    class AsyncRingLogHandler : public LogHandler
+    {
+    public:
+        static constexpr size_t kDefaultCapacity = 4096;
+
+        /**
+         * Create an AsyncRingLogHandler.
+         *
+         * The capacity is rounded up to the next power of two.
+         */
+        AsyncRingLogHandler(
+            std::shared_ptr<LogFormatter> formatter,
+            std::shared_ptr<LogWriter> writer,
+            size_t capacity = kDefaultCapacity);
+
+        /**
+         * Destroying the handler processes all messages still queued and then
+         * stops the I/O thread.
+         */
+        ~AsyncRingLogHandler() override;
+
+        /**
+         * Get the handler's current LogLevel.
+         *
+         * Messages less than this LogLevel will be ignored.  This defaults to
+         * LogLevel::NONE when the handler is constructed.
+         */
+        LogLevel getLevel() const
+        {
+            return level_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * Set the handler's current LogLevel.
+         *
+         * Messages less than this LogLevel will be ignored.
+         */
+        void setLevel(LogLevel level)
+        {
+            return level_.store(level, std::memory_order_release);
+        }
+
+        /**
+         * Get/set what handleMessage() does when the ring is full.
+         */
+        LogOverflowPolicy getOverflowPolicy() const
+        {
+            return overflowPolicy_.load(std::memory_order_relaxed);
+        }
+        void setOverflowPolicy(LogOverflowPolicy policy)
+        {
+            overflowPolicy_.store(policy, std::memory_order_relaxed);
+        }
+
+        /**
+         * Get/set the level used by LogOverflowPolicy::DROP_BELOW_LEVEL.
+         *
+         * Messages at or above this level are never dropped.  This defaults to
+         * LogLevel::ERROR.
+         */
+        LogLevel getDropThreshold() const
+        {
+            return dropThreshold_.load(std::memory_order_relaxed);
+        }
+        void setDropThreshold(LogLevel level)
+        {
+            dropThreshold_.store(level, std::memory_order_relaxed);
+        }
+
+        /**
+         * Get the counters of messages dropped because the ring was full.
+         */
+        const LogDropCounters &getDropCounters() const { return dropCounters_; }
+
+        /**
+         * Get the number of messages the ring can hold.
+         */
+        size_t getCapacity() const { return capacity_; }
+
+        void handleMessage(
+            const LogMessage &message, const LogCategory *handlerCategory) override;
+
+        bool keepsMessages() const override { return true; }
+
+        void handleSharedMessage(
+            const SharedLogMessage &message,
+            const LogCategory *handlerCategory) override;
+
+        /**
+         * Block until every message enqueued before flush() was called has been
+         * formatted and written, then flush the LogWriter.
+         */
+        void flush() override;
+
+        LogHandlerConfig getConfig() const override;
+
+    private:
+        /**
+         * A ring slot.
+         *
+         * The sequence number implements the bounded queue algorithm from
+         * Dmitry Vyukov: a slot at position pos is free for the producer when
+         * sequence == pos, and holds a message ready for the consumer when
+         * sequence == pos + 1.  Releasing a slot advances its sequence by the
+         * ring capacity so it becomes free for the next lap.
+         */
+        struct Slot
+        {
+            std::atomic<uint64_t> sequence{0};
+            const LogCategory *handlerCategory{nullptr};
+            /**
+             * The queued message, or null if it could not be copied.
+             */
+            SharedLogMessage message;
+        };
+
+        // Forbidden copy constructor and assignment operator
+        AsyncRingLogHandler(AsyncRingLogHandler const &) = delete;
+        AsyncRingLogHandler &operator=(AsyncRingLogHandler const &) = delete;
+
+        void enqueue(
+            const LogMessage &message,
+            const SharedLogMessage *shared,
+            const LogCategory *handlerCategory);
+        bool tryEnqueue(
+            const LogMessage &message,
+            const SharedLogMessage *shared,
+            const LogCategory *handlerCategory);
+        bool tryEvictOldest();
+        bool hasPendingMessage() const;
+        void wakeConsumer();
+        void waitForSpace();
+        void ioThread();
+        void notifyWaiters();
+        void processSlot(Slot &slot, uint64_t pos);
+        void releaseSlot(Slot &slot, uint64_t pos);
+        void writeDropSummary();
+
+        std::atomic<LogLevel> level_{LogLevel::NONE};
+        std::atomic<LogOverflowPolicy> overflowPolicy_{LogOverflowPolicy::BLOCK};
+        std::atomic<LogLevel> dropThreshold_{LogLevel::ERROR};
+        LogDropCounters dropCounters_;
+
+        std::shared_ptr<LogFormatter> const formatter_;
+        std::shared_ptr<LogWriter> const writer_;
+
+        size_t const capacity_;
+        uint64_t const mask_;
+        std::unique_ptr<Slot[]> const slots_;
+
+        /**
+         * The producer and consumer positions live on separate cache lines so
+         * that logging threads do not contend with the I/O thread.
+         */
+        alignas(64) std::atomic<uint64_t> enqueuePos_{0};
+        alignas(64) std::atomic<uint64_t> dequeuePos_{0};
+
+        /**
+         * The position the I/O thread is currently writing, or kIdle.
+         *
+         * With LogOverflowPolicy::DROP_OLDEST logging threads also claim
+         * positions from dequeuePos_, so dequeuePos_ alone does not tell
+         * flush() whether the I/O thread has finished writing a message.
+         */
+        static constexpr uint64_t kIdle = ~uint64_t(0);
+        std::atomic<uint64_t> consumerPos_{kIdle};
+
+        /**
+         * Wakeup state.  The mutex and condition variables are only touched when
+         * a thread actually needs to sleep: the consumer when the ring is empty,
+         * producers when it is full, and flush() callers.
+         */
+        std::mutex mutex_;
+        std::condition_variable consumerCV_;
+        std::condition_variable producerCV_;
+        std::condition_variable flushCV_;
+        std::atomic<bool> consumerWaiting_{false};
+        std::atomic<uint32_t> producersWaiting_{0};
+        std::atomic<uint32_t> flushWaiters_{0};
+        bool stop_{false};
+
+        std::thread ioThread_;
+    };
+
+} // namespace tinylog
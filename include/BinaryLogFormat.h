@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "LogCallsite.h"
+#include "LogFormatter.h"
+#include "LogLevel.h"
+#include "StringPiece.h"
+
+namespace tinylog
+{
+    /**
+     * The binary log format is a compact encoding of log records, rendered as
+     * text only when the log is read.
+     *
+     * It saves the work of building the per-message header on the logging
+     * path: the category name, level, file, line and function are written
+     * once per callsite, and the timestamp is not rendered as text.  The
+     * message itself is the text LogMessage already holds, rendered when the
+     * message was created; format arguments are not captured separately.
+     *
+     * A stream starts with the 8 byte magic value kBinaryLogMagic, followed by a
+     * sequence of records.  Each record starts with a one byte record type.
+     * Integers are encoded as unsigned LEB128 varints, and strings as a varint
+     * length followed by the raw bytes.
+     *
+     *   CALLSITE record: id, level, line, category name, file name, function name
+     *   MESSAGE record:  callsite id, timestamp (nanoseconds since the epoch),
+     *                    thread ID, context string, message bytes
+     *
+     * A callsite is the static information shared by every message logged from
+     * the same log statement (see LogCallsite).  Later messages only refer to
+     * it by its LogCallsite ID.
+     *
+     * Each thread that formats messages keeps its own record of what it has
+     * written.  Its first message starts with the magic value, and its first
+     * message from each callsite is preceded by that callsite's CALLSITE
+     * record.  A thread's records reach the LogWriter in the order it
+     * formatted them, so every MESSAGE record follows the definitions it
+     * needs without any lock shared between threads.  The cost is that a
+     * callsite, and the magic value, may be written once per thread; the
+     * decoder skips repeated magic values and keeps the latest definition of
+     * each callsite.
+     */
+    constexpr StringPiece kBinaryLogMagic{"TLOGBIN1"};
+
+    enum class BinaryLogRecordType : uint8_t
+    {
+        CALLSITE = 1,
+        MESSAGE = 2,
+    };
+
+    /**
+     * BinaryLogFormatter serializes LogMessages in the binary log format.
+     *
+     * The raw message text is copied verbatim: sanitizing it and rendering
+     * the header as text is left to the decoder.
+     */
+    class BinaryLogFormatter : public LogFormatter
+    {
+    public:
+        BinaryLogFormatter();
+
+        std::string formatMessage(
+            const LogMessage &message, const LogCategory *handlerCategory) override;
+
+        /**
+         * Forget all callsites written so far.
+         *
+         * The next message each thread formats will start a new stream,
+         * beginning with the magic header.  Call this when the LogWriter
+         * starts a new file.
+         */
+        void reset();
+
+    private:
+        /**
+         * Identifies this formatter in each thread's record of what it has
+         * written.  Unlike the formatter's address, it is never reused.
+         */
+        uint64_t const id_;
+
+        /**
+         * Incremented by reset().  A thread whose record is from an earlier
+         * epoch starts over.
+         */
+        std::atomic<uint64_t> epoch_{0};
+    };
+
+    /**
+     * A decoded MESSAGE record together with its callsite information.
+     */
+    struct DecodedLogRecord
+    {
+        std::string categoryName;
+        LogLevel level{LogLevel::UNINITIALIZED};
+        std::string filename;
+        unsigned int lineNumber{0};
+        std::string functionName;
+        std::chrono::system_clock::time_point timestamp;
+        uint64_t threadID{0};
+        std::string contextString;
+        std::string message;
+    };
+
+    /**
+     * BinaryLogDecoder incrementally parses the binary log format.
+     *
+     * Data may be fed in arbitrarily sized chunks.  A MESSAGE record that
+     * arrives before its callsite is defined, which BinaryLogFormatter never
+     * produces but a LogWriter that reorders writes could, is held until the
+     * definition arrives or finish() is called.
+     */
+    class BinaryLogDecoder
+    {
+    public:
+        using Callback = std::function<void(const DecodedLogRecord &)>;
+
+        explicit BinaryLogDecoder(Callback callback) : callback_{std::move(callback)} {}
+
+        /**
+         * Decode as many complete records as possible from the data fed so far.
+         *
+         * Throws std::runtime_error if the data is not in the binary log format.
+         */
+        void feed(tinylog::StringPiece data);
+
+        /**
+         * Signal the end of the input.
+         *
+         * Messages whose callsite was never defined are reported with a
+         * placeholder callsite.  Throws std::runtime_error if the input ended in
+         * the middle of a record.
+         */
+        void finish();
+
+        /**
+         * Render a decoded record as a line of text, for example:
+         *
+         *   I1017 12:34:56.789012 4242 file.cc:42 main] [my.category] message
+         *
+         * Non-printable characters in the message are escaped the same way
+         * LogMessage::getMessage() escapes them.
+         */
+        static std::string formatRecord(const DecodedLogRecord &record);
+
+    private:
+        struct Callsite
+        {
+            std::string categoryName;
+            LogLevel level;
+            unsigned int lineNumber;
+            std::string filename;
+            std::string functionName;
+        };
+
+        struct PendingMessage
+        {
+            uint64_t callsiteId;
+            DecodedLogRecord record;
+        };
+
+        bool decodeRecord(size_t &offset);
+        void emit(const Callsite &callsite, DecodedLogRecord &record);
+
+        Callback const callback_;
+        std::string buffer_;
+        bool sawMagic_{false};
+        std::unordered_map<uint64_t, Callsite> callsites_;
+        std::vector<PendingMessage> pending_;
+    };
+
+} // namespace tinylog
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstring>
+#include <string>
+
+#include "StringPiece.h"
+
+namespace tinylog
+{
+    /**
+     * CategoryKey is a log category name in canonical form, together with its
+     * LogName::hash().
+     *
+     * LoggerDB looks categories up by CategoryKey.  The name is canonicalized
+     * and hashed once, when the key is built, so probing the category map only
+     * needs to compare hashes, then sizes, then bytes.  Names that are already
+     * canonical, which is nearly all of them, are referenced rather than
+     * copied.
+     *
+     * A CategoryKey may refer to the name it was built from, so it must not
+     * outlive it.  Keys are meant to be built on the stack for a single
+     * lookup, and cannot be copied or moved.
+     */
+    class CategoryKey
+    {
+    public:
+        /**
+         * Build a key from a log category name, which need not be canonical.
+         */
+        explicit CategoryKey(tinylog::StringPiece name);
+
+        /**
+         * Build a key from a name and its LogName::hash(), computed earlier.
+         *
+         * This is how XLOG() statements, which hash their category name at
+         * compile time, look up their category.  The name need not be
+         * canonical; equivalent names have the same hash, so it is reused.
+         */
+        CategoryKey(tinylog::StringPiece name, size_t hash);
+
+        CategoryKey(const CategoryKey &) = delete;
+        CategoryKey &operator=(const CategoryKey &) = delete;
+
+        /**
+         * The canonical category name.
+         */
+        tinylog::StringPiece name() const { return name_; }
+
+        size_t hash() const { return hash_; }
+
+        /**
+         * Return true if this key names the category with the given canonical
+         * name.
+         */
+        bool matches(tinylog::StringPiece canonicalName) const
+        {
+            return canonicalName.size() == name_.size() &&
+                   std::memcmp(canonicalName.data(), name_.data(), name_.size()) == 0;
+        }
+
+        /**
+         * Return the key for the parent category.
+         *
+         * The parent of a canonical name is a prefix of it, and is canonical
+         * too, so this only needs to hash it.  The result refers to the same
+         * name as this key.
+         */
+        CategoryKey parent() const;
+
+    private:
+        struct CanonicalTag
+        {
+        };
+
+        CategoryKey(CanonicalTag, tinylog::StringPiece canonicalName);
+
+        std::string storage_;
+        tinylog::StringPiece name_;
+        size_t hash_;
+    };
+
+} // namespace tinylog
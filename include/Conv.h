@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace tinylog
+{
+    namespace detail
+    {
+        /**
+         * The decimal digits of 00 through 99, two characters each.
+         */
+        inline constexpr char kTwoDigits[201] =
+            "00010203040506070809"
+            "10111213141516171819"
+            "20212223242526272829"
+            "30313233343536373839"
+            "40414243444546474849"
+            "50515253545556575859"
+            "60616263646566676869"
+            "70717273747576777879"
+            "80818283848586878889"
+            "90919293949596979899";
+
+    } // namespace detail
+
+    /**
+     * Returns the number of digits in the base 10 representation of v.
+     */
+    inline size_t digits10(uint64_t v)
+    {
+        size_t result = 1;
+        while (true)
+        {
+            if (v < 10)
+            {
+                return result;
+            }
+            if (v < 100)
+            {
+                return result + 1;
+            }
+            if (v < 1000)
+            {
+                return result + 2;
+            }
+            if (v < 10000)
+            {
+                return result + 3;
+            }
+            v /= 10000;
+            result += 4;
+        }
+    }
+
+    /**
+     * Write v in base 10 to exactly width characters at out, padding on the
+     * left with zeros.  Digits beyond width are dropped.
+     */
+    inline void uint64ToBufferFixed(uint64_t v, char *out, size_t width)
+    {
+        char *p = out + width;
+        while (p - out >= 2)
+        {
+            p -= 2;
+            memcpy(p, &detail::kTwoDigits[2 * (v % 100)], 2);
+            v /= 100;
+        }
+        if (p != out)
+        {
+            *--p = static_cast<char>('0' + v % 10);
+        }
+    }
+
+    /**
+     * Write v in base 10 to out, without a terminating nul.
+     *
+     * Returns the number of characters written, which is digits10(v).  The
+     * buffer must have room for it; 20 characters are always enough.
+     */
+    inline size_t uint64ToBufferUnsafe(uint64_t v, char *out)
+    {
+        auto length = digits10(v);
+        uint64ToBufferFixed(v, out, length);
+        return length;
+    }
+
+} // namespace tinylog
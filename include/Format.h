@@ -0,0 +1,520 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "StringPiece.h"
+
+/**
+ * tinylog::format() renders "{}" style format strings into a reusable
+ * thread-local buffer.
+ *
+ *   auto msg = tinylog::format(TINYLOG_FMT("{} took {:.3f}s"), name, secs);
+ *
+ * Each replacement field is "{}" or "{:spec}", where spec is
+ *
+ *   [0][width][.precision][type]
+ *
+ * and type is one of d (decimal integer), x or X (hexadecimal integer or
+ * pointer), f, e or g (fixed, scientific or general floating point) or s
+ * (string, bool or char).  Without a type, each argument is rendered in its
+ * natural form.  A leading 0 pads numbers with zeros instead of spaces;
+ * numbers are right aligned and everything else left aligned.  "{{" and
+ * "}}" produce literal braces.
+ *
+ * Format strings wrapped in TINYLOG_FMT() are parsed at compile time, and a
+ * mismatch between the format string and the argument types is a compile
+ * error.  Other format strings are checked at run time, and
+ * std::invalid_argument is thrown if they don't match the arguments.
+ */
+
+namespace tinylog
+{
+    namespace detail
+    {
+        enum class FormatArgKind : uint8_t
+        {
+            INT,
+            UINT,
+            BOOL,
+            CHAR,
+            DOUBLE,
+            STRING,
+            POINTER,
+            UNSUPPORTED,
+        };
+
+        enum class FormatError : uint8_t
+        {
+            NONE,
+            UNMATCHED_BRACE,
+            BAD_SPEC,
+            TOO_FEW_ARGS,
+            TOO_MANY_ARGS,
+            TYPE_MISMATCH,
+        };
+
+        const char *getFormatErrorMessage(FormatError error);
+
+        [[noreturn]] void throwFormatError(StringPiece fmt, FormatError error);
+
+        template <typename T>
+        constexpr FormatArgKind getFormatArgKind()
+        {
+            using U = std::decay_t<T>;
+            if constexpr (std::is_same<U, bool>::value)
+            {
+                return FormatArgKind::BOOL;
+            }
+            else if constexpr (std::is_same<U, char>::value)
+            {
+                return FormatArgKind::CHAR;
+            }
+            else if constexpr (std::is_integral<U>::value)
+            {
+                return std::is_signed<U>::value ? FormatArgKind::INT
+                                                : FormatArgKind::UINT;
+            }
+            else if constexpr (std::is_floating_point<U>::value)
+            {
+                return FormatArgKind::DOUBLE;
+            }
+            else if constexpr (
+                std::is_convertible<const U &, const char *>::value ||
+                std::is_convertible<const U &, StringPiece>::value)
+            {
+                return FormatArgKind::STRING;
+            }
+            else if constexpr (std::is_pointer<U>::value)
+            {
+                return FormatArgKind::POINTER;
+            }
+            else
+            {
+                return FormatArgKind::UNSUPPORTED;
+            }
+        }
+
+        /**
+         * The kinds of a pack of arguments, with a trailing entry so that the
+         * array is never empty.
+         */
+        template <typename... Args>
+        inline constexpr FormatArgKind kFormatArgKinds[] = {
+            getFormatArgKind<Args>()..., FormatArgKind::UNSUPPORTED};
+
+        struct FormatSpec
+        {
+            bool zeroPad{false};
+            unsigned int width{0};
+            int precision{-1};
+            char type{0};
+        };
+
+        constexpr bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+        /**
+         * Parse a replacement field.  pos is the index just after its '{', and
+         * is advanced past its '}'.
+         */
+        constexpr FormatError parseFormatField(
+            StringPiece fmt, int &pos, FormatSpec &spec)
+        {
+            spec = FormatSpec{};
+            if (pos < fmt.size() && fmt[pos] == ':')
+            {
+                ++pos;
+                if (pos < fmt.size() && fmt[pos] == '0')
+                {
+                    spec.zeroPad = true;
+                    ++pos;
+                }
+                int digits = 0;
+                while (pos < fmt.size() && isDigit(fmt[pos]))
+                {
+                    spec.width = spec.width * 10 + (fmt[pos++] - '0');
+                    if (++digits > 3)
+                    {
+                        return FormatError::BAD_SPEC;
+                    }
+                }
+                if (pos < fmt.size() && fmt[pos] == '.')
+                {
+                    ++pos;
+                    spec.precision = 0;
+                    digits = 0;
+                    while (pos < fmt.size() && isDigit(fmt[pos]))
+                    {
+                        spec.precision = spec.precision * 10 + (fmt[pos++] - '0');
+                        ++digits;
+                    }
+                    if (digits == 0 || digits > 2)
+                    {
+                        return FormatError::BAD_SPEC;
+                    }
+                }
+                if (pos < fmt.size() && fmt[pos] != '}')
+                {
+                    spec.type = fmt[pos++];
+                    switch (spec.type)
+                    {
+                    case 'd':
+                    case 'x':
+                    case 'X':
+                    case 'f':
+                    case 'e':
+                    case 'g':
+                    case 's':
+                        break;
+                    default:
+                        return FormatError::BAD_SPEC;
+                    }
+                }
+            }
+            if (pos >= fmt.size())
+            {
+                return FormatError::UNMATCHED_BRACE;
+            }
+            if (fmt[pos] != '}')
+            {
+                return FormatError::BAD_SPEC;
+            }
+            ++pos;
+            return FormatError::NONE;
+        }
+
+        constexpr bool isFormatArgAllowed(const FormatSpec &spec, FormatArgKind kind)
+        {
+            if (spec.precision >= 0 && kind != FormatArgKind::DOUBLE)
+            {
+                return false;
+            }
+            switch (spec.type)
+            {
+            case 0:
+                return true;
+            case 'd':
+                return kind == FormatArgKind::INT || kind == FormatArgKind::UINT ||
+                       kind == FormatArgKind::CHAR;
+            case 'x':
+            case 'X':
+                return kind == FormatArgKind::INT || kind == FormatArgKind::UINT ||
+                       kind == FormatArgKind::CHAR || kind == FormatArgKind::POINTER;
+            case 'f':
+            case 'e':
+            case 'g':
+                return kind == FormatArgKind::DOUBLE;
+            case 's':
+                return kind == FormatArgKind::STRING || kind == FormatArgKind::BOOL ||
+                       kind == FormatArgKind::CHAR;
+            }
+            return false;
+        }
+
+        /**
+         * Check a format string against the kinds of its arguments.
+         *
+         * This is constexpr so that TINYLOG_FMT() strings can be checked at
+         * compile time.
+         */
+        constexpr FormatError checkFormat(
+            StringPiece fmt, const FormatArgKind *kinds, size_t numArgs)
+        {
+            size_t argIndex = 0;
+            int pos = 0;
+            while (pos < fmt.size())
+            {
+                char c = fmt[pos++];
+                if (c == '{')
+                {
+                    if (pos < fmt.size() && fmt[pos] == '{')
+                    {
+                        ++pos;
+                        continue;
+                    }
+                    FormatSpec spec;
+                    auto error = parseFormatField(fmt, pos, spec);
+                    if (error != FormatError::NONE)
+                    {
+                        return error;
+                    }
+                    if (argIndex >= numArgs)
+                    {
+                        return FormatError::TOO_FEW_ARGS;
+                    }
+                    if (!isFormatArgAllowed(spec, kinds[argIndex]))
+                    {
+                        return FormatError::TYPE_MISMATCH;
+                    }
+                    ++argIndex;
+                }
+                else if (c == '}')
+                {
+                    if (pos < fmt.size() && fmt[pos] == '}')
+                    {
+                        ++pos;
+                        continue;
+                    }
+                    return FormatError::UNMATCHED_BRACE;
+                }
+            }
+            return argIndex == numArgs ? FormatError::NONE : FormatError::TOO_MANY_ARGS;
+        }
+
+        struct FormatStringArg
+        {
+            const char *data;
+            size_t size;
+        };
+
+        /**
+         * A type-erased format argument.
+         */
+        struct FormatArg
+        {
+            FormatArgKind kind{FormatArgKind::UNSUPPORTED};
+            union
+            {
+                int64_t i;
+                uint64_t u;
+                double d;
+                const void *p;
+                FormatStringArg s;
+            };
+
+            FormatArg() : u{0} {}
+        };
+
+        template <typename T>
+        FormatArg makeFormatArg(const T &value)
+        {
+            constexpr auto kind = getFormatArgKind<T>();
+            FormatArg arg;
+            arg.kind = kind;
+            if constexpr (kind == FormatArgKind::INT)
+            {
+                arg.i = static_cast<int64_t>(value);
+            }
+            else if constexpr (
+                kind == FormatArgKind::UINT || kind == FormatArgKind::BOOL ||
+                kind == FormatArgKind::CHAR)
+            {
+                arg.u = static_cast<uint64_t>(value);
+            }
+            else if constexpr (kind == FormatArgKind::DOUBLE)
+            {
+                arg.d = static_cast<double>(value);
+            }
+            else if constexpr (std::is_convertible<const T &, const char *>::value)
+            {
+                const char *str = value;
+                arg.s.data = str ? str : "(null)";
+                arg.s.size = strlen(arg.s.data);
+            }
+            else if constexpr (kind == FormatArgKind::STRING)
+            {
+                StringPiece str{value};
+                arg.s.data = str.data();
+                arg.s.size = static_cast<size_t>(str.size());
+            }
+            else
+            {
+                arg.p = static_cast<const void *>(value);
+            }
+            return arg;
+        }
+
+        /**
+         * Append fmt, with its replacement fields filled in from args, to out.
+         * fmt must already have been checked against the arguments.
+         */
+        void formatTo(
+            std::string &out, StringPiece fmt, const FormatArg *args, size_t numArgs);
+
+        std::string *acquireFormatBuffer(bool &pooled);
+        void releaseFormatBuffer(std::string *buffer, bool pooled) noexcept;
+
+        /**
+         * The base of the types created by TINYLOG_FMT().
+         */
+        struct CompileTimeFormatString
+        {
+        };
+
+    } // namespace detail
+
+    class FormattedString;
+
+    namespace detail
+    {
+        template <typename... Args>
+        FormattedString formatArgs(StringPiece fmt, const Args &...args);
+
+    } // namespace detail
+
+    /**
+     * The result of tinylog::format().
+     *
+     * This refers to a thread-local buffer that is reused once the
+     * FormattedString is destroyed, so it should be short-lived, typically
+     * a temporary passed straight to a LogMessage constructor, which copies
+     * the text into its own inline or arena storage without allocating.  A
+     * FormattedString must be destroyed on the thread that created it.
+     *
+     * Each thread has a few buffers, so formatting arguments with
+     * tinylog::format() is safe; deeper nesting falls back to a heap-allocated
+     * buffer.
+     */
+    class FormattedString
+    {
+    public:
+        FormattedString(FormattedString &&other) noexcept
+            : buffer_{other.buffer_}, pooled_{other.pooled_}
+        {
+            other.buffer_ = nullptr;
+        }
+
+        FormattedString(const FormattedString &) = delete;
+        FormattedString &operator=(const FormattedString &) = delete;
+        FormattedString &operator=(FormattedString &&) = delete;
+
+        ~FormattedString()
+        {
+            if (buffer_)
+            {
+                detail::releaseFormatBuffer(buffer_, pooled_);
+            }
+        }
+
+        const char *data() const { return buffer_->data(); }
+        size_t size() const { return buffer_->size(); }
+
+        StringPiece piece() const
+        {
+            return StringPiece{buffer_->data(), static_cast<int>(buffer_->size())};
+        }
+        operator StringPiece() const { return piece(); }
+
+        std::string str() const { return *buffer_; }
+
+    private:
+        template <typename... Args>
+        friend FormattedString detail::formatArgs(
+            StringPiece fmt, const Args &...args);
+
+        FormattedString()
+        {
+            buffer_ = detail::acquireFormatBuffer(pooled_);
+        }
+
+        std::string *buffer_{nullptr};
+        bool pooled_{false};
+    };
+
+    namespace detail
+    {
+        template <typename... Args>
+        FormattedString formatArgs(StringPiece fmt, const Args &...args)
+        {
+            FormatArg packed[] = {makeFormatArg(args)..., FormatArg{}};
+            FormattedString result;
+            formatTo(*result.buffer_, fmt, packed, sizeof...(Args));
+            return result;
+        }
+
+    } // namespace detail
+
+    /**
+     * Format a string checked at compile time.  See TINYLOG_FMT().
+     */
+    template <
+        typename S,
+        typename... Args,
+        std::enable_if_t<
+            std::is_base_of<detail::CompileTimeFormatString, S>::value,
+            int> = 0>
+    FormattedString format(S, const Args &...args)
+    {
+        using detail::FormatError;
+        static_assert(
+            ((detail::getFormatArgKind<Args>() != detail::FormatArgKind::UNSUPPORTED) &&
+             ...),
+            "tinylog::format: unsupported argument type");
+        constexpr auto error = detail::checkFormat(
+            S::value(), detail::kFormatArgKinds<Args...>, sizeof...(Args));
+        static_assert(
+            error != FormatError::UNMATCHED_BRACE,
+            "tinylog::format: unmatched brace in format string");
+        static_assert(
+            error != FormatError::BAD_SPEC,
+            "tinylog::format: invalid replacement field in format string");
+        static_assert(
+            error != FormatError::TOO_FEW_ARGS,
+            "tinylog::format: too few arguments for format string");
+        static_assert(
+            error != FormatError::TOO_MANY_ARGS,
+            "tinylog::format: too many arguments for format string");
+        static_assert(
+            error != FormatError::TYPE_MISMATCH,
+            "tinylog::format: argument type does not match replacement field");
+        return detail::formatArgs(S::value(), args...);
+    }
+
+    /**
+     * Format a string checked at run time.
+     *
+     * Throws std::invalid_argument if fmt doesn't match the arguments.
+     */
+    template <typename... Args>
+    FormattedString format(StringPiece fmt, const Args &...args)
+    {
+        static_assert(
+            ((detail::getFormatArgKind<Args>() != detail::FormatArgKind::UNSUPPORTED) &&
+             ...),
+            "tinylog::format: unsupported argument type");
+        auto error = detail::checkFormat(
+            fmt, detail::kFormatArgKinds<Args...>, sizeof...(Args));
+        if (error != detail::FormatError::NONE)
+        {
+            detail::throwFormatError(fmt, error);
+        }
+        return detail::formatArgs(fmt, args...);
+    }
+
+} // namespace tinylog
+
+/**
+ * Wrap a string literal for tinylog::format() so that it is checked against
+ * the argument types at compile time.
+ */
+#define TINYLOG_FMT(str)                                                 \
+    [] {                                                                 \
+        struct TinyLogFormatString                                       \
+            : ::tinylog::detail::CompileTimeFormatString                 \
+        {                                                                \
+            static constexpr ::tinylog::StringPiece value()              \
+            {                                                            \
+                return ::tinylog::StringPiece(str, sizeof(str) - 1);     \
+            }                                                            \
+        };                                                               \
+        return TinyLogFormatString{};                                    \
+    }()
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "LogFormatter.h"
+
+namespace tinylog
+{
+    /**
+     * A LogFormatter implementation that produces messages in a format similar
+     * to that produced by the Google logging library.
+     *
+     * The glog message format is:
+     *
+     *   E0517 12:34:56.789012  1234 file.cc:123] message text
+     *
+     * That is the first letter of the log level, the month and day, the time
+     * with microseconds, the thread ID, and the basename of the source file
+     * with the line number, followed by any context string.  Messages that
+     * contain newlines are split into several lines, each with its own header.
+     *
+     * Local time is computed without calling localtime_r() for each message:
+     * each thread caches the UTC offset, looked up again at most once every
+     * kUtcOffsetCacheSeconds, and the rendered date and time of the current
+     * second, so most messages only render their microseconds.
+     */
+    class GlogStyleFormatter : public LogFormatter
+    {
+    public:
+        /**
+         * How long a thread reuses the UTC offset it looked up.  Offsets are
+         * cached per aligned interval of this length; current time zones only
+         * change their offset on such a boundary, so the cache never spans a
+         * transition.
+         */
+        static constexpr int64_t kUtcOffsetCacheSeconds = 15 * 60;
+
+        std::string formatMessage(
+            const LogMessage &message, const LogCategory *handlerCategory) override;
+    };
+
+} // namespace tinylog
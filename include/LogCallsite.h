@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "LogLevel.h"
+#include "StringPiece.h"
+
+namespace tinylog
+{
+    /**
+     * LogCallsite holds the static information about a single log statement:
+     * its source location, the category it logs to and its level.
+     *
+     * Log statements define a LogCallsite as a function-local static with a
+     * constexpr constructor, so it is built at compile time and costs nothing
+     * at runtime.  Every LogMessage logged from that statement points to the
+     * same LogCallsite rather than carrying its own copy of this data.
+     * Messages constructed from a separately specified source location point
+     * to a LogCallsite interned by LogCallsiteRegistry instead.
+     *
+     * Each LogCallsite gets a small, process-unique ID the first time getId()
+     * is called.  Outputs such as the binary log format use it to describe a
+     * callsite once and then refer to it by ID.
+     */
+    class LogCallsite
+    {
+    public:
+        constexpr LogCallsite(
+            tinylog::StringPiece filename,
+            unsigned int lineNumber,
+            tinylog::StringPiece functionName,
+            tinylog::StringPiece categoryName,
+            LogLevel level)
+            : filename_{filename},
+              fileBaseName_{getBaseName(filename)},
+              functionName_{functionName},
+              categoryName_{categoryName},
+              lineNumber_{lineNumber},
+              level_{level} {}
+
+        constexpr tinylog::StringPiece getFileName() const { return filename_; }
+        constexpr tinylog::StringPiece getFileBaseName() const { return fileBaseName_; }
+        constexpr unsigned int getLineNumber() const { return lineNumber_; }
+        constexpr tinylog::StringPiece getFunctionName() const { return functionName_; }
+        constexpr tinylog::StringPiece getCategoryName() const { return categoryName_; }
+        constexpr LogLevel getLevel() const { return level_; }
+
+        /**
+         * Get the ID of this callsite, registering it with the
+         * LogCallsiteRegistry if this is the first call.
+         */
+        uint32_t getId() const
+        {
+            auto id = id_.load(std::memory_order_acquire);
+            return id != 0 ? id : registerSlow();
+        }
+
+        static constexpr tinylog::StringPiece getBaseName(tinylog::StringPiece filename)
+        {
+            for (auto idx = filename.size(); idx > 0; --idx)
+            {
+                if (filename[idx - 1] == '/')
+                {
+                    return tinylog::StringPiece(
+                        filename.data() + idx, filename.size() - idx);
+                }
+            }
+            return filename;
+        }
+
+    private:
+        friend class LogCallsiteRegistry;
+
+        // Callsites are referred to by address, so they cannot be copied.
+        LogCallsite(LogCallsite const &) = delete;
+        LogCallsite &operator=(LogCallsite const &) = delete;
+
+        uint32_t registerSlow() const;
+
+        tinylog::StringPiece const filename_;
+        tinylog::StringPiece const fileBaseName_;
+        tinylog::StringPiece const functionName_;
+        tinylog::StringPiece const categoryName_;
+        unsigned int const lineNumber_;
+        LogLevel const level_;
+
+        /**
+         * The registered ID, or 0 if the callsite has not been registered yet.
+         */
+        mutable std::atomic<uint32_t> id_{0};
+    };
+
+    /**
+     * LogCallsiteRegistry assigns IDs to LogCallsite objects, and owns the
+     * callsites created at runtime for log messages that were not logged from
+     * a statically defined callsite.
+     */
+    class LogCallsiteRegistry
+    {
+    public:
+        /**
+         * Get the callsite registered with the given ID, or nullptr if there is
+         * none.
+         */
+        static const LogCallsite *lookup(uint32_t id);
+
+        /**
+         * Get the number of callsites registered so far.
+         */
+        static size_t getNumCallsites();
+
+        /**
+         * Get a LogCallsite describing the given information.
+         *
+         * This is used by the LogMessage constructors that take the source
+         * location as separate arguments.  The strings are copied, and
+         * repeated calls with equal arguments return the same LogCallsite.
+         * The returned callsite remains valid for the lifetime of the
+         * process.
+         */
+        static const LogCallsite *intern(
+            tinylog::StringPiece filename,
+            unsigned int lineNumber,
+            tinylog::StringPiece functionName,
+            tinylog::StringPiece categoryName,
+            LogLevel level);
+
+    private:
+        friend class LogCallsite;
+
+        static uint32_t registerCallsite(const LogCallsite *callsite);
+    };
+
+} // namespace tinylog
@@ -23,6 +23,7 @@
 
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 
 #include "StringPiece.h"
@@ -55,20 +56,30 @@ namespace tinylog
         /**
          * Create a new LogCategory.
          *
-         * This should only be invoked by LoggerDB, while holding the main loggerDB
-         * lock.
+         * This should only be invoked by LoggerDB, while holding its tree lock
+         * in shared mode.
          *
-         * The name argument should already be in canonical form.
+         * The name argument should already be in canonical form, and must
+         * outlive the category; LogCategoryArena copies names into storage
+         * that lives as long as the categories do.
          *
          * This constructor automatically adds this new LogCategory to the parent
-         * category's firstChild_ linked-list.
+         * category's firstChild_ linked-list.  Other threads may be adding
+         * siblings at the same time, so this is done with compare-and-swap.
          */
         LogCategory(tinylog::StringPiece name, LogCategory *parent);
 
+        ~LogCategory();
+
         /**
          * Get the name of this log category.
          */
-        const std::string &getName() const { return name_; }
+        tinylog::StringPiece getName() const { return name_; }
+
+        /**
+         * Get the parent of this log category, or nullptr for the root category.
+         */
+        LogCategory *getParent() const { return parent_; }
 
         /**
          * Get the level for this log category.
@@ -209,10 +220,20 @@ namespace tinylog
          */
         void admitMessage(const LogMessage &message) const;
 
+        /**
+         * Rebuild the handler dispatch list of this category and all of its
+         * descendants, parents before children.
+         *
+         * This may only be called while holding the LoggerDB tree lock
+         * exclusively.  It should only be invoked by LoggerDB, which must
+         * then call RcuDomain::synchronize() to free the replaced lists.
+         */
+        void updateDispatchListsLocked();
+
         /**
          * Note: setLevelLocked() may only be called while holding the
-         * LoggerDB loggersByName_ lock. It is safe to call this while holding the
-         * loggersByName_ lock in read-mode; holding it exclusively is not required.
+         * LoggerDB tree lock exclusively, since it walks the firstChild_ lists
+         * and the registered XLOG() levels of this category's descendants.
          *
          * This method should only be invoked by LoggerDB.
          */
@@ -225,8 +246,8 @@ namespace tinylog
          * The LogCategory will keep this value updated whenever its effective log
          * level changes.
          *
-         * This function should only be invoked by LoggerDB, and the LoggerDB lock
-         * must be held when calling it.
+         * This function should only be invoked by LoggerDB, while holding its
+         * tree lock and the lock of the shard that contains this category.
          */
         void registerXlogLevel(std::atomic<LogLevel> *levelPtr);
 
@@ -251,18 +272,94 @@ namespace tinylog
         LogCategory(LogCategory &&) = delete;
         LogCategory &operator=(LogCategory &&) = delete;
 
-        void processMessage(const LogMessage &message) const;
+        /**
+         * One handler that messages admitted at this category may reach.
+         */
+        struct DispatchEntry
+        {
+            /**
+             * The lowest message level that reaches the handler: the highest
+             * propagateLevelMessagesToParent_ between this category and the
+             * one the handler is attached to.
+             */
+            LogLevel minLevel;
+            std::shared_ptr<LogHandler> handler;
+            /**
+             * The category the handler is attached to.
+             */
+            const LogCategory *category;
+        };
+
+        /**
+         * Every handler of this category and its ancestors, in the order
+         * messages visit them: this category's handlers first, then its
+         * parent's, and so on up to the root.  minLevel never decreases
+         * along the list.
+         */
+        using DispatchList = std::vector<DispatchEntry>;
+
+        /**
+         * Rebuild dispatchList_ from handlers_ and the parent's list.
+         *
+         * The old list is retired to the default RcuDomain, and the caller
+         * must call RcuDomain::synchronize() to free it.
+         */
+        void rebuildDispatchList();
+
+        /**
+         * Set the effective level of this category, and of every descendant
+         * that inherits from it.
+         */
         void updateEffectiveLevel(LogLevel newEffectiveLevel);
-        void parentLevelUpdated(LogLevel parentEffectiveLevel);
 
         /**
-         * Which log message processed at this category should propagate to the
-         * parent category. The usual case is `LogLevel::MIN_LEVEL` which means all
-         * messages will be propagated. `LogLevel::MAX_LEVEL` generally means that
-         * this category and its children are directed to different destinations
-         * and the user does not want the message duplicated.
+         * Store a new effective level in this category and its registered
+         * XLOG() levels.  Returns false if the effective level was unchanged.
          */
-        std::atomic<LogLevel> propagateLevelMessagesToParent_{LogLevel::MIN_LEVEL};
+        bool storeEffectiveLevel(LogLevel newEffectiveLevel);
+
+        /**
+         * Recompute the effective level after the parent's changed.  Returns
+         * true if this category's effective level changed with it.
+         */
+        bool parentLevelUpdated(LogLevel parentEffectiveLevel);
+
+        /**
+         * The siblings from first up to, but not including, end.  end is
+         * nullptr for a range that runs to the last sibling.
+         */
+        struct SiblingRange
+        {
+            LogCategory *first;
+            LogCategory *end;
+        };
+
+        /**
+         * Recompute the effective levels of the subtrees rooted at the
+         * categories in pending, whose parents have already been updated.
+         * Subtrees whose root's effective level does not change are skipped.
+         */
+        static void propagateEffectiveLevel(
+            std::vector<SiblingRange> pending, size_t numThreads);
+
+        /**
+         * Continue propagateEffectiveLevel() below this category, whose
+         * effective level has changed.  Its children are added to pending,
+         * unless the subtree has at least kMinParallelSubtree categories and
+         * numThreads > 1, in which case they are updated in parallel here.
+         */
+        void propagateToChildren(
+            std::vector<SiblingRange> &pending, size_t numThreads);
+
+        static constexpr uint32_t kMinParallelSubtree = 16384;
+
+        // The members are laid out in two groups.  The first cache line holds
+        // what logging reads: the effective level for logCheck(), the
+        // dispatch list, and the parent pointer and name.  These only change
+        // when the configuration does.  The cold members after it are written
+        // when categories are created, handlers are changed or XLOG()
+        // statements register, and are kept off that line so those writes do
+        // not evict it from other cores' caches.
 
         /**
          * The minimum log level of this category and all of its parents.
@@ -270,12 +367,20 @@ namespace tinylog
         std::atomic<LogLevel> effectiveLevel_{LogLevel::MAX_LEVEL};
 
         /**
-         * The current log level for this category.
+         * The flattened list admitMessage() dispatches messages with.
          *
-         * The most significant bit is used to indicate if this logger should
-         * inherit its parent's effecitve log level.
+         * The list is immutable once built, and is replaced whenever the
+         * handlers or propagation level of this category or an ancestor
+         * change.  admitMessage() reads it inside an RcuReader section, so
+         * logging is wait-free even while the configuration is being
+         * reloaded.  A replaced list, and any handler only it refers to, is
+         * destroyed once no thread can still be dispatching through it.
+         *
+         * It is replaced with the LoggerDB tree lock held exclusively, so
+         * while holding the tree lock it can be read without an RcuReader.
+         * We own the list, and delete it when we are destroyed.
          */
-        std::atomic<uint32_t> level_{0};
+        std::atomic<const DispatchList *> dispatchList_{nullptr};
 
         /**
          * Our parent LogCategory in the category hierarchy.
@@ -286,38 +391,75 @@ namespace tinylog
         LogCategory *const parent_{nullptr};
 
         /**
-         * Our log category name.
+         * A pointer to the LoggerDB that we belong to.
+         *
+         * This is almost always the main LoggerDB singleton. Unit tests are the
+         * main place where we use other LoggerDB objects besides the singleton.
          */
-        const std::string name_;
+        LoggerDB *const db_{nullptr};
 
         /**
-         * The list of LogHandlers attached to this category.
+         * Our log category name.  This points into the LogCategoryArena that
+         * allocated us.
          */
-        std::vector<std::shared_ptr<LogHandler>> handlers_; // TODO
+        tinylog::StringPiece const name_;
 
         /**
-         * A pointer to the LoggerDB that we belong to.
+         * The current log level for this category.
          *
-         * This is almost always the main LoggerDB singleton. Unit tests are the
-         * main place where we use other LoggerDB objects besides the singleton.
+         * The most significant bit is used to indicate if this logger should
+         * inherit its parent's effecitve log level.
          */
-        LoggerDB *const db_{nullptr};
+        alignas(64) std::atomic<uint32_t> level_{0};
+
+        /**
+         * Which log message processed at this category should propagate to the
+         * parent category. The usual case is `LogLevel::MIN_LEVEL` which means all
+         * messages will be propagated. `LogLevel::MAX_LEVEL` generally means that
+         * this category and its children are directed to different destinations
+         * and the user does not want the message duplicated.
+         *
+         * This is cold: logging reads the minLevel folded into each
+         * DispatchEntry, and this is only read when dispatch lists are rebuilt.
+         */
+        std::atomic<LogLevel> propagateLevelMessagesToParent_{LogLevel::MIN_LEVEL};
+
+        /**
+         * The list of LogHandlers attached to this category.
+         *
+         * handlersMutex_ only serializes changes to it; logging never reads
+         * it, and never takes the lock.
+         */
+        mutable std::mutex handlersMutex_;
+        std::vector<std::shared_ptr<LogHandler>> handlers_;
 
         /**
          * Pointers to children and sibling loggers.
-         * These pointers should only ever be accessed while holding the
-         * LoggerDB::loggerByName_ lock. (These are obly modified when creating new
-         * loggers, which occurs with the main LoggerDB lock held.)
+         *
+         * Children are pushed onto firstChild_ when they are created, which
+         * happens with the LoggerDB tree lock held in shared mode, so
+         * concurrent pushes use compare-and-swap.  nextSibling_ is set before
+         * a child is pushed and never changes afterwards.  The lists are only
+         * walked with the tree lock held exclusively.
          */
-        LogCategory *firstChild_{nullptr};
+        std::atomic<LogCategory *> firstChild_{nullptr};
         LogCategory *nextSibling_{nullptr};
 
+        /**
+         * The number of categories below this one.  It is incremented as
+         * categories are created, and tells level changes which subtrees are
+         * large enough to be worth updating in parallel.
+         */
+        std::atomic<uint32_t> numDescendants_{0};
+
         /**
          * A list of LogLevel values used by XLOG*() statements for this LogCategory.
          * The XLOG*() statements will check these values. We ensure they are kept
          * up-to-date each time the effective log level changes for this category.
          *
-         * This list may only be accessed while holding the main LoggerDB lock.
+         * This list is modified with the LoggerDB tree lock held in shared mode
+         * and the category's shard lock held, and read with the tree lock held
+         * exclusively.
          */
         std::vector<std::atomic<LogLevel> *> xlogLevel_;
     };
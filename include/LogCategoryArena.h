@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "StringPiece.h"
+
+namespace tinylog
+{
+    class LogCategory;
+    class LoggerDB;
+
+    /**
+     * LogCategoryArena allocates LogCategory objects, and interns their
+     * names, in large contiguous blocks.
+     *
+     * Categories are created at startup and live as long as their LoggerDB,
+     * so there is no need to allocate them one at a time.  Placing them side
+     * by side, with their names packed into blocks of their own, keeps the
+     * categories a program uses close together, and keeps names and other
+     * cold data out of the cache lines that logCheck() and parent-chain walks
+     * read.
+     *
+     * The arena is not thread-safe.  LogCategoryMap serializes calls to it
+     * the same way it serializes insert().
+     */
+    class LogCategoryArena
+    {
+    public:
+        LogCategoryArena();
+
+        /**
+         * Destroy every category, in the reverse order of creation.
+         */
+        ~LogCategoryArena();
+
+        LogCategoryArena(const LogCategoryArena &) = delete;
+        LogCategoryArena &operator=(const LogCategoryArena &) = delete;
+
+        /**
+         * Create the root category.
+         */
+        LogCategory *createRoot(LoggerDB *db);
+
+        /**
+         * Create a category, copying name into the arena.
+         *
+         * name must already be in canonical form.
+         */
+        LogCategory *create(tinylog::StringPiece name, LogCategory *parent);
+
+        size_t size() const { return categories_.size(); }
+
+        /**
+         * Call fn with every category, in the order they were created.
+         */
+        template <typename Fn>
+        void forEach(Fn &&fn) const
+        {
+            for (auto *category : categories_)
+            {
+                fn(category);
+            }
+        }
+
+        static constexpr size_t kCategoriesPerBlock = 64;
+        static constexpr size_t kNameBlockSize = 16384;
+
+    private:
+        struct BlockDeleter
+        {
+            void operator()(void *block) const;
+        };
+        using Block = std::unique_ptr<void, BlockDeleter>;
+
+        void *allocateCategory();
+        tinylog::StringPiece intern(tinylog::StringPiece name);
+
+        std::vector<Block> categoryBlocks_;
+        size_t categoriesInBlock_{kCategoriesPerBlock};
+
+        std::vector<std::unique_ptr<char[]>> nameBlocks_;
+        char *nameCursor_{nullptr};
+        size_t nameSpace_{0};
+
+        std::vector<LogCategory *> categories_;
+    };
+
+} // namespace tinylog
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "CategoryKey.h"
+#include "LogCategoryArena.h"
+
+namespace tinylog
+{
+    class LogCategory;
+    class LoggerDB;
+
+    /**
+     * LogCategoryMap is the read-mostly hash map LoggerDB uses to find
+     * LogCategory objects by name.
+     *
+     * find() is wait-free and may run concurrently with insert().  Calls to
+     * insert(), and to the other methods, must be serialized by the caller;
+     * LoggerDB shards its categories across several maps, each serialized by
+     * its own lock.
+     *
+     * Categories are never removed, so the map is an open-addressing table
+     * of LogCategory pointers whose slots are only ever filled in.  When the
+     * table needs to grow, a larger copy is built and published with a single
+     * pointer store, in the manner of RCU.  A reader may still be probing the
+     * old table, so retired tables are kept until the map is destroyed.  Each
+     * table is twice the size of the one before it, so they never use more
+     * memory than the current table does.
+     */
+    class LogCategoryMap
+    {
+    public:
+        LogCategoryMap();
+        ~LogCategoryMap();
+
+        LogCategoryMap(const LogCategoryMap &) = delete;
+        LogCategoryMap &operator=(const LogCategoryMap &) = delete;
+
+        /**
+         * Find the category with the given key, or return nullptr.
+         */
+        LogCategory *find(const CategoryKey &key) const noexcept;
+
+        /**
+         * Create the root category and add it.
+         */
+        LogCategory *insertRoot(LoggerDB *db);
+
+        /**
+         * Create the category named by key, with the given parent, and add it.
+         *
+         * No category with that name may be in the map already.
+         */
+        LogCategory *insert(const CategoryKey &key, LogCategory *parent);
+
+        /**
+         * Like insert(), but call init with the new category before find()
+         * can return it.
+         */
+        template <typename Init>
+        LogCategory *insert(const CategoryKey &key, LogCategory *parent, Init &&init)
+        {
+            auto *category = arena_.create(key.name(), parent);
+            init(category);
+            add(key.hash(), category);
+            return category;
+        }
+
+        size_t size() const { return arena_.size(); }
+
+        /**
+         * Call fn with every category in the map, in insertion order.
+         */
+        template <typename Fn>
+        void forEach(Fn &&fn) const
+        {
+            arena_.forEach(std::forward<Fn>(fn));
+        }
+
+        static constexpr size_t kInitialCapacity = 64;
+
+    private:
+        struct Slot
+        {
+            /**
+             * The category, or nullptr for an empty slot.  This is stored
+             * last, with release ordering, so a reader that sees it also sees
+             * hash.
+             */
+            std::atomic<LogCategory *> category{nullptr};
+            std::atomic<size_t> hash{0};
+        };
+
+        struct Table
+        {
+            explicit Table(size_t capacity)
+                : mask{capacity - 1}, slots{new Slot[capacity]} {}
+
+            size_t capacity() const { return mask + 1; }
+
+            /**
+             * Fill in the first empty slot of hash's probe sequence.
+             */
+            void add(size_t hash, LogCategory *category);
+
+            size_t const mask;
+            std::unique_ptr<Slot[]> const slots;
+        };
+
+        void grow();
+        void add(size_t hash, LogCategory *category);
+
+        std::atomic<Table *> table_;
+        std::vector<std::unique_ptr<Table>> tables_;
+        LogCategoryArena arena_;
+    };
+
+} // namespace tinylog
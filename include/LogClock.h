@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace tinylog
+{
+    enum class LogClockType
+    {
+        /**
+         * std::chrono::system_clock, i.e. clock_gettime(CLOCK_REALTIME).
+         */
+        SYSTEM,
+
+        /**
+         * clock_gettime(CLOCK_REALTIME_COARSE).  This is much cheaper than
+         * CLOCK_REALTIME, but is only updated on kernel ticks, so it lags
+         * behind by a few milliseconds.
+         */
+        REALTIME_COARSE,
+
+        /**
+         * The CPU's invariant time stamp counter, calibrated against
+         * CLOCK_REALTIME.  See TscLogClock.
+         */
+        TSC,
+    };
+
+    /**
+     * LogClock supplies the timestamps of LogMessage objects.
+     *
+     * Each LoggerDB has its own clock, see LoggerDB::setClock().
+     */
+    class LogClock
+    {
+    public:
+        using time_point = std::chrono::system_clock::time_point;
+
+        virtual ~LogClock() = default;
+
+        virtual time_point now() const = 0;
+
+        virtual LogClockType getType() const = 0;
+
+        /**
+         * Create a clock of the specified type.
+         *
+         * If a TSC clock is requested but the CPU does not have an invariant
+         * TSC this returns a SYSTEM clock instead.
+         */
+        static std::shared_ptr<LogClock> create(LogClockType type);
+    };
+
+    class SystemLogClock : public LogClock
+    {
+    public:
+        time_point now() const override
+        {
+            return std::chrono::system_clock::now();
+        }
+
+        LogClockType getType() const override { return LogClockType::SYSTEM; }
+
+        /**
+         * A SystemLogClock that lives for the duration of the program.
+         */
+        static SystemLogClock &instance();
+    };
+
+    class CoarseLogClock : public LogClock
+    {
+    public:
+        time_point now() const override;
+
+        LogClockType getType() const override
+        {
+            return LogClockType::REALTIME_COARSE;
+        }
+
+        /**
+         * The resolution of CLOCK_REALTIME_COARSE on this system.
+         */
+        static std::chrono::nanoseconds getResolution();
+    };
+
+    /**
+     * TscLogClock reads the CPU's time stamp counter and converts it to wall
+     * clock time using a calibration against CLOCK_REALTIME.
+     *
+     * A background thread recalibrates the clock, pairing a TSC reading with
+     * CLOCK_REALTIME and CLOCK_MONOTONIC readings each time.  The tick rate is
+     * measured against CLOCK_MONOTONIC, so it follows NTP frequency
+     * adjustments but not clock steps, and the offset is reset to
+     * CLOCK_REALTIME.  The first recalibrations happen after 10ms, 20ms, 40ms
+     * and so on up to the configured interval, so each rate is measured over
+     * a baseline at least as long as the time it will be used for.
+     *
+     * Drift bound: if the readings of each calibration sample are taken
+     * within a window w, the offset is off by at most w and the rate by at
+     * most w / B over a baseline B.  Since a rate is used for at most B, the
+     * returned timestamps stay within 2w of CLOCK_REALTIME.  Samples wider
+     * than kMaxSampleWindow are retaken, or skipped if the system is too busy
+     * to take a narrow one, so timestamps stay within kMaxDrift of
+     * CLOCK_REALTIME, plus however much the NTP frequency correction changes
+     * over one interval.  If CLOCK_REALTIME is stepped
+     * the error lasts until the next recalibration.
+     *
+     * Timestamps are not guaranteed to be monotonic: each recalibration may
+     * move the clock back by up to the accumulated drift.
+     */
+    class TscLogClock : public LogClock
+    {
+    public:
+        static constexpr std::chrono::milliseconds kDefaultRecalibrationInterval{1000};
+        static constexpr std::chrono::milliseconds kInitialCalibrationInterval{10};
+        static constexpr std::chrono::microseconds kMaxSampleWindow{10};
+        static constexpr std::chrono::microseconds kMaxDrift{2 * kMaxSampleWindow};
+
+        /**
+         * Throws std::runtime_error if the CPU does not have an invariant
+         * TSC.
+         */
+        explicit TscLogClock(
+            std::chrono::milliseconds recalibrationInterval =
+                kDefaultRecalibrationInterval);
+        ~TscLogClock() override;
+
+        /**
+         * Returns true if this CPU has a TSC that runs at a constant rate
+         * across frequency changes and idle states.
+         */
+        static bool isSupported();
+
+        time_point now() const override;
+
+        LogClockType getType() const override { return LogClockType::TSC; }
+
+        /**
+         * Take a new calibration sample now, instead of waiting for the
+         * background thread to do so.
+         */
+        void recalibrate();
+
+        /**
+         * The current estimate of the TSC frequency.
+         */
+        double getTicksPerSecond() const;
+
+    private:
+        struct Sample
+        {
+            uint64_t tsc;
+            int64_t realtimeNs;
+            int64_t monotonicNs;
+            int64_t windowNs;
+        };
+
+        /**
+         * The calibration read by now(), published with a sequence lock.
+         *
+         * The time is realtimeNs + ((tsc - baseTsc) * nsPerTick) >> kShift.
+         */
+        struct alignas(64) Calibration
+        {
+            std::atomic<uint64_t> seq{0};
+            std::atomic<uint64_t> baseTsc{0};
+            std::atomic<int64_t> baseRealtimeNs{0};
+            std::atomic<uint64_t> nsPerTick{0};
+        };
+
+        static constexpr unsigned kShift = 32;
+
+        static Sample takeSample();
+        void updateLocked(const Sample &sample);
+        void recalibrationLoop();
+        std::chrono::nanoseconds getNextIntervalLocked() const;
+
+        Calibration calibration_;
+
+        std::chrono::milliseconds const recalibrationInterval_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        bool stop_{false};
+        /**
+         * The sample the current rate is measured from, and the baseline the
+         * current rate was measured over.
+         */
+        Sample rateBase_{};
+        int64_t rateBaselineNs_{0};
+        std::thread thread_;
+    };
+
+} // namespace tinylog
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <atomic>
+#include <memory>
 
 namespace tinylog
 {
@@ -66,6 +67,32 @@ namespace tinylog
         virtual void handleMessage(
             const LogMessage &message, const LogCategory *handlerCategory) = 0;
 
+        /**
+         * Whether this LogHandler keeps messages after handleMessage() returns,
+         * for instance to process them asynchronously.
+         *
+         * LogCategory::admitMessage() builds a single reference-counted copy
+         * of each message for all handlers that return true here, and passes
+         * it to handleSharedMessage() instead of handleMessage().  This way a
+         * message is copied once no matter how many such handlers it reaches.
+         */
+        virtual bool keepsMessages() const { return false; }
+
+        /**
+         * Handle a message that the caller has already copied into an
+         * immutable, reference-counted LogMessage.
+         *
+         * Handlers that return true from keepsMessages() should override this
+         * to hold on to the shared message rather than copying it again.  The
+         * default implementation calls handleMessage().
+         */
+        virtual void handleSharedMessage(
+            const std::shared_ptr<const LogMessage> &message,
+            const LogCategory *handlerCategory)
+        {
+            handleMessage(*message, handlerCategory);
+        }
+
         /**
          * Block until all message that have already been sent to this LogHandler
          * have been processed.
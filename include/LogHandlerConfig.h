@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "StringPiece.h"
+
+namespace tinylog
+{
+    /**
+     * LogHandlerConfig contains configuration for a LogHandler
+     */
+    class LogHandlerConfig
+    {
+    public:
+        using Options = std::unordered_map<std::string, std::string>;
+
+        LogHandlerConfig() {}
+        explicit LogHandlerConfig(tinylog::StringPiece type) : type{type.str()} {}
+        LogHandlerConfig(tinylog::StringPiece type, Options options)
+            : type{type.str()}, options{std::move(options)} {}
+
+        bool operator==(const LogHandlerConfig &other) const
+        {
+            return type == other.type && options == other.options;
+        }
+        bool operator!=(const LogHandlerConfig &other) const
+        {
+            return !(*this == other);
+        }
+
+        /**
+         * The handler type name.
+         *
+         * If this is empty the configuration only updates the options of an
+         * existing handler, and the existing handler type is kept.
+         */
+        std::optional<std::string> type;
+        Options options;
+    };
+
+} // namespace tinylog
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "StringPiece.h"
+
+namespace tinylog
+{
+    class LogHandler;
+
+    /**
+     * LogHandlerFactory creates LogHandler objects of one type from the
+     * options given in a LogHandlerConfig.
+     *
+     * Factories are registered with LoggerDB::registerHandlerFactory().
+     */
+    class LogHandlerFactory
+    {
+    public:
+        using Options = std::unordered_map<std::string, std::string>;
+
+        virtual ~LogHandlerFactory() = default;
+
+        /**
+         * Get the type name of this LogHandlerFactory.
+         *
+         * The type is used to determine the LogHandlerFactory to use for a given
+         * handler type in the logging configuration.
+         */
+        virtual tinylog::StringPiece getType() const = 0;
+
+        /**
+         * Create a new LogHandler.
+         */
+        virtual std::shared_ptr<LogHandler> createHandler(const Options &options) = 0;
+
+        /**
+         * Update an existing LogHandler with a new configuration.
+         *
+         * This may create a new LogHandler object, or it may update the existing
+         * LogHandler in place.
+         *
+         * The returned pointer will point to the input handler if it was updated
+         * in place, or will point to a new LogHandler if a new one was created.
+         */
+        virtual std::shared_ptr<LogHandler> updateHandler(
+            const std::shared_ptr<LogHandler> &existingHandler,
+            const Options &options)
+        {
+            // Subclasses may override this with functionality to update an existing
+            // handler in-place.  However, provide a default implementation that
+            // simply calls createHandler() to always create a new handler object.
+            (void)existingHandler;
+            return createHandler(options);
+        }
+    };
+
+} // namespace tinylog
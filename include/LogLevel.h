@@ -24,6 +24,18 @@
 #include "Portability.h"
 #include "StringPiece.h"
 
+/**
+ * TINYLOG_MIN_LEVEL names the lowest LogLevel whose XLOG() statements are
+ * compiled into the program, for instance -DTINYLOG_MIN_LEVEL=INFO.
+ *
+ * Statements below this level are removed at compile time: no code, strings
+ * or static callsite data is emitted for them, and they cannot be enabled at
+ * runtime.  By default everything is compiled in.
+ */
+#ifndef TINYLOG_MIN_LEVEL
+#define TINYLOG_MIN_LEVEL MIN_LEVEL
+#endif
+
 namespace tinylog
 {
     /**
@@ -72,6 +84,18 @@ namespace tinylog
 
     constexpr LogLevel kDefaultLogLevel = LogLevel::INFO;
 
+    namespace
+    {
+        /**
+         * The lowest level of XLOG() statement compiled into this translation
+         * unit.  See TINYLOG_MIN_LEVEL.
+         *
+         * TINYLOG_MIN_LEVEL may differ between translation units, so this
+         * lives in an unnamed namespace rather than in an inline entity.
+         */
+        constexpr LogLevel kMinCompiledLogLevel = LogLevel::TINYLOG_MIN_LEVEL;
+    } // namespace
+
     /*
      * Support adding and subtracting integers from LogLevels, to create slightly
      * adjusted log level values.
@@ -126,4 +150,16 @@ namespace tinylog
                                  : (level >= LogLevel::FATAL);
     }
 
+    /**
+     * Returns true if log statements at this level are compiled in when
+     * minLevel is the lowest level kept, normally kMinCompiledLogLevel.
+     *
+     * Statements at fatal levels are always kept, since removing them would
+     * also remove the crash.
+     */
+    inline constexpr bool isLogLevelCompiledIn(LogLevel level, LogLevel minLevel)
+    {
+        return level >= minLevel || isLogLevelFatal(level);
+    }
+
 } // namespace tinylog
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "StringPiece.h"
+#include "LogLevel.h"
+
+namespace tinylog
+{
+    /**
+     * LogLevelRules is a set of level settings for log categories whose names
+     * match a pattern.
+     *
+     * A pattern is a log category name in which a "*" component matches any
+     * single component, and a "**" component matches any number of
+     * components, including none.  "rpc.*.client" matches "rpc.foo.client",
+     * and "db.**" matches "db" and every category below it.  Components may
+     * not otherwise contain '*'.
+     *
+     * The rules are compiled into a trie of pattern components, and names are
+     * matched by walking it one component at a time, following every branch a
+     * wildcard allows.  Matching costs time proportional to the length of the
+     * name, not the number of rules, so LoggerDB can check every category it
+     * creates against hundreds of rules.
+     *
+     * When several rules match a name, the one added last wins.
+     */
+    class LogLevelRules
+    {
+    public:
+        struct Rule
+        {
+            std::string pattern;
+            LogLevel level;
+            bool inherit;
+        };
+
+        LogLevelRules();
+
+        /**
+         * Add a rule, and return it.  The reference is valid until the next
+         * call to add().  A rule with the same pattern as an earlier one
+         * replaces it.
+         *
+         * Throws std::invalid_argument if the pattern has a component that
+         * contains '*' but is neither "*" nor "**".
+         */
+        const Rule &add(tinylog::StringPiece pattern, LogLevel level, bool inherit);
+
+        /**
+         * Return the last added rule that matches a canonical category name,
+         * or nullptr if none does.
+         */
+        const Rule *match(tinylog::StringPiece canonicalName) const;
+
+        bool empty() const { return rules_.empty(); }
+
+    private:
+        static constexpr uint32_t kNone = UINT32_MAX;
+
+        struct Node
+        {
+            /**
+             * The nodes reached by "*" and "**" components.  Nodes reached by
+             * literal components are found in edges_.
+             */
+            uint32_t anyComponent{kNone};
+            uint32_t anyComponents{kNone};
+            /**
+             * True for nodes reached by "**", which stay active for every
+             * further component of the name.
+             */
+            bool repeats{false};
+            /**
+             * The index in rules_ of the rule whose pattern ends here.
+             */
+            uint32_t rule{kNone};
+        };
+
+        /**
+         * A literal component leading from one node to another.
+         */
+        struct Edge
+        {
+            uint32_t parent{kNone};
+            uint32_t child{kNone};
+            size_t hash{0};
+            std::string component;
+        };
+
+        uint32_t getOrAddChild(uint32_t node, tinylog::StringPiece component);
+        uint32_t findChild(
+            uint32_t node, tinylog::StringPiece component, size_t hash) const;
+        size_t edgeIndex(uint32_t node, size_t hash) const;
+        void insertEdge(Edge edge);
+        void addState(std::vector<uint32_t> &states, uint32_t node) const;
+
+        std::vector<Node> nodes_;
+        /**
+         * The literal edges of every node, in one open-addressed table keyed
+         * by parent node and component hash, so following an edge costs one
+         * probe with a component hash computed once per name component.
+         */
+        std::vector<Edge> edges_;
+        size_t numEdges_{0};
+        std::vector<Rule> rules_;
+    };
+
+} // namespace tinylog
@@ -18,11 +18,16 @@
 
 #include <sys/types.h>
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <memory>
 #include <string>
 
 #include "StringPiece.h"
+#include "LogCallsite.h"
 #include "LogLevel.h"
+#include "LogMessageArena.h"
 
 namespace tinylog
 {
@@ -40,24 +45,34 @@ namespace tinylog
     class LogMessage
     {
     public:
+        /**
+         * Construct a LogMessage logged from a statically defined callsite.
+         *
+         * The callsite must outlive the LogMessage; callsites are normally
+         * function-local statics defined by the logging macros.
+         *
+         * The message text is copied into the LogMessage.
+         */
         LogMessage(
             const LogCategory *category,
             LogLevel level,
-            tinylog::StringPiece filename,
-            unsigned int lineNumber,
-            tinylog::StringPiece functionName,
-            std::string &&msg);
+            const LogCallsite *callsite,
+            tinylog::StringPiece msg);
 
+        /**
+         * Construct a LogMessage from a separately specified source location.
+         *
+         * This looks up the matching LogCallsite in the LogCallsiteRegistry,
+         * so it is slightly more expensive than passing a LogCallsite.
+         */
         LogMessage(
             const LogCategory *category,
             LogLevel level,
             tinylog::StringPiece filename,
             unsigned int lineNumber,
             tinylog::StringPiece functionName,
-            tinylog::StringPiece msg)
-            : LogMessage(
-                  category, level, filename, lineNumber, functionName, msg.str()) {}
-        
+            tinylog::StringPiece msg);
+
         /**
          * Construct a LogMessage with an explicit timestamp.
          * This is primarily intended for use in unit tests, so the tests can get
@@ -70,18 +85,36 @@ namespace tinylog
             tinylog::StringPiece filename,
             unsigned int lineNumber,
             tinylog::StringPiece functionName,
-            std::string &&msg);
-        
+            tinylog::StringPiece msg);
+        LogMessage(
+            const LogCategory *category,
+            LogLevel level,
+            std::chrono::system_clock::time_point timestamp,
+            const LogCallsite *callsite,
+            tinylog::StringPiece msg);
+
         const LogCategory* getCategory() const { return category_; }
 
         LogLevel getLevel() const { return level_; }
 
-        tinylog::StringPiece getFileName() const { return filename_; }
-        tinylog::StringPiece getFileBaseName() const;
+        /**
+         * Get the static information about the statement that logged this
+         * message.
+         */
+        const LogCallsite *getCallsite() const { return callsite_; }
+
+        tinylog::StringPiece getFileName() const { return callsite_->getFileName(); }
+        tinylog::StringPiece getFileBaseName() const
+        {
+            return callsite_->getFileBaseName();
+        }
 
-        unsigned int getLineNumber() const { return lineNumber_; }
+        unsigned int getLineNumber() const { return callsite_->getLineNumber(); }
 
-        tinylog::StringPiece getFunctionName() const { return functionName_; }
+        tinylog::StringPiece getFunctionName() const
+        {
+            return callsite_->getFunctionName();
+        }
 
         std::chrono::system_clock::time_point getTimestamp() const
         {
@@ -90,46 +123,95 @@ namespace tinylog
 
         uint64_t getThreadID() const { return threadID_; }
 
-        const std::string &getMessage() const
+        /**
+         * Get the sanitized log message.
+         *
+         * The message is sanitized the first time this, containNewlines() or
+         * getNumNewlines() is called, and the result is cached.  This is safe
+         * to call concurrently from multiple threads.  Handlers that only use
+         * getRawMessage() never pay for sanitization, except for messages too
+         * long to store inline, which are sanitized when they are built.
+         */
+        tinylog::StringPiece getMessage() const
         {
+            ensureSanitized();
             // if no characters needed to be sanitized, message_ will be empty.
             if (message_.empty())
             {
                 return rawMessage_;
             }
+            return message_;
         }
 
-        const std::string &getRawMessage() const { return rawMessage_; }
+        tinylog::StringPiece getRawMessage() const { return rawMessage_; }
 
-        bool containNewlines() const { return numNewlines_ > 0; }
+        bool containNewlines() const { return getNumNewlines() > 0; }
 
-        size_t getNumNewlines() const { return numNewlines_; }
+        size_t getNumNewlines() const
+        {
+            ensureSanitized();
+            return numNewlines_;
+        }
 
-        const std::string& getContexString() const { return contextString_; }
+        tinylog::StringPiece getContexString() const { return contextString_; }
+
+        /**
+         * The number of bytes of message text stored inline in the LogMessage.
+         *
+         * The raw message and context string are stored together inline when
+         * they fit, and otherwise in a single heap block.  The sanitized
+         * message uses whatever inline space they leave over.
+         */
+        static constexpr size_t kInlineCapacity = 256;
 
+        LogMessage(const LogMessage &other);
+        LogMessage &operator=(const LogMessage &) = delete;
 
     private:
-        void sanitizeMessage();
+        enum SanitizeState : uint8_t
+        {
+            UNSANITIZED = 0,
+            SANITIZING = 1,
+            SANITIZED = 2,
+        };
 
-        const LogCategory *const category_{nullptr};
-        LogLevel const level_{static_cast<LogLevel>(0)};
-        uint64_t const threadID_{0};
-        std::chrono::system_clock::time_point const timestamp_;
+        void ensureSanitized() const
+        {
+            if (sanitizeState_.load(std::memory_order_acquire) != SANITIZED)
+            {
+                sanitizeSlow();
+            }
+        }
 
-        /**
-         * The name of the source file that generated this log message.
-         */
-        tinylog::StringPiece const filename_;
+        void sanitizeSlow() const;
+        void sanitizeMessage() const;
 
         /**
-         * The line number in the source file that generated this log message.
+         * Copy the raw message and context string into this LogMessage.
+         *
+         * If they go to the heap, sanitizedLength more bytes are allocated
+         * in the same block for the sanitized message, and a pointer to them
+         * is returned.  Otherwise this returns nullptr.
          */
-        unsigned int const lineNumber_{0};
+        char *storeText(
+            tinylog::StringPiece rawMessage,
+            tinylog::StringPiece context,
+            size_t sanitizedLength);
+        char *allocateSanitized(size_t length) const;
+
+        const LogCategory *const category_{nullptr};
+        LogLevel const level_{static_cast<LogLevel>(0)};
+        uint64_t const threadID_{0};
+        std::chrono::system_clock::time_point const timestamp_;
 
         /**
-         * The name of the function that generated this log message.
+         * The source file, line, function and category name of the statement
+         * that generated this log message.
+         *
+         * The LogCategory itself is still stored in category_, since the same
+         * statement may log to categories in different LoggerDB objects.
          */
-        tinylog::StringPiece const functionName_;
+        const LogCallsite *const callsite_{nullptr};
 
         /**
          * containedNewlines_ counts the number of internal newlines in the message.
@@ -137,8 +219,10 @@ namespace tinylog
          * This allows log handlers that perform special handing of multi-line
          * message to easily detect if a message contais multiple lines or not and
          * size their buffers appropriately.
+         *
+         * This is only valid once sanitizeState_ is SANITIZED.
          */
-        size_t numNewlines_{0};
+        mutable size_t numNewlines_{0};
 
         /**
          * contextString_ contains user defined context information.
@@ -146,7 +230,7 @@ namespace tinylog
          * This can be customized by adding new callback through
          * addLogMessageContexCallback().
          */
-        std::string contextString_;
+        tinylog::StringPiece contextString_;
 
         /**
          * rawMessage_ contains the original message.
@@ -154,7 +238,7 @@ namespace tinylog
          * This may contain arbitrary binary data, including unprintable characters
          * and nul bytes.
          */
-        std::string const rawMessage_;
+        tinylog::StringPiece rawMessage_;
 
         /**
          * message_ contains a sanitized version of the log message.
@@ -163,8 +247,52 @@ namespace tinylog
          * This message may still contain newlines, however. LogHandler classes
          * are responsible for deciding how they want to handle log messages with
          * internal newlines.
+         *
+         * This is only valid once sanitizeState_ is SANITIZED, and is empty if
+         * no characters needed to be sanitized.
+         */
+        mutable tinylog::StringPiece message_;
+
+        /**
+         * The storage that rawMessage_, contextString_ and message_ point into.
+         *
+         * inlineUsed_ is the number of bytes of inlineBuffer_ used by the raw
+         * message and context string; it is 0 if they are in heapBuffer_.
+         * Messages stored in heapBuffer_ are sanitized when they are built,
+         * and their sanitized text follows them in the same block.
+         * sanitizedBuffer_ is only used for an inline message whose sanitized
+         * form does not fit in the rest of inlineBuffer_.  Both heap buffers
+         * come from the LogMessageArena, since copies of large messages
+         * queued to asynchronous handlers are the main source of them.
+         */
+        size_t inlineUsed_{0};
+        LogMessageArena::Ptr heapBuffer_;
+        mutable LogMessageArena::Ptr sanitizedBuffer_;
+        mutable char inlineBuffer_[kInlineCapacity];
+
+        /**
+         * Whether numNewlines_ and message_ have been computed yet.
+         *
+         * The first thread to need them moves this from UNSANITIZED to
+         * SANITIZING, fills them in, and then publishes them by storing
+         * SANITIZED.  Other threads wait for that store.
          */
-        std::string message_;
+        mutable std::atomic<uint8_t> sanitizeState_{UNSANITIZED};
     };
 
+    /**
+     * An immutable, reference-counted LogMessage.
+     *
+     * LogCategory::admitMessage() builds one of these once per message and
+     * shares it between all LogHandlers that need to keep the message.
+     */
+    using SharedLogMessage = std::shared_ptr<const LogMessage>;
+
+    /**
+     * Copy a LogMessage into a SharedLogMessage.
+     *
+     * The copy and its reference count are allocated from the LogMessageArena.
+     */
+    SharedLogMessage makeSharedLogMessage(const LogMessage &message);
+
 } // namespace tinylog
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace tinylog
+{
+    /**
+     * LogMessageArena allocates the out-of-line text of LogMessage objects.
+     *
+     * Each thread carves allocations out of its own slab with a bump pointer,
+     * so allocating takes no locks.  Allocations can be freed from any thread;
+     * this only decrements the slab's count of live allocations.  A slab is
+     * recycled as a whole once its owning thread has moved on to a new slab
+     * and every allocation from it has been freed.
+     *
+     * This suits asynchronous LogHandlers: messages are copied on the logging
+     * thread and freed on the I/O thread in roughly the order they were
+     * allocated, so slabs drain and are reused without going back to malloc.
+     *
+     * Requests larger than kMaxArenaAllocation bytes fall back to malloc.
+     */
+    class LogMessageArena
+    {
+    public:
+        static constexpr size_t kSlabSize = 64 * 1024;
+        static constexpr size_t kAlignment = alignof(void *);
+        static constexpr size_t kMaxArenaAllocation = kSlabSize / 4;
+
+        /**
+         * The maximum number of empty slabs kept for reuse.  Slabs released
+         * beyond this are returned to the system.
+         */
+        static constexpr size_t kMaxFreeSlabs = 64;
+
+        /**
+         * Allocate size bytes of text storage.
+         */
+        static char *allocate(size_t size);
+
+        /**
+         * Free storage returned by allocate().  This may be called from any
+         * thread.
+         */
+        static void deallocate(char *ptr) noexcept;
+
+        /**
+         * The number of slabs currently allocated from the system, including
+         * free slabs waiting for reuse.
+         */
+        static size_t getNumSlabs();
+
+        /**
+         * The number of empty slabs waiting for reuse.
+         */
+        static size_t getNumFreeSlabs();
+
+        struct Deleter
+        {
+            void operator()(char *ptr) const noexcept { deallocate(ptr); }
+        };
+
+        using Ptr = std::unique_ptr<char[], Deleter>;
+
+        static Ptr allocatePtr(size_t size) { return Ptr{allocate(size)}; }
+    };
+
+    /**
+     * A standard allocator backed by LogMessageArena, for objects that are
+     * created on a logging thread and destroyed on an I/O thread.
+     */
+    template <typename T>
+    class LogMessageArenaAllocator
+    {
+    public:
+        using value_type = T;
+
+        LogMessageArenaAllocator() = default;
+        template <typename U>
+        LogMessageArenaAllocator(const LogMessageArenaAllocator<U> &) {}
+
+        T *allocate(size_t n)
+        {
+            static_assert(
+                alignof(T) <= LogMessageArena::kAlignment,
+                "LogMessageArena does not support over-aligned types");
+            return reinterpret_cast<T *>(LogMessageArena::allocate(n * sizeof(T)));
+        }
+
+        void deallocate(T *ptr, size_t) noexcept
+        {
+            LogMessageArena::deallocate(reinterpret_cast<char *>(ptr));
+        }
+
+        template <typename U>
+        bool operator==(const LogMessageArenaAllocator<U> &) const { return true; }
+        template <typename U>
+        bool operator!=(const LogMessageArenaAllocator<U> &) const { return false; }
+    };
+
+} // namespace tinylog
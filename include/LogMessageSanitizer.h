@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "StringPiece.h"
+
+namespace tinylog
+{
+    namespace detail
+    {
+        /**
+         * The instruction sets that the message sanitizer has kernels for.
+         */
+        enum class SanitizerIsa
+        {
+            SCALAR,
+            SSE2,
+            AVX2,
+        };
+
+        struct MessageScanResult
+        {
+            /**
+             * The number of bytes that must be emitted as a \xNN escape.
+             * These are control characters other than '\n' and '\t', and 0x7f.
+             */
+            size_t numEscaped{0};
+            /**
+             * The number of '\n' characters.
+             */
+            size_t numNewlines{0};
+        };
+
+        /**
+         * Get the fastest sanitizer kernel supported by the current CPU.
+         *
+         * This is checked once and cached.
+         */
+        SanitizerIsa getBestSanitizerIsa();
+
+        bool isSanitizerIsaSupported(SanitizerIsa isa);
+
+        const char *getSanitizerIsaName(SanitizerIsa isa);
+
+        /**
+         * Count the bytes of msg that need escaping, and the newlines in it.
+         *
+         * The sanitized message is msg.size() + 3 * numEscaped bytes long.
+         */
+        MessageScanResult scanMessage(tinylog::StringPiece msg);
+        MessageScanResult scanMessage(tinylog::StringPiece msg, SanitizerIsa isa);
+
+        /**
+         * Write the sanitized form of msg to out, and return a pointer just
+         * past the last byte written.
+         *
+         * out must have room for msg.size() + 3 * numEscaped bytes, using the
+         * numEscaped computed by scanMessage().
+         */
+        char *escapeMessage(tinylog::StringPiece msg, char *out);
+        char *escapeMessage(tinylog::StringPiece msg, char *out, SanitizerIsa isa);
+
+    } // namespace detail
+
+} // namespace tinylog
@@ -16,6 +16,10 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
 #include "StringPiece.h"
 
 namespace tinylog
@@ -39,13 +43,133 @@ namespace tinylog
          */
         static std::string canonicalize(tinylog::StringPiece input);
 
+        /**
+         * Write the canonical form of input to out, and return its size.
+         *
+         * out must have room for canonicalSize(input) characters; input.size()
+         * is always enough.  This applies the same rules as canonicalize(), and
+         * is constexpr so that names known at compile time, such as the source
+         * file names used by XLOG(), can be canonicalized at compile time.
+         */
+        static constexpr size_t canonicalizeTo(tinylog::StringPiece input, char *out)
+        {
+            // Ignore trailing category separator characters
+            size_t end = input.size();
+            while (end > 0 && isSeparator(input[end - 1]))
+            {
+                --end;
+            }
+
+            size_t size = 0;
+            bool ignoreSeparator = true;
+            for (size_t idx = 0; idx < end; ++idx)
+            {
+                if (isSeparator(input[idx]))
+                {
+                    if (ignoreSeparator)
+                    {
+                        continue;
+                    }
+                    out[size++] = '.';
+                    ignoreSeparator = true;
+                }
+                else
+                {
+                    out[size++] = input[idx];
+                    ignoreSeparator = false;
+                }
+            }
+            return size;
+        }
+
+        /**
+         * Get the size of the canonical form of a log name.
+         *
+         * XLOG() uses this to size the category names it builds at compile
+         * time.
+         */
+        static constexpr size_t canonicalSize(tinylog::StringPiece input)
+        {
+            size_t end = input.size();
+            while (end > 0 && isSeparator(input[end - 1]))
+            {
+                --end;
+            }
+
+            size_t size = 0;
+            bool ignoreSeparator = true;
+            for (size_t idx = 0; idx < end; ++idx)
+            {
+                bool separator = isSeparator(input[idx]);
+                if (!(separator && ignoreSeparator))
+                {
+                    ++size;
+                }
+                ignoreSeparator = separator;
+            }
+            return size;
+        }
+
         /**
          * Hash a log name.
          * 
          * The log name does not need to be pre-canonicalized.
          * The hash for equivalent log names will always be equal.
+         *
+         * This is constexpr so that XLOG() statements can hash their category
+         * name at compile time.
+         */
+        static constexpr size_t hash(tinylog::StringPiece name)
+        {
+            // Code based on StringPiece::hash(), but which ignores leading and
+            // trailing category separator characters, as well as multiple
+            // consecutive separator characters, so equivalent names result in
+            // the same hash.
+            uint32_t hash = 5381;
+
+            size_t end = name.size();
+            while (end > 0 && isSeparator(name[end - 1]))
+            {
+                --end;
+            }
+
+            bool ignoreSeparator = true;
+            for (size_t idx = 0; idx < end; ++idx)
+            {
+                uint8_t value = 0;
+                if (isSeparator(name[idx]))
+                {
+                    if (ignoreSeparator)
+                    {
+                        continue;
+                    }
+                    value = '.';
+                    ignoreSeparator = true;
+                }
+                else
+                {
+                    value = static_cast<uint8_t>(name[idx]);
+                    ignoreSeparator = false;
+                }
+                hash = ((hash << 5) + hash) + value;
+            }
+            return hash;
+        }
+
+        /**
+         * Hash a log name that is already in canonical form.
+         *
+         * This returns the same value as hash(), but has no separators to
+         * skip over, so names longer than 32 bytes are hashed a word at a
+         * time rather than a byte at a time.
+         */
+        static size_t hashCanonical(tinylog::StringPiece name);
+
+        /**
+         * Return true if name is already in canonical form, i.e. if
+         * canonicalize() would return it unchanged.
          */
-        static size_t hash(tinylog::StringPiece name);
+        static bool isCanonical(tinylog::StringPiece name);
 
         /**
          * Compare two log names.
@@ -69,6 +193,14 @@ namespace tinylog
          */
         static tinylog::StringPiece getParent(tinylog::StringPiece name);
 
+        /**
+         * Is c a category separator character?
+         */
+        static constexpr bool isSeparator(char c)
+        {
+            return c == '.' || c == '/';
+        }
+
         /**
          * Hash functor that can be used with standard library containers.
          */
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "LogLevel.h"
+#include "StringPiece.h"
+
+namespace tinylog
+{
+    /**
+     * What an asynchronous LogHandler does with a new message when its queue
+     * is full.
+     */
+    enum class LogOverflowPolicy
+    {
+        // Wait until the I/O thread frees up space.  No message is ever lost,
+        // but a slow LogWriter can stall the logging threads.
+        BLOCK,
+        // Discard the message being logged.
+        DROP_NEWEST,
+        // Discard the oldest queued message to make room for the new one.
+        DROP_OLDEST,
+        // Discard the message being logged if it is below the handler's drop
+        // threshold level, otherwise wait like BLOCK.  With the default
+        // threshold of LogLevel::ERROR, ERROR and CRITICAL messages are never
+        // lost.
+        DROP_BELOW_LEVEL,
+    };
+
+    /**
+     * Parse a LogOverflowPolicy from its configuration name ("block",
+     * "drop_newest", "drop_oldest" or "drop_below_level").
+     *
+     * Throws std::invalid_argument if the name is not recognized.
+     */
+    LogOverflowPolicy stringToLogOverflowPolicy(tinylog::StringPiece name);
+
+    /**
+     * Get the configuration name of a LogOverflowPolicy.
+     */
+    tinylog::StringPiece logOverflowPolicyToString(LogOverflowPolicy policy);
+
+    /**
+     * LogDropCounters tracks messages discarded by an asynchronous LogHandler,
+     * broken down by log level.
+     *
+     * Drops are recorded by the logging threads.  The handler's I/O thread
+     * periodically calls takeDropSummary() to write a record of the gap into
+     * the output stream.
+     */
+    class LogDropCounters
+    {
+    public:
+        /**
+         * Record that a message at the given level was dropped.
+         */
+        void recordDrop(LogLevel level);
+
+        /**
+         * Returns true if there are drops that have not yet been reported by
+         * takeDropSummary().
+         */
+        bool hasUnreported() const
+        {
+            return unreported_.load(std::memory_order_relaxed) != 0;
+        }
+
+        /**
+         * Get the total number of messages dropped at levels that fall in the
+         * same bucket as the given level, since the counters were created.
+         *
+         * Levels are bucketed on the named LogLevel values: for example every
+         * level from DBG up to (but not including) INFO is counted as DBG.
+         */
+        uint64_t getNumDropped(LogLevel level) const;
+
+        /**
+         * Get the total number of messages dropped since the counters were
+         * created.
+         */
+        uint64_t getNumDropped() const;
+
+        /**
+         * Consume the drops recorded since the last call and return a line such
+         * as "tinylog: 12 log messages dropped (DEBUG: 10, INFO: 2)\n".
+         *
+         * Returns an empty string if nothing has been dropped since.
+         */
+        std::string takeDropSummary();
+
+    private:
+        enum Bucket : size_t
+        {
+            BUCKET_DBG,
+            BUCKET_INFO,
+            BUCKET_WARN,
+            BUCKET_ERROR,
+            BUCKET_CRITICAL,
+            BUCKET_FATAL,
+            NUM_BUCKETS,
+        };
+
+        static Bucket getBucket(LogLevel level);
+
+        std::array<std::atomic<uint64_t>, NUM_BUCKETS> total_{};
+        std::array<std::atomic<uint64_t>, NUM_BUCKETS> pending_{};
+        std::atomic<uint64_t> unreported_{0};
+    };
+
+} // namespace tinylog
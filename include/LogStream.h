@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+#include "StringPiece.h"
+
+namespace tinylog
+{
+    /**
+     * A streambuf that writes into a growable buffer.
+     *
+     * Unlike std::stringbuf the buffer is kept when the LogStreamBuffer is
+     * reset, so a LogStreamBuffer that is reused for many messages stops
+     * allocating once it has grown to fit them.
+     */
+    class LogStreamBuffer : public std::streambuf
+    {
+    public:
+        LogStreamBuffer();
+
+        bool empty() const { return pbase() == pptr(); }
+
+        /**
+         * The text written since the last reset().  This is invalidated by
+         * further writes.
+         */
+        tinylog::StringPiece getText() const
+        {
+            return tinylog::StringPiece{pbase(), static_cast<int>(pptr() - pbase())};
+        }
+
+        /**
+         * Discard the text written so far.
+         *
+         * If the buffer grew beyond kMaxRetainedCapacity it is shrunk back, so
+         * one huge message doesn't pin its memory for the life of the thread.
+         */
+        void reset();
+
+        int_type overflow(int_type ch) override;
+        std::streamsize xsputn(const char *s, std::streamsize n) override;
+
+        static constexpr size_t kInitialCapacity = 256;
+        static constexpr size_t kMaxRetainedCapacity = 64 * 1024;
+
+    private:
+        void grow(size_t minExtra);
+        void advance(size_t n);
+
+        std::string str_;
+    };
+
+    /**
+     * The std::ostream that stream-style log statements write to.
+     *
+     * Constructing a std::ostream is relatively expensive, since it sets up
+     * its locale, so LogStream objects are pooled per thread and reused: see
+     * acquire() and release().
+     */
+    class LogStream : public std::ostream
+    {
+    public:
+        LogStream();
+        ~LogStream();
+
+        LogStream(const LogStream &) = delete;
+        LogStream &operator=(const LogStream &) = delete;
+
+        bool empty() const { return buffer_.empty(); }
+        tinylog::StringPiece getText() const { return buffer_.getText(); }
+
+        /**
+         * Get a LogStream for a new message.
+         *
+         * Each thread keeps a few LogStreams, so a log statement evaluated
+         * while building another one's message gets its own stream; deeper
+         * nesting falls back to a heap-allocated stream.  The stream must be
+         * given back with release() on the same thread.
+         */
+        static LogStream *acquire();
+        static void release(LogStream *stream) noexcept;
+
+    private:
+        /**
+         * Clear the text and restore the formatting state a fresh
+         * std::ostream would have.
+         */
+        void reset();
+
+        LogStreamBuffer buffer_;
+        std::ios_base::fmtflags const defaultFlags_;
+        bool pooled_{false};
+    };
+
+} // namespace tinylog
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <ostream>
+
+#include "LogCallsite.h"
+#include "LogLevel.h"
+#include "LogStream.h"
+#include "StringPiece.h"
+
+namespace tinylog
+{
+    class LogCategory;
+
+    /**
+     * LogStreamProcessor receives a stream-style log statement's message and
+     * logs it when the statement ends.
+     *
+     * It is created as a temporary by TINYLOG_STREAM(), so the message is
+     * logged when the temporary is destroyed at the end of the full
+     * expression, after every operator<< has run.
+     *
+     * The stream is taken from the calling thread's LogStream pool when the
+     * first value is written and returned to it afterwards.  If an argument
+     * of the statement itself logs a stream-style message, that nested
+     * statement gets a different stream from the pool, so neither message is
+     * corrupted.
+     */
+    class LogStreamProcessor
+    {
+    public:
+        LogStreamProcessor(
+            const LogCategory *category,
+            LogLevel level,
+            const LogCallsite *callsite) noexcept
+            : category_{category}, level_{level}, callsite_{callsite} {}
+
+        LogStreamProcessor(
+            const LogCategory *category,
+            LogLevel level,
+            tinylog::StringPiece filename,
+            unsigned int lineNumber,
+            tinylog::StringPiece functionName) noexcept
+            : category_{category},
+              level_{level},
+              filename_{filename},
+              lineNumber_{lineNumber},
+              functionName_{functionName} {}
+
+        ~LogStreamProcessor() noexcept;
+
+        LogStreamProcessor(const LogStreamProcessor &) = delete;
+        LogStreamProcessor &operator=(const LogStreamProcessor &) = delete;
+
+        /**
+         * Get the stream for this statement's message, after writing args to
+         * it.
+         */
+        template <typename... Args>
+        std::ostream &stream(const Args &...args)
+        {
+            if (!stream_)
+            {
+                stream_ = LogStream::acquire();
+            }
+            (append(args), ...);
+            return *stream_;
+        }
+
+    private:
+        void logNow() noexcept;
+
+        template <typename T>
+        void append(const T &value)
+        {
+            *stream_ << value;
+        }
+        void append(tinylog::StringPiece value)
+        {
+            stream_->write(value.data(), value.size());
+        }
+
+        const LogCategory *const category_;
+        LogLevel const level_;
+        const LogCallsite *const callsite_{nullptr};
+        tinylog::StringPiece const filename_;
+        unsigned int const lineNumber_{0};
+        tinylog::StringPiece const functionName_;
+        LogStream *stream_{nullptr};
+    };
+
+    /**
+     * LogStreamVoidify turns the type of a stream-style log statement into
+     * void, so that TINYLOG_STREAM() can put it in a conditional expression
+     * whose other branch is (void)0.
+     *
+     * operator& binds more loosely than operator<< and more tightly than ?:,
+     * so it applies to the stream after all the values have been written.
+     */
+    class LogStreamVoidify
+    {
+    public:
+        void operator&(std::ostream &) {}
+    };
+
+} // namespace tinylog
+
+/**
+ * Log a stream-style message to a LogCategory:
+ *
+ *   TINYLOG_STREAM(category, LogLevel::INFO) << "x=" << x;
+ *
+ * The arguments are only evaluated if the category is enabled for the
+ * level.
+ */
+#define TINYLOG_STREAM(category, level)                                  \
+    (!(category)->logCheck(level))                                       \
+        ? (void)0                                                        \
+        : ::tinylog::LogStreamVoidify{} &                                \
+              ::tinylog::LogStreamProcessor{                             \
+                  (category), (level), __FILE__, __LINE__, __func__}     \
+                  .stream()
@@ -16,16 +16,24 @@
 
 #pragma once
 
+#include <array>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include <atomic>
 #include <functional>
 #include <mutex>
+#include <shared_mutex>
 
 #include "StringPiece.h"
+#include "LogCategoryMap.h"
+#include "LogClock.h"
+#include "LogLevelRules.h"
 #include "LogName.h"
+#include "Synchronized.h"
 
 namespace tinylog
 {
@@ -41,7 +49,7 @@ namespace tinylog
      */
     class LoggerDB
     {
-        using ContextCallback = std::function<std::string() const>;
+        using ContextCallback = std::function<std::string()>;
 
     public:
         /**
@@ -82,6 +90,49 @@ namespace tinylog
         void setLevel(tinylog::StringPiece name, LogLevel level, bool inherit = true);
         void setLevel(LogCategory *category, LogLevel level, bool inherit = true);
 
+        /**
+         * Set the log level of every category whose name matches a pattern,
+         * including categories that are created later.
+         *
+         * In a pattern, a "*" component matches any single component of a
+         * category name, and a "**" component matches any number of them,
+         * including none.  For example, "rpc.*.client" matches
+         * "rpc.foo.client", and "db.**" matches "db" and every category below
+         * it.  When several rules match a category, the one added last wins.
+         *
+         * A rule sets a category's level when the rule is added and when the
+         * category is created.  Calling setLevel() on a category afterwards
+         * overrides it.
+         *
+         * Throws std::invalid_argument if a pattern component contains '*'
+         * but is neither "*" nor "**".
+         */
+        void addLevelRule(
+            tinylog::StringPiece pattern, LogLevel level, bool inherit = true);
+
+        /**
+         * Set the number of threads a level change may use to update the
+         * effective levels of the categories below it.
+         *
+         * This defaults to 1.  Larger values only take effect when a change
+         * reaches a subtree of more than about 16k categories, which is then
+         * split between the threads.
+         */
+        void setLevelPropagationThreads(size_t numThreads);
+        size_t getLevelPropagationThreads() const
+        {
+            return levelPropagationThreads_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Rebuild the handler dispatch lists of a category and all of its
+         * descendants.
+         *
+         * LogCategory calls this after its handlers or its propagation level
+         * change, since those changes affect every category below it.
+         */
+        void updateDispatchLists(LogCategory *category);
+
         /**
          * Get a LogConfig object describing the current state of the LoggerDB.
          */
@@ -167,12 +218,20 @@ namespace tinylog
          * statement.
          *
          * Returns the current effective LogLevel of the category.
+         *
+         * The second form takes the precomputed LogName::hash() of
+         * categoryName, which XLOG() statements work out at compile time.
          */
         LogLevel xlogInit(
             tinylog::StringPiece categoryName,
             std::atomic<LogLevel> *xlogCategoryLevel,
             LogCategory **xlogCategory);
-        LogLevel xlogInitCategory(
+        LogLevel xlogInit(
+            tinylog::StringPiece categoryName,
+            size_t categoryHash,
+            std::atomic<LogLevel> *xlogCategoryLevel,
+            LogCategory **xlogCategory);
+        LogCategory *xlogInitCategory(
             tinylog::StringPiece categoryName,
             LogCategory **xlogCategory,
             std::atomic<bool> *isInitialized);
@@ -210,6 +269,32 @@ namespace tinylog
          */
         std::string getContextString() const;
 
+        /**
+         * Set the clock used to timestamp log messages created in this
+         * LoggerDB.
+         *
+         * If clock is null the default SystemLogClock is used.
+         *
+         * Clocks replaced by a later setClock() call are kept alive until the
+         * LoggerDB is destroyed, since messages being constructed
+         * concurrently may still be reading them.
+         */
+        void setClock(std::shared_ptr<LogClock> clock);
+        void setClock(LogClockType type);
+
+        /**
+         * Get the clock used to timestamp log messages.
+         */
+        LogClock &getClock() const
+        {
+            return *clock_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * Get the current time from this LoggerDB's clock.
+         */
+        LogClock::time_point now() const { return getClock().now(); }
+
         /**
          * internalWarning() is used to report a problem when something goes wrong
          * internally in the logging library.
@@ -225,8 +310,9 @@ namespace tinylog
         static void internalWarning(
             tinylog::StringPiece file, int lineNumber, Args &&...args) noexcept
         {
-            internalWarningImpl(
-                file, lineNumber, std::string &);
+            std::ostringstream os;
+            (os << ... << std::forward<Args>(args));
+            internalWarningImpl(file, lineNumber, os.str());
         }
 
         using InternalWarningHandler =
@@ -247,11 +333,19 @@ namespace tinylog
         static void setInternalWarningHandler(InternalWarningHandler handler);
 
     private:
-        using LoggerNameMap = std::unordered_map<
-            tinylog::StringPiece,
-            std::unique_ptr<LogCategory>,
-            LogName::Hash,
-            LogName::Equals>;
+        using LoggerNameMap = LogCategoryMap;
+
+        /**
+         * One shard of the category map.  Shards are kept on separate cache
+         * lines so that threads creating categories in different shards do
+         * not contend.
+         */
+        struct alignas(64) NameShard
+        {
+            tinylog::Synchronized<LoggerNameMap, std::mutex> loggersByName;
+        };
+
+        static constexpr size_t kNumNameShards = 16;
 
         using HandlerFactoryMap =
             std::unordered_map<std::string, std::unique_ptr<LogHandlerFactory>>;
@@ -271,7 +365,7 @@ namespace tinylog
 
         private:
             class CallbacksObj;
-            std::atomic<CallbacksObj *> callbacks_(nullptr);
+            std::atomic<CallbacksObj *> callbacks_{nullptr};
             std::mutex writeMutex_;
         };
 
@@ -280,11 +374,11 @@ namespace tinylog
         LoggerDB &operator=(LoggerDB const &) = delete;
 
         LoggerDB();
-        LogCategory *getOrCreateCategoryLocked(
-            LoggerNameMap &loggersByName, tinylog::StringPiece name);
+        NameShard &getShard(size_t hash);
+        LogCategory *getOrCreateCategoryLocked(const CategoryKey &key);
         LogCategory *createCategoryLocked(
             LoggerNameMap &loggersByName,
-            tinylog::StringPiece name,
+            const CategoryKey &key,
             LogCategory *parent);
 
         using NewHandlerMap =
@@ -312,17 +406,47 @@ namespace tinylog
             tinylog::StringPiece filename, int lineNumber, std::string &&msg) noexcept;
         
         /**
-         * A map of LogCategory objects by name.
-         * 
+         * Protects the shape of the category tree and the levels stored in it:
+         * the firstChild_ lists, each category's level, and the XLOG() level
+         * pointers registered with it.
+         *
+         * Creating a category, which only adds to the tree, holds this in
+         * shared mode, so many threads can create categories at once.
+         * Changing a level holds it exclusively, so that a category being
+         * created cannot miss a change to its parent's effective level.
+         */
+        std::shared_mutex treeMutex_;
+
+        std::atomic<size_t> levelPropagationThreads_{1};
+
+        /**
+         * The rules added by addLevelRule().  Protected by treeMutex_: rules
+         * are added with it held exclusively, and matched against new
+         * categories with it held in shared mode.
+         */
+        LogLevelRules levelRules_;
+
+        /**
+         * A map of LogCategory objects by name, sharded by name hash.
+         *
          * Lookups can be performed using arbitrary StringPiece values that do not
          * have to be in canonical form.
+         *
+         * A shard's lock serializes the creation of the categories in it, and
+         * the registration of XLOG() levels with them.  Looking up an existing
+         * category does not take it: LogCategoryMap allows find() to run
+         * concurrently with insertions, so lookups use unsafeGetUnlocked().
+         *
+         * Creating a category first creates its parent, then takes the lock
+         * of the category's own shard.  No more than one shard lock is ever
+         * held at a time, and treeMutex_ must be held before taking one.
          */
-        tinylog::Synchronized<LoggerNameMap> loggersByName_;
+        std::array<NameShard, kNumNameShards> loggersByName_;
 
         /**
          * The LogHandlers and LogHandlerFactories.
          * 
-         * For lock ordering purposes, if you need to acquire both the loggersByName_
+         * For lock ordering purposes, if you need to acquire both the treeMutex_
          * and handlerInfo_ locks, the handlerInfo_ lock must be acquired first.
          */
         tinylog::Synchronized<HandlerInfo> handlerInfo_;
@@ -333,7 +457,17 @@ namespace tinylog
          * Exceptions from the callbacks are catched and reflected in corresponding
          * position in log entries
          */
-        ContextCallbackList caontextCallbacks_;
+        ContextCallbackList contextCallbacks_;
+
+        /**
+         * The clock used to timestamp log messages.
+         *
+         * clocks_ owns every clock that has been installed with setClock().
+         */
+        std::atomic<LogClock *> clock_{&SystemLogClock::instance()};
+        std::mutex clockMutex_;
+        std::vector<std::shared_ptr<LogClock>> clocks_;
+
         static std::atomic<InternalWarningHandler> warningHandler_;
     };
 
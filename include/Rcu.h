@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace tinylog
+{
+    /**
+     * RcuDomain is a minimal read-copy-update domain.
+     *
+     * Readers hold an RcuReader while they use objects published through
+     * atomic pointers.  Entering and leaving a read-side section is wait-free:
+     * one increment and one decrement of a counter chosen by thread, so
+     * readers never block on writers or on each other.
+     *
+     * A writer publishes a new object with an atomic store, hands the old one
+     * to retire(), and later calls synchronize().  synchronize() waits for
+     * every reader that might still see the old object, then destroys what
+     * was retired before the call.  Writers wait for readers; readers never
+     * wait for writers.
+     *
+     * This uses the two-counter scheme of sleepable RCU: readers count
+     * themselves against the current epoch's parity, and synchronize() flips
+     * the parity and waits for the old counters to drain.  Read-side sections
+     * may nest, but must not call synchronize(), which would wait for
+     * itself.
+     *
+     * This is a small subset of folly's RCU.
+     */
+    class RcuDomain
+    {
+    public:
+        RcuDomain() = default;
+        ~RcuDomain();
+
+        RcuDomain(const RcuDomain &) = delete;
+        RcuDomain &operator=(const RcuDomain &) = delete;
+
+        /**
+         * The domain used by the logging library.
+         */
+        static RcuDomain &getDefault();
+
+        /**
+         * Destroy object once no reader can be using it any more, that is
+         * during the next call to synchronize().
+         */
+        template <typename T>
+        void retire(std::unique_ptr<T> object)
+        {
+            if (object)
+            {
+                std::lock_guard<std::mutex> lock(retiredMutex_);
+                retired_.emplace_back(std::move(object));
+            }
+        }
+
+        /**
+         * Wait until every read-side section that started before this call
+         * has finished, then destroy the objects retired before this call.
+         */
+        void synchronize();
+
+    private:
+        friend class RcuReader;
+
+        static constexpr size_t kNumStripes = 32;
+
+        /**
+         * Reader counts for one group of threads, one per epoch parity.
+         * These are kept on separate cache lines so readers on different
+         * threads rarely share one.
+         */
+        struct alignas(64) Stripe
+        {
+            std::atomic<int64_t> readers[2] = {};
+        };
+
+        static size_t getStripeIndex();
+
+        /**
+         * Count a reader, and return the counter to decrement when it is
+         * done.
+         */
+        std::atomic<int64_t> *lock() noexcept
+        {
+            auto parity = epoch_.load(std::memory_order_relaxed) & 1;
+            auto *counter = &stripes_[getStripeIndex()].readers[parity];
+            counter->fetch_add(1, std::memory_order_seq_cst);
+            return counter;
+        }
+
+        void waitForReaders(unsigned int parity);
+
+        std::atomic<uint64_t> epoch_{0};
+        Stripe stripes_[kNumStripes];
+
+        /**
+         * Serializes synchronize() calls, since each one flips epoch_.
+         */
+        std::mutex synchronizeMutex_;
+
+        std::mutex retiredMutex_;
+        std::vector<std::shared_ptr<const void>> retired_;
+    };
+
+    /**
+     * An RAII read-side critical section in an RcuDomain.
+     *
+     * Objects loaded from pointers the domain protects may be used until the
+     * RcuReader is destroyed.
+     */
+    class RcuReader
+    {
+    public:
+        explicit RcuReader(RcuDomain &domain = RcuDomain::getDefault()) noexcept
+            : counter_{domain.lock()} {}
+
+        ~RcuReader() { counter_->fetch_sub(1, std::memory_order_release); }
+
+        RcuReader(const RcuReader &) = delete;
+        RcuReader &operator=(const RcuReader &) = delete;
+
+    private:
+        std::atomic<int64_t> *const counter_;
+    };
+
+} // namespace tinylog
@@ -27,24 +27,24 @@ namespace tinylog
         {
         }
 
-        StringPiece(const char *offset, int len)
+        constexpr StringPiece(const char *offset, int len)
             : ptr_(offset),
               length_(len)
         {
         }
 
-        const char *data() const { return ptr_; }
-        int size() const { return length_; }
-        bool empty() const { return length_ == 0; }
-        const char *begin() const { return ptr_; }
-        const char *end() const { return ptr_ + length_; }
+        constexpr const char *data() const { return ptr_; }
+        constexpr int size() const { return length_; }
+        constexpr bool empty() const { return length_ == 0; }
+        constexpr const char *begin() const { return ptr_; }
+        constexpr const char *end() const { return ptr_ + length_; }
 
         const char &front() { return *ptr_; }
         const char &back() { return *(ptr_ + length_ - 1); }
 
         std::string str() const { return std::string(data(), size()); }
 
-        char operator[](int i) const { return ptr_[i]; }
+        constexpr char operator[](int i) const { return ptr_[i]; }
 
         void remove_prefix(size_t n)
         {
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+
+namespace tinylog
+{
+    /**
+     * Synchronized pairs a value with the reader-writer lock that protects it,
+     * so the value can only be reached while the lock is held.
+     *
+     * wlock() returns a LockedPtr holding the lock exclusively, and rlock()
+     * returns a ConstLockedPtr holding it in shared mode.  The lock is
+     * released when the returned pointer is destroyed:
+     *
+     *   Synchronized<std::vector<int>> numbers;
+     *   numbers.wlock()->push_back(1);
+     *   auto size = numbers.rlock()->size();
+     *
+     * This is a small subset of folly::Synchronized.
+     */
+    template <class T, class Mutex = std::shared_mutex>
+    class Synchronized
+    {
+    public:
+        class LockedPtr
+        {
+        public:
+            T *operator->() const { return value_; }
+            T &operator*() const { return *value_; }
+
+        private:
+            friend class Synchronized;
+
+            LockedPtr(T *value, Mutex &mutex) : value_{value}, lock_{mutex} {}
+
+            T *value_;
+            std::unique_lock<Mutex> lock_;
+        };
+
+        class ConstLockedPtr
+        {
+        public:
+            const T *operator->() const { return value_; }
+            const T &operator*() const { return *value_; }
+
+        private:
+            friend class Synchronized;
+
+            ConstLockedPtr(const T *value, Mutex &mutex)
+                : value_{value}, lock_{mutex} {}
+
+            const T *value_;
+            std::shared_lock<Mutex> lock_;
+        };
+
+        template <typename... Args>
+        explicit Synchronized(Args &&...args)
+            : value_(std::forward<Args>(args)...) {}
+
+        Synchronized(const Synchronized &) = delete;
+        Synchronized &operator=(const Synchronized &) = delete;
+
+        LockedPtr wlock() { return LockedPtr{&value_, mutex_}; }
+        ConstLockedPtr rlock() const { return ConstLockedPtr{&value_, mutex_}; }
+
+        /**
+         * Access the value without taking the lock.
+         *
+         * This is only safe for operations that T itself makes safe to run
+         * concurrently with the ones done under the lock.
+         */
+        T &unsafeGetUnlocked() { return value_; }
+        const T &unsafeGetUnlocked() const { return value_; }
+
+    private:
+        mutable Mutex mutex_;
+        T value_;
+    };
+
+} // namespace tinylog
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace tinylog
+{
+    namespace detail
+    {
+        /**
+         * A small pool of N reusable T objects for each thread.
+         *
+         * A thread's pool is allocated the first time it calls tryAcquire(),
+         * and freed when the thread exits.  The thread_local state that
+         * points to it is trivially destructible, so it stays usable from
+         * other thread_local destructors that run after the pool is gone:
+         * tryAcquire() then returns nullptr, and release() ignores objects
+         * that were freed along with the pool.
+         *
+         * Objects must be released on the thread that acquired them.  All
+         * users of the same T and N share one pool per thread.
+         */
+        template <typename T, size_t N>
+        class ThreadLocalPool
+        {
+        public:
+            /**
+             * Get an unused object from the current thread's pool, or nullptr
+             * if they are all in use or the thread is exiting.
+             */
+            static T *tryAcquire()
+            {
+                auto &state = state_;
+                if (!state.pool && !state.exited)
+                {
+                    static thread_local Releaser releaser;
+                    (void)releaser;
+                    state.pool = new Pool();
+                }
+                if (state.pool)
+                {
+                    for (size_t n = 0; n < N; ++n)
+                    {
+                        if (!state.pool->inUse[n])
+                        {
+                            state.pool->inUse[n] = true;
+                            return &state.pool->objects[n];
+                        }
+                    }
+                }
+                return nullptr;
+            }
+
+            /**
+             * Give back an object returned by tryAcquire().
+             *
+             * reset(object) prepares the object for reuse.  It is not called
+             * if the object was already destroyed with the pool.
+             */
+            template <typename Reset>
+            static void release(T *object, Reset &&reset) noexcept
+            {
+                auto *pool = state_.pool;
+                if (!pool)
+                {
+                    return;
+                }
+                reset(*object);
+                pool->inUse[object - pool->objects] = false;
+            }
+
+        private:
+            struct Pool
+            {
+                T objects[N];
+                bool inUse[N]{};
+            };
+
+            struct State
+            {
+                Pool *pool{nullptr};
+                bool exited{false};
+            };
+
+            struct Releaser
+            {
+                ~Releaser()
+                {
+                    auto *pool = state_.pool;
+                    state_.pool = nullptr;
+                    state_.exited = true;
+                    delete pool;
+                }
+            };
+
+            static thread_local State state_;
+        };
+
+        template <typename T, size_t N>
+        thread_local typename ThreadLocalPool<T, N>::State ThreadLocalPool<T, N>::state_;
+
+    } // namespace detail
+
+} // namespace tinylog
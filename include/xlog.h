@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+
+#include "Format.h"
+#include "LogCallsite.h"
+#include "LogLevel.h"
+#include "LogName.h"
+#include "LogStreamProcessor.h"
+#include "StringPiece.h"
+
+/*
+ * This file contains the XLOG() and XLOGF() macros.
+ *
+ * These macros make it easy to use the logging library without having to
+ * manually pick log category names.  All XLOG() and XLOGF() statements in a
+ * given file automatically use a LogCategory based on the current file name.
+ *
+ * For instance, in src/foo/bar.cc, the default log category name will be
+ * "src.foo.bar.cc".
+ *
+ * The category name and its hash are worked out at compile time, so the
+ * first run of a statement only has to look the category up.
+ *
+ * Each XLOG() statement has its own statically allocated XlogCallsite that
+ * caches the effective level of its category, so checking whether a
+ * statement is enabled costs one relaxed atomic load and a comparison.
+ */
+
+/**
+ * Log a message to this file's default log category.
+ *
+ * By default the log category name is automatically picked based on the
+ * current filename.
+ *
+ * The level argument is the name of a LogLevel value, without the
+ * "LogLevel::" prefix.  The remaining arguments are written to the message
+ * with operator<<, and more can be appended to the statement:
+ *
+ *   XLOG(INFO, "request ", id, " took ", ms, "ms");
+ *   XLOG(DBG) << "cache size: " << cache.size();
+ *
+ * None of the arguments are evaluated if the statement is disabled.
+ */
+#define XLOG(level, ...) XLOG_IF(level, true, __VA_ARGS__)
+
+/**
+ * Log a message if and only if the specified condition predicate evaluates
+ * to true.  The condition is only evaluated if the log level is enabled.
+ */
+#define XLOG_IF(level, cond, ...) \
+    XLOG_IMPL(::tinylog::LogLevel::level, cond, __VA_ARGS__)
+
+/**
+ * Log a message with tinylog::format() style formatting.
+ *
+ * The format string must be a string literal, and is checked against the
+ * argument types at compile time:
+ *
+ *   XLOGF(WARN, "retrying {} after {}ms", name, delayMs);
+ */
+#define XLOGF(level, fmt, ...) XLOGF_IF(level, true, fmt, ##__VA_ARGS__)
+
+/**
+ * Log a formatted message if and only if the specified condition predicate
+ * evaluates to true.  The condition is only evaluated if the log level is
+ * enabled.
+ */
+#define XLOGF_IF(level, cond, fmt, ...)                          \
+    XLOG_IMPL(                                                   \
+        ::tinylog::LogLevel::level,                              \
+        cond,                                                    \
+        ::tinylog::format(TINYLOG_FMT(fmt), ##__VA_ARGS__).piece())
+
+/**
+ * Check if an XLOG() statement with the given log level would be enabled.
+ *
+ * The level parameter must be an unqualified LogLevel enum value.
+ *
+ * The lambda is generic so that, for a level below TINYLOG_MIN_LEVEL, its
+ * discarded branch is never instantiated and no callsite is emitted.
+ */
+#define XLOG_IS_ON(level)                                                \
+    ([](auto) {                                                          \
+        if constexpr (!::tinylog::isLogLevelCompiledIn(                  \
+                          ::tinylog::LogLevel::level,                    \
+                          ::tinylog::kMinCompiledLogLevel))              \
+        {                                                                \
+            return false;                                                \
+        }                                                                \
+        else                                                             \
+        {                                                                \
+            XLOG_CALLSITE("", ::tinylog::LogLevel::level);               \
+            return tinylog_xlog_callsite.isEnabled(                      \
+                ::tinylog::LogLevel::level);                             \
+        }                                                                \
+    }(0))
+
+/**
+ * Helper macro declaring the static XlogCallsite for a statement, named
+ * tinylog_xlog_callsite.
+ *
+ * Statements in the main source file share the file's category name,
+ * xlog_detail::xlogFileCategory.  Statements in header files carry their own
+ * copy of their file's canonical name, sized to fit it exactly.
+ */
+#define XLOG_CALLSITE(func, level)                                       \
+    static ::tinylog::detail::XlogCallsiteImpl<                          \
+        XLOG_IS_IN_HEADER_FILE                                           \
+            ? ::tinylog::LogName::canonicalSize(__FILE__)                \
+            : 0>                                                         \
+        tinylog_xlog_callsite                                            \
+    {                                                                    \
+        __FILE__, __LINE__, (func),                                      \
+            ::tinylog::xlog_detail::xlogFileCategory, (level)            \
+    }
+
+/**
+ * Is the current statement in a header file, rather than in the main
+ * source file being compiled?
+ */
+#define XLOG_IS_IN_HEADER_FILE bool(__INCLUDE_LEVEL__ > 0)
+
+/**
+ * Helper macro implementing XLOG_IF() and XLOGF_IF().
+ *
+ * The XlogCallsite is declared in the if statement's initializer, rather
+ * than in a lambda, so that __func__ still names the calling function.  Its
+ * constructor is constexpr, so it is constant-initialized and the check does
+ * not have to test a static initialization guard first.
+ *
+ * The message is built in the else branch, so nothing in it is evaluated
+ * unless the statement is enabled.  The statement already has its own else,
+ * so an XLOG() used as the body of an unbraced if/else binds correctly.
+ *
+ * Statements below TINYLOG_MIN_LEVEL are discarded by the leading
+ * if constexpr.  They must still compile, but emit no code, strings or
+ * callsite.
+ */
+#define XLOG_IMPL(level, cond, ...)                                      \
+    if constexpr (!::tinylog::isLogLevelCompiledIn(                      \
+                      level, ::tinylog::kMinCompiledLogLevel))           \
+    {                                                                    \
+    }                                                                    \
+    else if (XLOG_CALLSITE(__func__, (level));                           \
+        !(tinylog_xlog_callsite.isEnabled(level) && (cond)))             \
+    {                                                                    \
+    }                                                                    \
+    else                                                                 \
+        ::tinylog::LogStreamProcessor{                                   \
+            tinylog_xlog_callsite.getCategory(),                         \
+            (level),                                                     \
+            tinylog_xlog_callsite.getCallsite()}                         \
+            .stream(__VA_ARGS__)
+
+namespace tinylog
+{
+    class LogCategory;
+
+    /**
+     * XlogCallsite holds the state of a single XLOG() statement: its
+     * LogCallsite, and the category and effective level that it logs to.
+     *
+     * The category and level are looked up through LoggerDB::xlogInit() the
+     * first time the statement runs.  The LogCategory then keeps the cached
+     * level up to date whenever its effective level changes.
+     */
+    class XlogCallsite
+    {
+    public:
+        /**
+         * categoryName must be in canonical form, and categoryHash must be
+         * LogName::hash(categoryName).
+         */
+        constexpr XlogCallsite(
+            tinylog::StringPiece filename,
+            unsigned int lineNumber,
+            tinylog::StringPiece functionName,
+            tinylog::StringPiece categoryName,
+            size_t categoryHash,
+            LogLevel level)
+            : categoryHash_{categoryHash},
+              callsite_{filename, lineNumber, functionName, categoryName, level} {}
+
+        /**
+         * Check whether this statement's level is enabled in its category.
+         *
+         * level must be the level the XlogCallsite was constructed with.  The
+         * macros pass it again as a constant, rather than having this read
+         * it from callsite_, so the check needs only the one load of level_.
+         *
+         * UNINITIALIZED compares below every real level, so a statement that
+         * has not been initialized yet falls through to the enabled branch,
+         * and only there needs a second check.  A disabled statement returns
+         * after the first comparison.
+         */
+        bool isEnabled(LogLevel level)
+        {
+            auto currentLevel = level_.load(std::memory_order_relaxed);
+            if (__builtin_expect(level < currentLevel, 1))
+            {
+                return false;
+            }
+            if (__builtin_expect(currentLevel == LogLevel::UNINITIALIZED, 0))
+            {
+                return initSlow(level);
+            }
+            // Only enabled statements pay for the acquire, which pairs with the
+            // release store of level_ in LoggerDB::xlogInit() so category_ is
+            // visible before it is used.
+            (void)level_.load(std::memory_order_acquire);
+            return true;
+        }
+
+        /**
+         * Get the category this statement logs to.
+         *
+         * This may only be called after isEnabled() has returned true.
+         */
+        LogCategory *getCategory() const { return category_; }
+
+        constexpr LogLevel getLevel() const { return callsite_.getLevel(); }
+        constexpr const LogCallsite *getCallsite() const { return &callsite_; }
+
+    private:
+        XlogCallsite(XlogCallsite const &) = delete;
+        XlogCallsite &operator=(XlogCallsite const &) = delete;
+
+        bool initSlow(LogLevel level);
+
+        std::atomic<LogLevel> level_{LogLevel::UNINITIALIZED};
+        LogCategory *category_{nullptr};
+        size_t const categoryHash_;
+        LogCallsite const callsite_;
+    };
+
+    /**
+     * The canonical log category name for a source file, computed at compile
+     * time.
+     *
+     * Size must be LogName::canonicalSize(filename), so only the canonical
+     * name is stored rather than a copy of the whole file name.
+     */
+    template <size_t Size>
+    class XlogCategoryName
+    {
+    public:
+        constexpr explicit XlogCategoryName(tinylog::StringPiece filename)
+            : hash_{LogName::hash(filename)}
+        {
+            LogName::canonicalizeTo(filename, data_);
+        }
+
+        constexpr tinylog::StringPiece getName() const
+        {
+            return tinylog::StringPiece(data_, static_cast<int>(Size));
+        }
+        constexpr size_t getHash() const { return hash_; }
+
+    private:
+        char data_[Size]{};
+        size_t const hash_;
+    };
+
+    namespace detail
+    {
+        /**
+         * The category name of an XLOG() statement in a header file, stored
+         * alongside its XlogCallsite.  Size is the length of the canonical
+         * name.
+         */
+        template <size_t Size>
+        class XlogCallsiteName
+        {
+        public:
+            constexpr explicit XlogCallsiteName(tinylog::StringPiece filename)
+                : name_{filename} {}
+
+            template <size_t F>
+            constexpr const XlogCategoryName<Size> &getName(
+                const XlogCategoryName<F> & /* fileCategory */) const
+            {
+                return name_;
+            }
+
+        private:
+            XlogCategoryName<Size> const name_;
+        };
+
+        /**
+         * Statements in the main source file use the file's shared name, and
+         * need no storage of their own.
+         */
+        template <>
+        class XlogCallsiteName<0>
+        {
+        public:
+            constexpr explicit XlogCallsiteName(tinylog::StringPiece /* filename */) {}
+
+            template <size_t F>
+            constexpr const XlogCategoryName<F> &getName(
+                const XlogCategoryName<F> &fileCategory) const
+            {
+                return fileCategory;
+            }
+        };
+
+        template <size_t N>
+        class XlogCallsiteImpl : private XlogCallsiteName<N>, public XlogCallsite
+        {
+        public:
+            template <size_t M, size_t F>
+            constexpr XlogCallsiteImpl(
+                const char (&filename)[M],
+                unsigned int lineNumber,
+                tinylog::StringPiece functionName,
+                const XlogCategoryName<F> &fileCategory,
+                LogLevel level)
+                : XlogCallsiteName<N>{tinylog::StringPiece(filename, M - 1)},
+                  XlogCallsite{
+                      tinylog::StringPiece(filename, M - 1),
+                      lineNumber,
+                      functionName,
+                      this->getName(fileCategory).getName(),
+                      this->getName(fileCategory).getHash(),
+                      level} {}
+        };
+
+    } // namespace detail
+
+    namespace xlog_detail
+    {
+        namespace
+        {
+            /**
+             * The default XLOG() category name of the source file being
+             * compiled.
+             */
+            constexpr XlogCategoryName<LogName::canonicalSize(__BASE_FILE__)>
+                xlogFileCategory{__BASE_FILE__};
+        } // namespace
+    } // namespace xlog_detail
+
+} // namespace tinylog
@@ -0,0 +1,574 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AsyncMergingLogHandler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <stdexcept>
+
+#include "LogFormatter.h"
+#include "LogWriter.h"
+#include "system/ThreadName.h"
+
+namespace
+{
+    std::atomic<uint64_t> nextHandlerId{1};
+
+    size_t roundUpToPowerOfTwo(size_t value)
+    {
+        size_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+} // namespace
+
+namespace tinylog
+{
+    /**
+     * A bounded single-producer/single-consumer queue of shared LogMessage
+     * copies.
+     *
+     * Only the owning logging thread writes tail_, and only the I/O thread
+     * writes head_ and written_.
+     */
+    class AsyncMergingLogHandler::ThreadBuffer
+    {
+    public:
+        explicit ThreadBuffer(size_t capacity)
+            : capacity_{capacity}, mask_{capacity - 1}, slots_{new Slot[capacity]} {}
+
+        /**
+         * Add a message to the buffer, copying it unless a shared copy is
+         * given.  Must only be called by the owning thread.  Returns false if
+         * the buffer is full.
+         */
+        bool tryPush(
+            const LogMessage &message,
+            const SharedLogMessage *shared,
+            const LogCategory *handlerCategory)
+        {
+            auto tail = tail_.load(std::memory_order_relaxed);
+            if (tail - cachedHead_ >= capacity_)
+            {
+                cachedHead_ = head_.load(std::memory_order_acquire);
+                if (tail - cachedHead_ >= capacity_)
+                {
+                    return false;
+                }
+            }
+            auto &slot = slots_[tail & mask_];
+            slot.message = shared ? *shared : makeSharedLogMessage(message);
+            slot.handlerCategory = handlerCategory;
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool isFull() const
+        {
+            return tail_.load(std::memory_order_relaxed) -
+                       head_.load(std::memory_order_acquire) >=
+                   capacity_;
+        }
+
+        bool isEmpty() const
+        {
+            return head_.load(std::memory_order_relaxed) ==
+                   tail_.load(std::memory_order_acquire);
+        }
+
+        uint64_t getHead() const { return head_.load(std::memory_order_acquire); }
+        uint64_t getTail() const { return tail_.load(std::memory_order_acquire); }
+
+        /**
+         * Get the position just past the last message handed to the
+         * LogWriter.  This trails head_ while a popped message is still being
+         * written.
+         */
+        uint64_t getWritten() const
+        {
+            return written_.load(std::memory_order_acquire);
+        }
+
+        const LogMessage &messageAt(uint64_t pos) const
+        {
+            return *slots_[pos & mask_].message;
+        }
+        const LogCategory *categoryAt(uint64_t pos) const
+        {
+            return slots_[pos & mask_].handlerCategory;
+        }
+
+        /**
+         * Release the message at the head of the buffer and hand its slot back
+         * to the producer.  Must only be called by the I/O thread.
+         */
+        void pop(uint64_t pos)
+        {
+            slots_[pos & mask_].message.reset();
+            head_.store(pos + 1, std::memory_order_release);
+        }
+
+        /**
+         * Record that the message at pos has been written.  Must only be
+         * called by the I/O thread.
+         */
+        void markWritten(uint64_t pos)
+        {
+            written_.store(pos + 1, std::memory_order_release);
+        }
+
+        /**
+         * Set by the owning thread's thread-local cache when the thread exits.
+         */
+        std::atomic<bool> producerExited{false};
+
+        /**
+         * Set when the handler is destroyed, so the owning thread can drop its
+         * reference to the buffer.
+         */
+        std::atomic<bool> handlerDestroyed{false};
+
+        /**
+         * The handler that owns this buffer, so an exiting thread can wake its
+         * I/O thread to reclaim the buffer.  The handler clears this, under
+         * ownerMutex, before it is destroyed.
+         */
+        std::mutex ownerMutex;
+        AsyncMergingLogHandler *owner{nullptr};
+
+    private:
+        struct Slot
+        {
+            const LogCategory *handlerCategory{nullptr};
+            SharedLogMessage message;
+        };
+
+        size_t const capacity_;
+        uint64_t const mask_;
+        std::unique_ptr<Slot[]> const slots_;
+
+        alignas(64) std::atomic<uint64_t> tail_{0};
+        /**
+         * The producer's last observation of head_, so that it only needs to
+         * read the consumer's cache line when the buffer looks full.
+         */
+        uint64_t cachedHead_{0};
+        alignas(64) std::atomic<uint64_t> head_{0};
+        std::atomic<uint64_t> written_{0};
+    };
+
+    /**
+     * The per-thread list of buffers, one for each AsyncMergingLogHandler the
+     * thread has logged to.
+     */
+    struct AsyncMergingLogHandler::ThreadBufferCache
+    {
+        ~ThreadBufferCache()
+        {
+            for (auto &entry : entries)
+            {
+                auto &buffer = *entry.second;
+                buffer.producerExited.store(true, std::memory_order_release);
+                std::lock_guard<std::mutex> lock(buffer.ownerMutex);
+                if (buffer.owner)
+                {
+                    buffer.owner->wakeConsumer();
+                }
+            }
+        }
+
+        std::vector<std::pair<uint64_t, std::shared_ptr<ThreadBuffer>>> entries;
+    };
+
+    AsyncMergingLogHandler::AsyncMergingLogHandler(
+        std::shared_ptr<LogFormatter> formatter,
+        std::shared_ptr<LogWriter> writer,
+        size_t bufferCapacity)
+        : id_{nextHandlerId.fetch_add(1, std::memory_order_relaxed)},
+          formatter_{std::move(formatter)},
+          writer_{std::move(writer)},
+          bufferCapacity_{roundUpToPowerOfTwo(bufferCapacity < 2 ? 2 : bufferCapacity)}
+    {
+        ioThread_ = std::thread([this] { ioThread(); });
+    }
+
+    AsyncMergingLogHandler::~AsyncMergingLogHandler()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        consumerCV_.notify_one();
+        ioThread_.join();
+
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        {
+            std::lock_guard<std::mutex> lock(buffersMutex_);
+            buffers.swap(buffers_);
+        }
+        for (auto &buffer : buffers)
+        {
+            buffer->handlerDestroyed.store(true, std::memory_order_release);
+            std::lock_guard<std::mutex> lock(buffer->ownerMutex);
+            buffer->owner = nullptr;
+        }
+    }
+
+    size_t AsyncMergingLogHandler::getNumBuffers() const
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex_);
+        return buffers_.size();
+    }
+
+    void AsyncMergingLogHandler::handleMessage(
+        const LogMessage &message, const LogCategory *handlerCategory)
+    {
+        enqueue(message, nullptr, handlerCategory);
+    }
+
+    void AsyncMergingLogHandler::handleSharedMessage(
+        const SharedLogMessage &message, const LogCategory *handlerCategory)
+    {
+        enqueue(*message, &message, handlerCategory);
+    }
+
+    void AsyncMergingLogHandler::enqueue(
+        const LogMessage &message,
+        const SharedLogMessage *shared,
+        const LogCategory *handlerCategory)
+    {
+        if (message.getLevel() < getLevel())
+        {
+            return;
+        }
+
+        auto &buffer = getThreadBuffer();
+        while (!buffer.tryPush(message, shared, handlerCategory))
+        {
+            // Fatal messages are about to crash the program, so always make
+            // sure they get written regardless of the overflow policy.
+            auto level = message.getLevel();
+            auto policy = isLogLevelFatal(level) ? LogOverflowPolicy::BLOCK
+                                                 : getOverflowPolicy();
+            if (policy == LogOverflowPolicy::DROP_NEWEST ||
+                (policy == LogOverflowPolicy::DROP_BELOW_LEVEL &&
+                 level < getDropThreshold()))
+            {
+                dropCounters_.recordDrop(level);
+                return;
+            }
+            waitForSpace(buffer);
+        }
+        wakeConsumer();
+    }
+
+    void AsyncMergingLogHandler::setOverflowPolicy(LogOverflowPolicy policy)
+    {
+        if (policy == LogOverflowPolicy::DROP_OLDEST)
+        {
+            throw std::invalid_argument(
+                "AsyncMergingLogHandler does not support the drop_oldest policy");
+        }
+        overflowPolicy_.store(policy, std::memory_order_relaxed);
+    }
+
+    AsyncMergingLogHandler::ThreadBuffer &AsyncMergingLogHandler::getThreadBuffer()
+    {
+        static thread_local ThreadBufferCache cache;
+        for (auto &entry : cache.entries)
+        {
+            if (entry.first == id_)
+            {
+                return *entry.second;
+            }
+        }
+
+        // First message from this thread.  Take the opportunity to drop buffers
+        // of handlers that have since been destroyed.
+        cache.entries.erase(
+            std::remove_if(
+                cache.entries.begin(),
+                cache.entries.end(),
+                [](const auto &entry)
+                {
+                    return entry.second->handlerDestroyed.load(
+                        std::memory_order_acquire);
+                }),
+            cache.entries.end());
+
+        auto buffer = std::make_shared<ThreadBuffer>(bufferCapacity_);
+        buffer->owner = this;
+        {
+            std::lock_guard<std::mutex> lock(buffersMutex_);
+            buffers_.push_back(buffer);
+            buffersVersion_.fetch_add(1, std::memory_order_release);
+        }
+        cache.entries.emplace_back(id_, buffer);
+        return *buffer;
+    }
+
+    bool AsyncMergingLogHandler::hasPendingWork() const
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex_);
+        for (const auto &buffer : buffers_)
+        {
+            if (!buffer->isEmpty() ||
+                buffer->producerExited.load(std::memory_order_acquire))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void AsyncMergingLogHandler::wakeConsumer()
+    {
+        // Pairs with the fence in ioThread(): either we observe that the
+        // consumer is about to sleep, or it observes our published message.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (consumerWaiting_.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            consumerCV_.notify_one();
+        }
+    }
+
+    void AsyncMergingLogHandler::waitForSpace(ThreadBuffer &buffer)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        producersWaiting_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        producerCV_.wait(lock, [&] { return !buffer.isFull(); });
+        producersWaiting_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void AsyncMergingLogHandler::flush()
+    {
+        // Flushing from the I/O thread itself (for instance if the LogWriter
+        // logs something) would deadlock waiting on ourselves.
+        if (std::this_thread::get_id() != ioThread_.get_id())
+        {
+            std::vector<std::pair<std::shared_ptr<ThreadBuffer>, uint64_t>> targets;
+            {
+                std::lock_guard<std::mutex> lock(buffersMutex_);
+                targets.reserve(buffers_.size());
+                for (const auto &buffer : buffers_)
+                {
+                    targets.emplace_back(buffer, buffer->getTail());
+                }
+            }
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            flushWaiters_.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            flushCV_.wait(lock, [&]
+                          {
+                for (const auto &target : targets)
+                {
+                    if (target.first->getWritten() < target.second)
+                    {
+                        return false;
+                    }
+                }
+                return true; });
+            flushWaiters_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        writer_->flush();
+    }
+
+    LogHandlerConfig AsyncMergingLogHandler::getConfig() const
+    {
+        return LogHandlerConfig{
+            "async_merging",
+            {{"buffer_capacity", std::to_string(bufferCapacity_)},
+             {"overflow", logOverflowPolicyToString(getOverflowPolicy()).str()},
+             {"drop_threshold", logLevelToString(getDropThreshold())}}};
+    }
+
+    void AsyncMergingLogHandler::ioThread()
+    {
+        setThreadName("log_writer");
+
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        uint64_t version = 0;
+        while (true)
+        {
+            if (buffersVersion_.load(std::memory_order_acquire) != version)
+            {
+                std::lock_guard<std::mutex> lock(buffersMutex_);
+                buffers = buffers_;
+                version = buffersVersion_.load(std::memory_order_relaxed);
+            }
+
+            bool didWork = drainRound(buffers);
+            if (dropCounters_.hasUnreported())
+            {
+                writeDropSummary();
+            }
+
+            // Reclaim the buffers of threads that have exited.  producerExited
+            // is checked before emptiness, so nothing can be pushed after the
+            // final isEmpty() check.
+            bool reclaim = std::any_of(
+                buffers.begin(), buffers.end(), [](const auto &buffer)
+                { return buffer->producerExited.load(std::memory_order_acquire) &&
+                         buffer->isEmpty(); });
+            if (reclaim)
+            {
+                std::lock_guard<std::mutex> lock(buffersMutex_);
+                buffers_.erase(
+                    std::remove_if(
+                        buffers_.begin(),
+                        buffers_.end(),
+                        [](const auto &buffer)
+                        { return buffer->producerExited.load(std::memory_order_acquire) &&
+                                 buffer->isEmpty(); }),
+                    buffers_.end());
+                buffersVersion_.fetch_add(1, std::memory_order_release);
+            }
+
+            if (didWork)
+            {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (producersWaiting_.load(std::memory_order_relaxed) > 0 ||
+                    flushWaiters_.load(std::memory_order_relaxed) > 0)
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    producerCV_.notify_all();
+                    flushCV_.notify_all();
+                }
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            consumerWaiting_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            consumerCV_.wait(lock, [this] { return stop_ || hasPendingWork(); });
+            consumerWaiting_.store(false, std::memory_order_relaxed);
+            if (stop_ && !hasPendingWork())
+            {
+                writeDropSummary();
+                return;
+            }
+        }
+    }
+
+    bool AsyncMergingLogHandler::drainRound(
+        std::vector<std::shared_ptr<ThreadBuffer>> &buffers)
+    {
+        struct Cursor
+        {
+            ThreadBuffer *buffer;
+            uint64_t pos;
+            uint64_t end;
+            std::chrono::system_clock::time_point timestamp;
+        };
+
+        // Snapshot the readable range of every buffer, then k-way merge them.
+        // Each buffer is already in timestamp order since it has one producer.
+        std::vector<Cursor> heap;
+        heap.reserve(buffers.size());
+        for (const auto &buffer : buffers)
+        {
+            auto pos = buffer->getHead();
+            auto end = buffer->getTail();
+            if (pos != end)
+            {
+                heap.push_back(
+                    {buffer.get(), pos, end, buffer->messageAt(pos).getTimestamp()});
+            }
+        }
+        if (heap.empty())
+        {
+            return false;
+        }
+
+        auto later = [](const Cursor &a, const Cursor &b)
+        { return a.timestamp > b.timestamp; };
+        std::make_heap(heap.begin(), heap.end(), later);
+        while (!heap.empty())
+        {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            auto &cursor = heap.back();
+            std::string formatted;
+            try
+            {
+                formatted = formatter_->formatMessage(
+                    cursor.buffer->messageAt(cursor.pos),
+                    cursor.buffer->categoryAt(cursor.pos));
+            }
+            catch (const std::exception &ex)
+            {
+                // There is no caller to report this to on the I/O thread, and
+                // logging it through the normal flow could recurse into us.
+                fprintf(stderr, "AsyncMergingLogHandler: error formatting log message: %s\n",
+                        ex.what());
+            }
+            // Hand the slot back before the (possibly slow) write.
+            cursor.buffer->pop(cursor.pos);
+            try
+            {
+                if (!formatted.empty())
+                {
+                    writer_->writeMessage(std::move(formatted));
+                }
+            }
+            catch (const std::exception &ex)
+            {
+                fprintf(stderr, "AsyncMergingLogHandler: error writing log message: %s\n",
+                        ex.what());
+            }
+            // flush() waits for this rather than head_, so it does not return
+            // while the write above is still in progress.
+            cursor.buffer->markWritten(cursor.pos);
+
+            if (++cursor.pos == cursor.end)
+            {
+                heap.pop_back();
+            }
+            else
+            {
+                cursor.timestamp = cursor.buffer->messageAt(cursor.pos).getTimestamp();
+                std::push_heap(heap.begin(), heap.end(), later);
+            }
+        }
+        return true;
+    }
+
+    void AsyncMergingLogHandler::writeDropSummary()
+    {
+        auto summary = dropCounters_.takeDropSummary();
+        if (summary.empty())
+        {
+            return;
+        }
+        try
+        {
+            writer_->writeMessage(std::move(summary), LogWriter::NEVER_DISCARD);
+        }
+        catch (const std::exception &ex)
+        {
+            fprintf(stderr, "AsyncMergingLogHandler: error writing log message: %s\n",
+                    ex.what());
+        }
+    }
+
+} // namespace tinylog
@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AsyncRingLogHandler.h"
+
+#include <cstdio>
+#include <exception>
+#include <new>
+
+#include "LogFormatter.h"
+#include "LogWriter.h"
+#include "system/ThreadName.h"
+
+namespace
+{
+    size_t roundUpToPowerOfTwo(size_t value)
+    {
+        size_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+} // namespace
+
+namespace tinylog
+{
+    AsyncRingLogHandler::AsyncRingLogHandler(
+        std::shared_ptr<LogFormatter> formatter,
+        std::shared_ptr<LogWriter> writer,
+        size_t capacity)
+        : formatter_{std::move(formatter)},
+          writer_{std::move(writer)},
+          capacity_{roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity)},
+          mask_{capacity_ - 1},
+          slots_{new Slot[capacity_]}
+    {
+        for (size_t idx = 0; idx < capacity_; ++idx)
+        {
+            slots_[idx].sequence.store(idx, std::memory_order_relaxed);
+        }
+        ioThread_ = std::thread([this] { ioThread(); });
+    }
+
+    AsyncRingLogHandler::~AsyncRingLogHandler()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        consumerCV_.notify_one();
+        ioThread_.join();
+    }
+
+    void AsyncRingLogHandler::handleMessage(
+        const LogMessage &message, const LogCategory *handlerCategory)
+    {
+        enqueue(message, nullptr, handlerCategory);
+    }
+
+    void AsyncRingLogHandler::handleSharedMessage(
+        const SharedLogMessage &message, const LogCategory *handlerCategory)
+    {
+        enqueue(*message, &message, handlerCategory);
+    }
+
+    void AsyncRingLogHandler::enqueue(
+        const LogMessage &message,
+        const SharedLogMessage *shared,
+        const LogCategory *handlerCategory)
+    {
+        auto level = message.getLevel();
+        if (level < getLevel())
+        {
+            return;
+        }
+
+        while (!tryEnqueue(message, shared, handlerCategory))
+        {
+            // Fatal messages are about to crash the program, so always make
+            // sure they get written regardless of the overflow policy.
+            auto policy = isLogLevelFatal(level) ? LogOverflowPolicy::BLOCK
+                                                 : getOverflowPolicy();
+            switch (policy)
+            {
+            case LogOverflowPolicy::BLOCK:
+                waitForSpace();
+                break;
+            case LogOverflowPolicy::DROP_NEWEST:
+                dropCounters_.recordDrop(level);
+                return;
+            case LogOverflowPolicy::DROP_OLDEST:
+                if (!tryEvictOldest())
+                {
+                    // Either the oldest slot has been reserved but not yet
+                    // published by another logging thread, or the I/O thread
+                    // is still formatting the message in the slot we need.
+                    std::this_thread::yield();
+                }
+                break;
+            case LogOverflowPolicy::DROP_BELOW_LEVEL:
+                if (level < getDropThreshold())
+                {
+                    dropCounters_.recordDrop(level);
+                    return;
+                }
+                waitForSpace();
+                break;
+            }
+        }
+        wakeConsumer();
+    }
+
+    bool AsyncRingLogHandler::tryEnqueue(
+        const LogMessage &message,
+        const SharedLogMessage *shared,
+        const LogCategory *handlerCategory)
+    {
+        Slot *slot;
+        uint64_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            slot = &slots_[pos & mask_];
+            auto seq = slot->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueuePos_.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                // The slot still holds a message from the previous lap.
+                return false;
+            }
+            else
+            {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        // The slot is reserved: it must be published even if copying the
+        // message fails, otherwise the I/O thread would wait on it forever.
+        try
+        {
+            slot->message = shared ? *shared : makeSharedLogMessage(message);
+        }
+        catch (const std::bad_alloc &)
+        {
+            slot->message.reset();
+        }
+        slot->handlerCategory = handlerCategory;
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool AsyncRingLogHandler::tryEvictOldest()
+    {
+        uint64_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            // Evicting only helps if it frees the slot at enqueuePos_, which
+            // is one lap behind it.  If the I/O thread has already claimed
+            // that slot, evicting a later message would drop it for nothing.
+            if (pos + capacity_ > enqueuePos_.load(std::memory_order_relaxed))
+            {
+                return false;
+            }
+
+            auto &slot = slots_[pos & mask_];
+            auto seq = slot.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeuePos_.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_seq_cst,
+                        std::memory_order_relaxed))
+                {
+                    if (slot.message)
+                    {
+                        dropCounters_.recordDrop(slot.message->getLevel());
+                    }
+                    releaseSlot(slot, pos);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool AsyncRingLogHandler::hasPendingMessage() const
+    {
+        auto pos = dequeuePos_.load(std::memory_order_relaxed);
+        return slots_[pos & mask_].sequence.load(std::memory_order_acquire) ==
+               pos + 1;
+    }
+
+    void AsyncRingLogHandler::wakeConsumer()
+    {
+        // Pairs with the fence in ioThread(): either we observe that the
+        // consumer is about to sleep, or it observes our published slot.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (consumerWaiting_.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            consumerCV_.notify_one();
+        }
+    }
+
+    void AsyncRingLogHandler::waitForSpace()
+    {
+        auto isFull = [this]
+        {
+            auto pos = enqueuePos_.load(std::memory_order_relaxed);
+            auto seq = slots_[pos & mask_].sequence.load(std::memory_order_acquire);
+            return static_cast<int64_t>(seq) - static_cast<int64_t>(pos) < 0;
+        };
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        producersWaiting_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        producerCV_.wait(lock, [&] { return !isFull(); });
+        producersWaiting_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void AsyncRingLogHandler::flush()
+    {
+        // Flushing from the I/O thread itself (for instance if the LogWriter
+        // logs something) would deadlock waiting on ourselves.
+        if (std::this_thread::get_id() != ioThread_.get_id())
+        {
+            auto ticket = enqueuePos_.load(std::memory_order_acquire);
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            flushWaiters_.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            flushCV_.wait(lock, [&]
+                          { return dequeuePos_.load(std::memory_order_seq_cst) >= ticket &&
+                                   consumerPos_.load(std::memory_order_seq_cst) >= ticket; });
+            flushWaiters_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        writer_->flush();
+    }
+
+    LogHandlerConfig AsyncRingLogHandler::getConfig() const
+    {
+        return LogHandlerConfig{
+            "async_ring",
+            {{"capacity", std::to_string(capacity_)},
+             {"overflow", logOverflowPolicyToString(getOverflowPolicy()).str()},
+             {"drop_threshold", logLevelToString(getDropThreshold())}}};
+    }
+
+    void AsyncRingLogHandler::ioThread()
+    {
+        setThreadName("log_writer");
+
+        while (true)
+        {
+            // Logging threads may advance dequeuePos_ as well when evicting the
+            // oldest message, so the position is claimed with a CAS.
+            auto pos = dequeuePos_.load(std::memory_order_relaxed);
+            auto &slot = slots_[pos & mask_];
+            if (slot.sequence.load(std::memory_order_acquire) == pos + 1)
+            {
+                // Publish the position before claiming it, so that flush()
+                // never sees dequeuePos_ past it while we are still writing.
+                consumerPos_.store(pos, std::memory_order_seq_cst);
+                if (!dequeuePos_.compare_exchange_strong(
+                        pos, pos + 1, std::memory_order_seq_cst,
+                        std::memory_order_relaxed))
+                {
+                    // A logging thread evicted the message first.  Go back to
+                    // idle, or a flush() waiting on us would not return until
+                    // the next message arrived.
+                    consumerPos_.store(kIdle, std::memory_order_seq_cst);
+                    notifyWaiters();
+                    continue;
+                }
+                processSlot(slot, pos);
+                consumerPos_.store(kIdle, std::memory_order_seq_cst);
+
+                if (dropCounters_.hasUnreported() &&
+                    enqueuePos_.load(std::memory_order_relaxed) -
+                            dequeuePos_.load(std::memory_order_relaxed) <=
+                        capacity_ / 2)
+                {
+                    writeDropSummary();
+                }
+                notifyWaiters();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            consumerWaiting_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            consumerCV_.wait(lock, [this] { return stop_ || hasPendingMessage(); });
+            consumerWaiting_.store(false, std::memory_order_relaxed);
+            if (stop_ && !hasPendingMessage())
+            {
+                writeDropSummary();
+                return;
+            }
+        }
+    }
+
+    void AsyncRingLogHandler::notifyWaiters()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (producersWaiting_.load(std::memory_order_relaxed) > 0 ||
+            flushWaiters_.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            producerCV_.notify_all();
+            flushCV_.notify_all();
+        }
+    }
+
+    void AsyncRingLogHandler::processSlot(Slot &slot, uint64_t pos)
+    {
+        // A null message marks a slot whose message could not be copied.
+        if (!slot.message)
+        {
+            releaseSlot(slot, pos);
+            return;
+        }
+
+        // Hand the slot back as soon as the message is formatted, so that a
+        // slow LogWriter does not keep it occupied during the write.
+        try
+        {
+            auto formatted =
+                formatter_->formatMessage(*slot.message, slot.handlerCategory);
+            releaseSlot(slot, pos);
+            writer_->writeMessage(std::move(formatted));
+        }
+        catch (const std::exception &ex)
+        {
+            // There is no caller to report this to on the I/O thread, and
+            // logging it through the normal flow could recurse into us.
+            fprintf(stderr, "AsyncRingLogHandler: error writing log message: %s\n",
+                    ex.what());
+            if (slot.sequence.load(std::memory_order_relaxed) == pos + 1)
+            {
+                releaseSlot(slot, pos);
+            }
+        }
+    }
+
+    void AsyncRingLogHandler::releaseSlot(Slot &slot, uint64_t pos)
+    {
+        slot.message.reset();
+        slot.sequence.store(pos + capacity_, std::memory_order_release);
+    }
+
+    void AsyncRingLogHandler::writeDropSummary()
+    {
+        auto summary = dropCounters_.takeDropSummary();
+        if (summary.empty())
+        {
+            return;
+        }
+        try
+        {
+            writer_->writeMessage(std::move(summary), LogWriter::NEVER_DISCARD);
+        }
+        catch (const std::exception &ex)
+        {
+            fprintf(stderr, "AsyncRingLogHandler: error writing log message: %s\n",
+                    ex.what());
+        }
+    }
+
+} // namespace tinylog
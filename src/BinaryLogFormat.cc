@@ -0,0 +1,452 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BinaryLogFormat.h"
+
+#include <time.h>
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+#include "LogMessage.h"
+
+using std::chrono::system_clock;
+
+namespace
+{
+    void appendVarint(std::string &out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    void appendString(std::string &out, tinylog::StringPiece value)
+    {
+        appendVarint(out, value.size());
+        out.append(value.data(), value.size());
+    }
+
+    /**
+     * A bounds-checked cursor over a partially received record.
+     *
+     * All read methods return false if the data ends before the value does.
+     */
+    class RecordReader
+    {
+    public:
+        RecordReader(const std::string &data, size_t offset)
+            : data_{data}, offset_{offset} {}
+
+        size_t offset() const { return offset_; }
+
+        bool readByte(uint8_t &value)
+        {
+            if (offset_ >= data_.size())
+            {
+                return false;
+            }
+            value = static_cast<uint8_t>(data_[offset_++]);
+            return true;
+        }
+
+        bool readVarint(uint64_t &value)
+        {
+            value = 0;
+            for (unsigned int shift = 0; shift < 64; shift += 7)
+            {
+                uint8_t byte;
+                if (!readByte(byte))
+                {
+                    return false;
+                }
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    return true;
+                }
+            }
+            throw std::runtime_error("binary log: malformed varint");
+        }
+
+        bool readString(std::string &value)
+        {
+            uint64_t length;
+            if (!readVarint(length) || data_.size() - offset_ < length)
+            {
+                return false;
+            }
+            value.assign(data_, offset_, length);
+            offset_ += length;
+            return true;
+        }
+
+    private:
+        const std::string &data_;
+        size_t offset_;
+    };
+
+    char getLevelLetter(tinylog::LogLevel level)
+    {
+        using tinylog::LogLevel;
+        if (level < LogLevel::DBG)
+        {
+            return 'V';
+        }
+        else if (level < LogLevel::INFO)
+        {
+            return 'D';
+        }
+        else if (level < LogLevel::WARN)
+        {
+            return 'I';
+        }
+        else if (level < LogLevel::ERROR)
+        {
+            return 'W';
+        }
+        else if (level < LogLevel::CRITICAL)
+        {
+            return 'E';
+        }
+        else if (level < LogLevel::DFATAL)
+        {
+            return 'C';
+        }
+        return 'F';
+    }
+
+    /**
+     * What one thread has written through one BinaryLogFormatter since the
+     * formatter's last reset().
+     */
+    struct ThreadStream
+    {
+        uint64_t formatterId;
+        uint64_t epoch;
+        /**
+         * Indexed by LogCallsite ID.
+         */
+        std::vector<bool> writtenCallsites;
+    };
+
+    std::atomic<uint64_t> nextFormatterId{1};
+
+    /**
+     * Return the calling thread's stream for a formatter, or nullptr if the
+     * thread has not written anything through it in the current epoch.
+     */
+    ThreadStream *getThreadStream(uint64_t formatterId, uint64_t epoch, bool create)
+    {
+        // Threads rarely use more than one or two binary formatters.  Forgetting
+        // an old one only means writing its header and callsites again.
+        constexpr size_t kMaxStreams = 8;
+        static thread_local std::vector<ThreadStream> streams;
+        for (auto &stream : streams)
+        {
+            if (stream.formatterId == formatterId)
+            {
+                if (stream.epoch != epoch)
+                {
+                    if (!create)
+                    {
+                        return nullptr;
+                    }
+                    stream.epoch = epoch;
+                    stream.writtenCallsites.clear();
+                }
+                return &stream;
+            }
+        }
+        if (!create)
+        {
+            return nullptr;
+        }
+        if (streams.size() >= kMaxStreams)
+        {
+            streams.erase(streams.begin());
+        }
+        streams.push_back(ThreadStream{formatterId, epoch, {}});
+        return &streams.back();
+    }
+
+    void appendSanitized(std::string &out, const std::string &message)
+    {
+        static constexpr char hexdigits[] = "0123456789abcdef";
+        for (const char c : message)
+        {
+            auto uc = static_cast<unsigned char>(c);
+            if ((uc < 0x20 && c != '\n' && c != '\t') || uc == 0x7f)
+            {
+                out.append({'\\', 'x', hexdigits[(uc >> 4) & 0xf], hexdigits[uc & 0xf]});
+            }
+            else
+            {
+                out.push_back(c);
+            }
+        }
+    }
+} // namespace
+
+namespace tinylog
+{
+    BinaryLogFormatter::BinaryLogFormatter()
+        : id_{nextFormatterId.fetch_add(1, std::memory_order_relaxed)} {}
+
+    std::string BinaryLogFormatter::formatMessage(
+        const LogMessage &message, const LogCategory * /* handlerCategory */)
+    {
+        auto rawMessage = message.getRawMessage();
+        auto contextString = message.getContexString();
+
+        std::string out;
+        out.reserve(32 + rawMessage.size() + contextString.size());
+
+        auto epoch = epoch_.load(std::memory_order_acquire);
+        auto *stream = getThreadStream(id_, epoch, false);
+        if (!stream)
+        {
+            out.append(kBinaryLogMagic.data(), kBinaryLogMagic.size());
+            stream = getThreadStream(id_, epoch, true);
+        }
+
+        const auto *callsite = message.getCallsite();
+        uint64_t callsiteId = callsite->getId();
+        auto &written = stream->writtenCallsites;
+        if (callsiteId >= written.size())
+        {
+            written.resize(callsiteId + 1);
+        }
+        if (!written[callsiteId])
+        {
+            written[callsiteId] = true;
+            out.push_back(static_cast<char>(BinaryLogRecordType::CALLSITE));
+            appendVarint(out, callsiteId);
+            appendVarint(out, static_cast<uint32_t>(callsite->getLevel()));
+            appendVarint(out, callsite->getLineNumber());
+            appendString(out, callsite->getCategoryName());
+            appendString(out, callsite->getFileName());
+            appendString(out, callsite->getFunctionName());
+        }
+
+        auto timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             message.getTimestamp().time_since_epoch())
+                             .count();
+        out.push_back(static_cast<char>(BinaryLogRecordType::MESSAGE));
+        appendVarint(out, callsiteId);
+        appendVarint(out, static_cast<uint64_t>(timestamp));
+        appendVarint(out, message.getThreadID());
+        appendString(out, contextString);
+        appendString(out, rawMessage);
+        return out;
+    }
+
+    void BinaryLogFormatter::reset()
+    {
+        epoch_.fetch_add(1, std::memory_order_release);
+    }
+
+    void BinaryLogDecoder::feed(StringPiece data)
+    {
+        buffer_.append(data.data(), data.size());
+
+        size_t offset = 0;
+        while (true)
+        {
+            // A stream starts with the magic value.  It appears again in the
+            // middle of a file for every other thread that wrote to it, and
+            // after the formatter was reset().  Callsite IDs keep their
+            // meaning across all of these, so the callsites are kept.
+            if (buffer_.size() - offset >= static_cast<size_t>(kBinaryLogMagic.size()) &&
+                StringPiece(buffer_.data() + offset, kBinaryLogMagic.size()) ==
+                    kBinaryLogMagic)
+            {
+                offset += kBinaryLogMagic.size();
+                sawMagic_ = true;
+                continue;
+            }
+            if (!sawMagic_)
+            {
+                if (buffer_.size() - offset < static_cast<size_t>(kBinaryLogMagic.size()))
+                {
+                    break;
+                }
+                throw std::runtime_error("binary log: missing stream header");
+            }
+            if (!decodeRecord(offset))
+            {
+                break;
+            }
+        }
+        buffer_.erase(0, offset);
+    }
+
+    bool BinaryLogDecoder::decodeRecord(size_t &offset)
+    {
+        RecordReader reader{buffer_, offset};
+        uint8_t type;
+        if (!reader.readByte(type))
+        {
+            return false;
+        }
+
+        if (type == static_cast<uint8_t>(BinaryLogRecordType::CALLSITE))
+        {
+            uint64_t id, level, lineNumber;
+            Callsite callsite;
+            if (!reader.readVarint(id) || !reader.readVarint(level) ||
+                !reader.readVarint(lineNumber) ||
+                !reader.readString(callsite.categoryName) ||
+                !reader.readString(callsite.filename) ||
+                !reader.readString(callsite.functionName))
+            {
+                return false;
+            }
+            callsite.level = static_cast<LogLevel>(level);
+            callsite.lineNumber = static_cast<unsigned int>(lineNumber);
+            offset = reader.offset();
+
+            auto &stored = callsites_[id];
+            stored = std::move(callsite);
+
+            // Release any messages that arrived before their callsite.
+            auto it = pending_.begin();
+            while (it != pending_.end())
+            {
+                if (it->callsiteId == id)
+                {
+                    emit(stored, it->record);
+                    it = pending_.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            return true;
+        }
+        else if (type == static_cast<uint8_t>(BinaryLogRecordType::MESSAGE))
+        {
+            uint64_t callsiteId, timestamp;
+            DecodedLogRecord record;
+            if (!reader.readVarint(callsiteId) || !reader.readVarint(timestamp) ||
+                !reader.readVarint(record.threadID) ||
+                !reader.readString(record.contextString) ||
+                !reader.readString(record.message))
+            {
+                return false;
+            }
+            record.timestamp = system_clock::time_point{
+                std::chrono::duration_cast<system_clock::duration>(
+                    std::chrono::nanoseconds{timestamp})};
+            offset = reader.offset();
+
+            auto it = callsites_.find(callsiteId);
+            if (it == callsites_.end())
+            {
+                pending_.push_back({callsiteId, std::move(record)});
+            }
+            else
+            {
+                emit(it->second, record);
+            }
+            return true;
+        }
+        throw std::runtime_error(
+            "binary log: unknown record type " + std::to_string(type));
+    }
+
+    void BinaryLogDecoder::emit(const Callsite &callsite, DecodedLogRecord &record)
+    {
+        record.categoryName = callsite.categoryName;
+        record.level = callsite.level;
+        record.filename = callsite.filename;
+        record.lineNumber = callsite.lineNumber;
+        record.functionName = callsite.functionName;
+        callback_(record);
+    }
+
+    void BinaryLogDecoder::finish()
+    {
+        for (auto &pending : pending_)
+        {
+            Callsite unknown{
+                "<unknown callsite " + std::to_string(pending.callsiteId) + ">",
+                LogLevel::UNINITIALIZED, 0, "", ""};
+            emit(unknown, pending.record);
+        }
+        pending_.clear();
+        if (!buffer_.empty())
+        {
+            throw std::runtime_error("binary log: truncated record at end of input");
+        }
+    }
+
+    std::string BinaryLogDecoder::formatRecord(const DecodedLogRecord &record)
+    {
+        auto timeSinceEpoch = record.timestamp.time_since_epoch();
+        auto epochSeconds =
+            std::chrono::duration_cast<std::chrono::seconds>(timeSinceEpoch);
+        auto usecs = std::chrono::duration_cast<std::chrono::microseconds>(
+                         timeSinceEpoch - epochSeconds)
+                         .count();
+        time_t unixTimestamp = epochSeconds.count();
+        struct tm ltime;
+        localtime_r(&unixTimestamp, &ltime);
+
+        auto basename = record.filename;
+        auto idx = basename.rfind('/');
+        if (idx != std::string::npos)
+        {
+            basename = basename.substr(idx + 1);
+        }
+
+        std::array<char, 64> header;
+        snprintf(header.data(), header.size(), "%c%02d%02d %02d:%02d:%02d.%06lld %5llu ",
+                 getLevelLetter(record.level), ltime.tm_mon + 1, ltime.tm_mday,
+                 ltime.tm_hour, ltime.tm_min, ltime.tm_sec,
+                 static_cast<long long>(usecs),
+                 static_cast<unsigned long long>(record.threadID));
+
+        std::string out{header.data()};
+        out.append(basename);
+        out.push_back(':');
+        out.append(std::to_string(record.lineNumber));
+        if (!record.functionName.empty())
+        {
+            out.push_back(' ');
+            out.append(record.functionName);
+        }
+        if (!record.contextString.empty())
+        {
+            out.push_back(' ');
+            out.append(record.contextString);
+        }
+        out.append("] [");
+        out.append(record.categoryName);
+        out.append("] ");
+        appendSanitized(out, record.message);
+        out.push_back('\n');
+        return out;
+    }
+
+} // namespace tinylog
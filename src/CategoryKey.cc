@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CategoryKey.h"
+
+#include "LogName.h"
+
+namespace tinylog
+{
+    CategoryKey::CategoryKey(StringPiece name) : CategoryKey{name, 0}
+    {
+        hash_ = LogName::hashCanonical(name_);
+    }
+
+    CategoryKey::CategoryKey(StringPiece name, size_t hash) : hash_{hash}
+    {
+        if (LogName::isCanonical(name))
+        {
+            name_ = name;
+        }
+        else
+        {
+            storage_ = LogName::canonicalize(name);
+            name_ = storage_;
+        }
+    }
+
+    CategoryKey::CategoryKey(CanonicalTag, StringPiece canonicalName)
+        : name_{canonicalName}, hash_{LogName::hashCanonical(canonicalName)} {}
+
+    CategoryKey CategoryKey::parent() const
+    {
+        return CategoryKey{CanonicalTag{}, LogName::getParent(name_)};
+    }
+
+} // namespace tinylog
@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Format.h"
+
+#include <charconv>
+#include <stdexcept>
+
+#include "Conv.h"
+#include "ThreadLocalPool.h"
+
+namespace tinylog
+{
+    namespace detail
+    {
+        namespace
+        {
+            constexpr size_t kNumPooledBuffers = 8;
+
+            /**
+             * Buffers that grew beyond this are freed when released, so one
+             * huge message doesn't pin its memory for the life of the thread.
+             */
+            constexpr size_t kMaxRetainedCapacity = 64 * 1024;
+
+            using FormatBufferPool = ThreadLocalPool<std::string, kNumPooledBuffers>;
+
+            /**
+             * Append data, padded to the width in spec.
+             *
+             * Numbers are right-aligned.  When zero-padded, the zeros go after
+             * the first prefixLength characters, which hold the sign or the
+             * "0x" of a pointer.
+             */
+            void appendPadded(
+                std::string &out,
+                const char *data,
+                size_t size,
+                const FormatSpec &spec,
+                bool numeric,
+                size_t prefixLength = 0)
+            {
+                if (spec.width <= size)
+                {
+                    out.append(data, size);
+                    return;
+                }
+                size_t padding = spec.width - size;
+                if (!numeric)
+                {
+                    out.append(data, size);
+                    out.append(padding, ' ');
+                }
+                else if (spec.zeroPad)
+                {
+                    out.append(data, prefixLength);
+                    out.append(padding, '0');
+                    out.append(data + prefixLength, size - prefixLength);
+                }
+                else
+                {
+                    out.append(padding, ' ');
+                    out.append(data, size);
+                }
+            }
+
+            /**
+             * Write v in hexadecimal so that it ends just before end, and
+             * return a pointer to its first digit.
+             */
+            char *writeHex(uint64_t v, char *end, bool upper)
+            {
+                const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+                do
+                {
+                    *--end = digits[v & 0xf];
+                    v >>= 4;
+                } while (v != 0);
+                return end;
+            }
+
+            void appendInteger(
+                std::string &out,
+                uint64_t magnitude,
+                bool negative,
+                const FormatSpec &spec)
+            {
+                char buf[24];
+                char *end = buf + sizeof(buf);
+                char *begin;
+                if (spec.type == 'x' || spec.type == 'X')
+                {
+                    begin = writeHex(magnitude, end, spec.type == 'X');
+                }
+                else
+                {
+                    auto length = digits10(magnitude);
+                    begin = end - length;
+                    uint64ToBufferFixed(magnitude, begin, length);
+                }
+                if (negative)
+                {
+                    *--begin = '-';
+                }
+                appendPadded(out, begin, end - begin, spec, true, negative ? 1 : 0);
+            }
+
+            void appendDouble(std::string &out, double d, const FormatSpec &spec)
+            {
+                // Large enough for any double in fixed notation with the
+                // maximum precision of 99.
+                char buf[512];
+                std::to_chars_result result;
+                if (spec.type == 0 && spec.precision < 0)
+                {
+                    result = std::to_chars(buf, buf + sizeof(buf), d);
+                }
+                else
+                {
+                    auto format = std::chars_format::general;
+                    if (spec.type == 'f')
+                    {
+                        format = std::chars_format::fixed;
+                    }
+                    else if (spec.type == 'e')
+                    {
+                        format = std::chars_format::scientific;
+                    }
+                    int precision = spec.precision >= 0 ? spec.precision : 6;
+                    result = std::to_chars(buf, buf + sizeof(buf), d, format, precision);
+                }
+                size_t signLength = result.ptr > buf && buf[0] == '-' ? 1 : 0;
+                appendPadded(out, buf, result.ptr - buf, spec, true, signLength);
+            }
+
+            void appendArg(std::string &out, const FormatArg &arg, const FormatSpec &spec)
+            {
+                switch (arg.kind)
+                {
+                case FormatArgKind::INT:
+                {
+                    bool negative = arg.i < 0;
+                    auto magnitude = negative ? uint64_t{0} - static_cast<uint64_t>(arg.i)
+                                              : static_cast<uint64_t>(arg.i);
+                    appendInteger(out, magnitude, negative, spec);
+                    return;
+                }
+                case FormatArgKind::UINT:
+                    appendInteger(out, arg.u, false, spec);
+                    return;
+                case FormatArgKind::BOOL:
+                    if (arg.u)
+                    {
+                        appendPadded(out, "true", 4, spec, false);
+                    }
+                    else
+                    {
+                        appendPadded(out, "false", 5, spec, false);
+                    }
+                    return;
+                case FormatArgKind::CHAR:
+                    if (spec.type == 'd' || spec.type == 'x' || spec.type == 'X')
+                    {
+                        appendInteger(out, static_cast<unsigned char>(arg.u), false, spec);
+                    }
+                    else
+                    {
+                        char c = static_cast<char>(arg.u);
+                        appendPadded(out, &c, 1, spec, false);
+                    }
+                    return;
+                case FormatArgKind::DOUBLE:
+                    appendDouble(out, arg.d, spec);
+                    return;
+                case FormatArgKind::STRING:
+                    appendPadded(out, arg.s.data, arg.s.size, spec, false);
+                    return;
+                case FormatArgKind::POINTER:
+                {
+                    char buf[24];
+                    char *end = buf + sizeof(buf);
+                    char *begin = writeHex(
+                        reinterpret_cast<uintptr_t>(arg.p), end, spec.type == 'X');
+                    *--begin = 'x';
+                    *--begin = '0';
+                    appendPadded(out, begin, end - begin, spec, true, 2);
+                    return;
+                }
+                case FormatArgKind::UNSUPPORTED:
+                    break;
+                }
+            }
+
+        } // namespace
+
+        const char *getFormatErrorMessage(FormatError error)
+        {
+            switch (error)
+            {
+            case FormatError::NONE:
+                return "no error";
+            case FormatError::UNMATCHED_BRACE:
+                return "unmatched brace";
+            case FormatError::BAD_SPEC:
+                return "invalid replacement field";
+            case FormatError::TOO_FEW_ARGS:
+                return "too few arguments";
+            case FormatError::TOO_MANY_ARGS:
+                return "too many arguments";
+            case FormatError::TYPE_MISMATCH:
+                return "argument type does not match replacement field";
+            }
+            return "unknown error";
+        }
+
+        void throwFormatError(StringPiece fmt, FormatError error)
+        {
+            throw std::invalid_argument(
+                std::string("invalid format string \"") + fmt.str() +
+                "\": " + getFormatErrorMessage(error));
+        }
+
+        void formatTo(
+            std::string &out, StringPiece fmt, const FormatArg *args, size_t numArgs)
+        {
+            const char *p = fmt.data();
+            const char *end = p + fmt.size();
+            size_t argIndex = 0;
+            while (p < end)
+            {
+                // Copy the literal text up to the next brace.
+                const char *brace = p;
+                while (brace < end && *brace != '{' && *brace != '}')
+                {
+                    ++brace;
+                }
+                out.append(p, brace - p);
+                if (brace == end)
+                {
+                    break;
+                }
+
+                // The format string has been checked, so a brace is either
+                // doubled or starts a valid replacement field.
+                if (brace + 1 < end && brace[1] == *brace)
+                {
+                    out.push_back(*brace);
+                    p = brace + 2;
+                    continue;
+                }
+                int pos = static_cast<int>(brace + 1 - fmt.data());
+                FormatSpec spec;
+                parseFormatField(fmt, pos, spec);
+                if (argIndex < numArgs)
+                {
+                    appendArg(out, args[argIndex++], spec);
+                }
+                p = fmt.data() + pos;
+            }
+        }
+
+        std::string *acquireFormatBuffer(bool &pooled)
+        {
+            if (auto *buffer = FormatBufferPool::tryAcquire())
+            {
+                buffer->clear();
+                pooled = true;
+                return buffer;
+            }
+            pooled = false;
+            return new std::string();
+        }
+
+        void releaseFormatBuffer(std::string *buffer, bool pooled) noexcept
+        {
+            if (!pooled)
+            {
+                delete buffer;
+                return;
+            }
+            auto shrink = [](std::string &str)
+            {
+                if (str.capacity() > kMaxRetainedCapacity)
+                {
+                    std::string().swap(str);
+                }
+            };
+            FormatBufferPool::release(buffer, shrink);
+        }
+
+    } // namespace detail
+
+} // namespace tinylog
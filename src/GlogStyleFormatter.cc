@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GlogStyleFormatter.h"
+
+#include <time.h>
+
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+#include "Conv.h"
+#include "LogLevel.h"
+#include "LogMessage.h"
+
+namespace
+{
+    using tinylog::LogLevel;
+
+    char getGlogLevelChar(LogLevel level)
+    {
+        if (level <= LogLevel::DBG)
+        {
+            return 'V';
+        }
+        else if (level <= LogLevel::INFO)
+        {
+            return 'I';
+        }
+        else if (level <= LogLevel::WARN)
+        {
+            return 'W';
+        }
+        else if (level <= LogLevel::ERROR)
+        {
+            return 'E';
+        }
+        else if (level <= LogLevel::CRITICAL)
+        {
+            return 'C';
+        }
+        return 'F';
+    }
+
+    int64_t floorDiv(int64_t a, int64_t b)
+    {
+        auto q = a / b;
+        return (q * b > a) ? q - 1 : q;
+    }
+
+    /**
+     * The "MMDD HH:MM:SS." part of the header, which has a fixed length.
+     */
+    constexpr size_t kDateTimeLength = 14;
+    constexpr size_t kMicrosecondsLength = 6;
+    constexpr size_t kThreadIdWidth = 5;
+
+    /**
+     * Per-thread cache of the local time rendering of the current second.
+     */
+    struct LocalTimeCache
+    {
+        int64_t offsetSlot{std::numeric_limits<int64_t>::min()};
+        int64_t utcOffset{0};
+        int64_t second{std::numeric_limits<int64_t>::min()};
+        char dateTime[kDateTimeLength];
+    };
+    thread_local LocalTimeCache localTimeCache;
+
+    int64_t lookUpUtcOffset(int64_t utcSeconds)
+    {
+        time_t t = static_cast<time_t>(utcSeconds);
+        struct tm ltime;
+        if (!localtime_r(&t, &ltime))
+        {
+            return 0;
+        }
+        return ltime.tm_gmtoff;
+    }
+
+    /**
+     * Render the month, day and time of the local time at utcSeconds.
+     *
+     * The calendar date is computed from the day number with the
+     * days-to-civil algorithm, so this doesn't touch the time zone lock
+     * taken by localtime_r().
+     */
+    void renderDateTime(LocalTimeCache &cache, int64_t utcSeconds)
+    {
+        constexpr int64_t kSlot =
+            tinylog::GlogStyleFormatter::kUtcOffsetCacheSeconds;
+        auto slot = floorDiv(utcSeconds, kSlot);
+        if (slot != cache.offsetSlot)
+        {
+            cache.utcOffset = lookUpUtcOffset(slot * kSlot);
+            cache.offsetSlot = slot;
+        }
+
+        auto local = utcSeconds + cache.utcOffset;
+        auto days = floorDiv(local, 86400);
+        auto secondOfDay = local - days * 86400;
+
+        // Convert days since 1970-01-01 to a month and day, in a calendar
+        // whose years start on March 1st so that leap days come last.
+        auto z = days + 719468;
+        auto era = floorDiv(z, 146097);
+        auto dayOfEra = z - era * 146097;
+        auto yearOfEra =
+            (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        auto dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        auto shiftedMonth = (5 * dayOfYear + 2) / 153;
+        auto day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+        auto month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+
+        char *p = cache.dateTime;
+        tinylog::uint64ToBufferFixed(static_cast<uint64_t>(month), p, 2);
+        tinylog::uint64ToBufferFixed(static_cast<uint64_t>(day), p + 2, 2);
+        p[4] = ' ';
+        tinylog::uint64ToBufferFixed(static_cast<uint64_t>(secondOfDay / 3600), p + 5, 2);
+        p[7] = ':';
+        tinylog::uint64ToBufferFixed(
+            static_cast<uint64_t>(secondOfDay / 60 % 60), p + 8, 2);
+        p[10] = ':';
+        tinylog::uint64ToBufferFixed(static_cast<uint64_t>(secondOfDay % 60), p + 11, 2);
+        p[13] = '.';
+        cache.second = utcSeconds;
+    }
+
+} // namespace
+
+namespace tinylog
+{
+    constexpr int64_t GlogStyleFormatter::kUtcOffsetCacheSeconds;
+
+    std::string GlogStyleFormatter::formatMessage(
+        const LogMessage &message, const LogCategory * /* handlerCategory */)
+    {
+        auto usecsSinceEpoch = std::chrono::duration_cast<std::chrono::microseconds>(
+                                   message.getTimestamp().time_since_epoch())
+                                   .count();
+        auto seconds = floorDiv(usecsSinceEpoch, 1000000);
+        auto usecs = usecsSinceEpoch - seconds * 1000000;
+
+        auto &cache = localTimeCache;
+        if (seconds != cache.second)
+        {
+            renderDateTime(cache, seconds);
+        }
+
+        auto basename = message.getFileBaseName();
+        auto context = message.getContexString();
+        auto threadID = message.getThreadID();
+        auto lineNumber = message.getLineNumber();
+        auto threadIdLength = digits10(threadID);
+        auto threadIdPadding =
+            threadIdLength < kThreadIdWidth ? kThreadIdWidth - threadIdLength : 0;
+
+        size_t headerLength = 1 + kDateTimeLength + kMicrosecondsLength + 1 +
+                              threadIdPadding + threadIdLength + 1 +
+                              basename.size() + 1 + digits10(lineNumber) +
+                              context.size() + 2;
+
+        auto msgData = message.getMessage();
+        auto numLines = message.getNumNewlines() + 1;
+        std::string buffer;
+        buffer.reserve(numLines * (headerLength + 1) + msgData.size());
+        buffer.resize(headerLength);
+
+        // Render the header: "E0517 12:34:56.789012  1234 file.cc:123] "
+        char *p = &buffer[0];
+        *p++ = getGlogLevelChar(message.getLevel());
+        memcpy(p, cache.dateTime, kDateTimeLength);
+        p += kDateTimeLength;
+        uint64ToBufferFixed(static_cast<uint64_t>(usecs), p, kMicrosecondsLength);
+        p += kMicrosecondsLength;
+        *p++ = ' ';
+        memset(p, ' ', threadIdPadding);
+        p += threadIdPadding;
+        p += uint64ToBufferUnsafe(threadID, p);
+        *p++ = ' ';
+        memcpy(p, basename.data(), basename.size());
+        p += basename.size();
+        *p++ = ':';
+        p += uint64ToBufferUnsafe(lineNumber, p);
+        memcpy(p, context.data(), context.size());
+        p += context.size();
+        *p++ = ']';
+        *p++ = ' ';
+
+        if (numLines == 1)
+        {
+            buffer.append(msgData.data(), msgData.size());
+            buffer.push_back('\n');
+            return buffer;
+        }
+
+        // If there are multiple lines in the log message, add a header
+        // before each one.
+        const char *data = msgData.data();
+        const char *end = data + msgData.size();
+        while (true)
+        {
+            auto *newline = static_cast<const char *>(memchr(data, '\n', end - data));
+            auto *lineEnd = newline ? newline : end;
+            buffer.append(data, lineEnd - data);
+            buffer.push_back('\n');
+            if (!newline)
+            {
+                break;
+            }
+            data = newline + 1;
+            buffer.append(buffer.data(), headerLength);
+        }
+        return buffer;
+    }
+
+} // namespace tinylog
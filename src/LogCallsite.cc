@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogCallsite.h"
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tinylog
+{
+    namespace
+    {
+        /**
+         * A callsite created at runtime, together with the strings it refers to.
+         */
+        struct InternedCallsite
+        {
+            InternedCallsite(
+                StringPiece filename,
+                unsigned int lineNumber,
+                StringPiece functionName,
+                StringPiece categoryName,
+                LogLevel level)
+                : filenameStr{filename.str()},
+                  functionNameStr{functionName.str()},
+                  categoryNameStr{categoryName.str()},
+                  callsite{filenameStr, lineNumber, functionNameStr, categoryNameStr, level} {}
+
+            std::string const filenameStr;
+            std::string const functionNameStr;
+            std::string const categoryNameStr;
+            LogCallsite const callsite;
+        };
+
+        /**
+         * The intern map key.  For entries in the map it points into the
+         * InternedCallsite strings; for lookups it points at the caller's
+         * arguments, so a lookup never allocates.
+         */
+        struct InternKey
+        {
+            StringPiece filename;
+            unsigned int lineNumber;
+            StringPiece functionName;
+            StringPiece categoryName;
+            LogLevel level;
+
+            bool operator==(const InternKey &other) const
+            {
+                return lineNumber == other.lineNumber && level == other.level &&
+                       filename == other.filename &&
+                       functionName == other.functionName &&
+                       categoryName == other.categoryName;
+            }
+        };
+
+        struct InternKeyHash
+        {
+            size_t operator()(const InternKey &key) const
+            {
+                auto hashPiece = [](StringPiece sp)
+                {
+                    // FNV-1a
+                    uint64_t hash = 14695981039346656037ULL;
+                    for (char c : sp)
+                    {
+                        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ULL;
+                    }
+                    return hash;
+                };
+                auto hash = hashPiece(key.filename);
+                hash = hash * 31 + key.lineNumber;
+                hash = hash * 31 + hashPiece(key.functionName);
+                hash = hash * 31 + hashPiece(key.categoryName);
+                hash = hash * 31 + static_cast<uint32_t>(key.level);
+                return hash;
+            }
+        };
+
+        struct RegistryState
+        {
+            std::mutex mutex;
+            std::vector<const LogCallsite *> callsites;
+            std::unordered_map<InternKey, std::unique_ptr<InternedCallsite>, InternKeyHash>
+                interned;
+        };
+
+        RegistryState &getRegistryState()
+        {
+            // Intentionally leaked: callsites may be used during static
+            // destruction.
+            static auto &instance = *new RegistryState();
+            return instance;
+        }
+
+        bool callsiteMatches(const LogCallsite *callsite, const InternKey &key)
+        {
+            return callsite->getLineNumber() == key.lineNumber &&
+                   callsite->getLevel() == key.level &&
+                   callsite->getFileName() == key.filename &&
+                   callsite->getFunctionName() == key.functionName &&
+                   callsite->getCategoryName() == key.categoryName;
+        }
+    } // namespace
+
+    uint32_t LogCallsite::registerSlow() const
+    {
+        return LogCallsiteRegistry::registerCallsite(this);
+    }
+
+    uint32_t LogCallsiteRegistry::registerCallsite(const LogCallsite *callsite)
+    {
+        auto &state = getRegistryState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        // Another thread may have registered this callsite while we waited.
+        auto id = callsite->id_.load(std::memory_order_relaxed);
+        if (id == 0)
+        {
+            state.callsites.push_back(callsite);
+            id = static_cast<uint32_t>(state.callsites.size());
+            callsite->id_.store(id, std::memory_order_release);
+        }
+        return id;
+    }
+
+    const LogCallsite *LogCallsiteRegistry::lookup(uint32_t id)
+    {
+        auto &state = getRegistryState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (id == 0 || id > state.callsites.size())
+        {
+            return nullptr;
+        }
+        return state.callsites[id - 1];
+    }
+
+    size_t LogCallsiteRegistry::getNumCallsites()
+    {
+        auto &state = getRegistryState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        return state.callsites.size();
+    }
+
+    const LogCallsite *LogCallsiteRegistry::intern(
+        StringPiece filename,
+        unsigned int lineNumber,
+        StringPiece functionName,
+        StringPiece categoryName,
+        LogLevel level)
+    {
+        InternKey key{filename, lineNumber, functionName, categoryName, level};
+
+        // Code logging through the LogMessage constructors usually logs from a
+        // handful of places in a row, so check a few recent results first.
+        static constexpr size_t kCacheSize = 4;
+        static thread_local std::array<const LogCallsite *, kCacheSize> recent{};
+        static thread_local size_t nextSlot = 0;
+        for (const auto *callsite : recent)
+        {
+            if (callsite && callsiteMatches(callsite, key))
+            {
+                return callsite;
+            }
+        }
+
+        const LogCallsite *result;
+        {
+            auto &state = getRegistryState();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            auto it = state.interned.find(key);
+            if (it != state.interned.end())
+            {
+                result = &it->second->callsite;
+            }
+            else
+            {
+                auto interned = std::make_unique<InternedCallsite>(
+                    filename, lineNumber, functionName, categoryName, level);
+                InternKey storedKey{
+                    interned->filenameStr,
+                    lineNumber,
+                    interned->functionNameStr,
+                    interned->categoryNameStr,
+                    level};
+                result = &interned->callsite;
+                state.interned.emplace(storedKey, std::move(interned));
+            }
+        }
+
+        recent[nextSlot] = result;
+        nextSlot = (nextSlot + 1) % kCacheSize;
+        return result;
+    }
+
+} // namespace tinylog
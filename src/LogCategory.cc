@@ -16,27 +16,438 @@
 
 #include "LogCategory.h"
 
+#include <unistd.h>
+
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include "LogHandler.h"
+#include "LogMessage.h"
+#include "LoggerDB.h"
+#include "Rcu.h"
 
 namespace tinylog
 {
     LogCategory::LogCategory(LoggerDB *db)
         : effectiveLevel_{LogLevel::ERROR},
-          level_{static_cast<uint32_t>(LogLevel::ERROR)},
+          dispatchList_{new DispatchList()},
           parent_{nullptr},
+          db_{db},
           name_{},
-          db_{} {}
+          level_{static_cast<uint32_t>(LogLevel::ERROR)} {}
 
     LogCategory::LogCategory(StringPiece name, LogCategory *parent)
         : effectiveLevel_{parent->getEffectiveLevel()},
-          level_{static_cast<uint32_t>(LogLevel::MAX_LEVEL) | FLAG_INHERIT},
           parent_{parent},
-          name_{LogName::canonicalize(name)},
           db_{parent->getDB()},
-          nextSibling_{parent_->firstChild_}
+          name_{name},
+          level_{static_cast<uint32_t>(LogLevel::MAX_LEVEL) | FLAG_INHERIT},
+          nextSibling_{parent_->firstChild_.load(std::memory_order_relaxed)}
+    {
+        while (!parent_->firstChild_.compare_exchange_weak(
+            nextSibling_, this, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+        for (auto *ancestor = parent_; ancestor != nullptr; ancestor = ancestor->parent_)
+        {
+            ancestor->numDescendants_.fetch_add(1, std::memory_order_relaxed);
+        }
+        rebuildDispatchList();
+    }
+
+    LogCategory::~LogCategory()
+    {
+        delete dispatchList_.load(std::memory_order_relaxed);
+    }
+
+    void LogCategory::admitMessage(const LogMessage &message) const
+    {
+        // The list cannot be freed while we hold the reader.  The load is
+        // sequentially consistent so that it is ordered after the reader's
+        // counter update; see RcuDomain::synchronize().
+        RcuReader reader;
+        const auto *dispatchList = dispatchList_.load(std::memory_order_seq_cst);
+
+        // A reference-counted copy of the message, built the first time a
+        // handler needs to keep the message, and then reused for every other
+        // such handler.
+        std::shared_ptr<const LogMessage> shared;
+        for (const auto &entry : *dispatchList)
+        {
+            if (message.getLevel() < entry.minLevel)
+            {
+                // minLevel never decreases, so no later handler wants it either.
+                break;
+            }
+            try
+            {
+                if (entry.handler->keepsMessages())
+                {
+                    // Copy the message once, however many handlers up the
+                    // category hierarchy need to keep it.
+                    if (!shared)
+                    {
+                        shared = makeSharedLogMessage(message);
+                    }
+                    entry.handler->handleSharedMessage(shared, entry.category);
+                }
+                else
+                {
+                    entry.handler->handleMessage(message, entry.category);
+                }
+            }
+            catch (const std::exception &ex)
+            {
+                // Log a message to stderr, since logging the error through the
+                // normal flow could end up right back at the failing handler.
+                fprintf(stderr,
+                        "log handler for category \"%.*s\" threw an error: %s\n",
+                        entry.category->name_.size(), entry.category->name_.data(),
+                        ex.what());
+            }
+        }
+
+        // If this is a fatal message, flush the handlers to make sure the log
+        // message was written out, then crash.
+        if (isLogLevelFatal(message.getLevel()))
+        {
+            auto numHandlers = db_->flushAllHandlers();
+            if (numHandlers == 0)
+            {
+                // No log handlers were configured.
+                // Print the message to stderr, to make sure we always print the
+                // reason we are crashing somewhere.
+                auto msg = std::string{"FATAL:"} + message.getFileName().str() +
+                           ":" + std::to_string(message.getLineNumber()) + ": " +
+                           message.getRawMessage().str();
+                if (msg.empty() || msg.back() != '\n')
+                {
+                    msg.push_back('\n');
+                }
+                auto written = write(STDERR_FILENO, msg.data(), msg.size());
+                (void)written;
+            }
+            std::abort();
+        }
+    }
+
+    void LogCategory::rebuildDispatchList()
+    {
+        auto list = std::make_unique<DispatchList>();
+        // Our parent's list only changes with the tree lock held exclusively,
+        // so it is stable while we copy it.
+        const auto *parentList =
+            parent_ ? parent_->dispatchList_.load(std::memory_order_acquire) : nullptr;
+        auto propagateLevel =
+            propagateLevelMessagesToParent_.load(std::memory_order_relaxed);
+
+        {
+            std::lock_guard<std::mutex> lock(handlersMutex_);
+            list->reserve(handlers_.size() + (parentList ? parentList->size() : 0));
+            for (const auto &handler : handlers_)
+            {
+                // Our own handlers see every message admitted here.
+                list->push_back({LogLevel::UNINITIALIZED, handler, this});
+            }
+        }
+        if (parentList)
+        {
+            for (const auto &entry : *parentList)
+            {
+                list->push_back(
+                    {std::max(entry.minLevel, propagateLevel), entry.handler,
+                     entry.category});
+            }
+        }
+
+        // Other threads may still be dispatching through the old list.
+        std::unique_ptr<const DispatchList> oldList{
+            dispatchList_.exchange(list.release(), std::memory_order_acq_rel)};
+        RcuDomain::getDefault().retire(std::move(oldList));
+    }
+
+    void LogCategory::updateDispatchListsLocked()
+    {
+        // Walk the subtree iteratively: category trees can be deep.  Each
+        // category is rebuilt before its children are pushed, so they see
+        // its new list.
+        std::vector<LogCategory *> pending{this};
+        while (!pending.empty())
+        {
+            auto *category = pending.back();
+            pending.pop_back();
+            category->rebuildDispatchList();
+            for (auto *child = category->firstChild_.load(std::memory_order_acquire);
+                 child != nullptr;
+                 child = child->nextSibling_)
+            {
+                pending.push_back(child);
+            }
+        }
+    }
+
+    void LogCategory::setLevel(LogLevel level, bool inherit)
+    {
+        // We have to set the level through LoggerDB, since we require holding
+        // the LoggerDB tree lock to iterate through our children in case our effective
+        // level changes.
+        db_->setLevel(this, level, inherit);
+    }
+
+    void LogCategory::setPropagateLevelMessagesToParent(LogLevel level)
+    {
+        propagateLevelMessagesToParent_.store(level, std::memory_order_relaxed);
+        db_->updateDispatchLists(this);
+    }
+
+    LogLevel LogCategory::getPropagateLevelMessagesToParentRelaxed() const
+    {
+        return propagateLevelMessagesToParent_.load(std::memory_order_relaxed);
+    }
+
+    void LogCategory::setLevelLocked(LogLevel level, bool inherit)
+    {
+        // Clamp the value to MIN_LEVEL and MAX_LEVEL.
+        //
+        // This makes sure that UNINITIALIZED is always less than any valid level
+        // value, and that level values cannot conflict with our flag bits.
+        level = std::max(LogLevel::MIN_LEVEL, std::min(level, LogLevel::MAX_LEVEL));
+
+        // Make sure the inherit flag is always off for the root logger.
+        if (!parent_)
+        {
+            inherit = false;
+        }
+        auto newValue = static_cast<uint32_t>(level);
+        if (inherit)
+        {
+            newValue |= FLAG_INHERIT;
+        }
+
+        // Update the stored value
+        uint32_t oldValue = level_.exchange(newValue, std::memory_order_acq_rel);
+
+        // Break out early if the value has not changed.
+        if (oldValue == newValue)
+        {
+            return;
+        }
+
+        // Update the effective log level
+        LogLevel newEffectiveLevel;
+        if (inherit)
+        {
+            newEffectiveLevel = std::min(level, parent_->getEffectiveLevel());
+        }
+        else
+        {
+            newEffectiveLevel = level;
+        }
+        updateEffectiveLevel(newEffectiveLevel);
+    }
+
+    void LogCategory::updateEffectiveLevel(LogLevel newEffectiveLevel)
+    {
+        // Break out early if the value did not change.
+        if (!storeEffectiveLevel(newEffectiveLevel))
+        {
+            return;
+        }
+
+        std::vector<SiblingRange> pending;
+        size_t numThreads = db_ ? db_->getLevelPropagationThreads() : 1;
+        propagateToChildren(pending, numThreads);
+        propagateEffectiveLevel(std::move(pending), numThreads);
+    }
+
+    bool LogCategory::storeEffectiveLevel(LogLevel newEffectiveLevel)
+    {
+        auto oldEffectiveLevel =
+            effectiveLevel_.exchange(newEffectiveLevel, std::memory_order_acq_rel);
+        if (newEffectiveLevel == oldEffectiveLevel)
+        {
+            return false;
+        }
+
+        // Update all of the values in xlogLevel_
+        for (auto *levelPtr : xlogLevel_)
+        {
+            levelPtr->store(newEffectiveLevel, std::memory_order_release);
+        }
+        return true;
+    }
+
+    bool LogCategory::parentLevelUpdated(LogLevel parentEffectiveLevel)
+    {
+        uint32_t levelValue = level_.load(std::memory_order_acquire);
+        auto inherit = (levelValue & FLAG_INHERIT);
+        if (!inherit)
+        {
+            return false;
+        }
+
+        auto myLevel = static_cast<LogLevel>(levelValue & ~FLAG_INHERIT);
+        return storeEffectiveLevel(std::min(myLevel, parentEffectiveLevel));
+    }
+
+    void LogCategory::propagateEffectiveLevel(
+        std::vector<SiblingRange> pending, size_t numThreads)
+    {
+        // A depth-first walk in sibling order, so each category is updated
+        // right after its parent.  A category whose effective level did not
+        // change cannot change any of its descendants', so its children are
+        // never visited.
+        while (!pending.empty())
+        {
+            auto range = pending.back();
+            pending.pop_back();
+            if (range.first == range.end)
+            {
+                continue;
+            }
+            auto parentLevel = range.first->parent_->getEffectiveLevel();
+            for (auto *category = range.first; category != range.end;
+                 category = category->nextSibling_)
+            {
+                if (category->parentLevelUpdated(parentLevel) &&
+                    category->firstChild_.load(std::memory_order_acquire))
+                {
+                    // Finish this category's subtree before its siblings.
+                    pending.push_back({category->nextSibling_, range.end});
+                    category->propagateToChildren(pending, numThreads);
+                    break;
+                }
+            }
+        }
+    }
+
+    void LogCategory::propagateToChildren(
+        std::vector<SiblingRange> &pending, size_t numThreads)
+    {
+        LogCategory *firstChild = firstChild_.load(std::memory_order_acquire);
+        auto numDescendants = numDescendants_.load(std::memory_order_relaxed);
+        if (numThreads < 2 || numDescendants < kMinParallelSubtree)
+        {
+            pending.push_back({firstChild, nullptr});
+            return;
+        }
+
+        // Split the children into up to numThreads runs of siblings with
+        // roughly the same number of categories in each.  The runs are
+        // disjoint subtrees, and the caller holds the tree lock exclusively,
+        // so they can be updated independently.  Each thread walks its run
+        // sequentially.
+        std::vector<SiblingRange> runs{{firstChild, nullptr}};
+        size_t runSize = 0;
+        size_t targetSize = numDescendants / numThreads + 1;
+        for (LogCategory *child = firstChild; child != nullptr; child = child->nextSibling_)
+        {
+            if (runSize >= targetSize && runs.size() < numThreads)
+            {
+                runs.back().end = child;
+                runs.push_back({child, nullptr});
+                runSize = 0;
+            }
+            runSize += child->numDescendants_.load(std::memory_order_relaxed) + 1;
+        }
+        if (runs.size() == 1)
+        {
+            // A single child holds most of the subtree, so split below it.
+            pending.push_back(runs[0]);
+            return;
+        }
+
+        std::vector<std::thread> threads;
+        size_t n = 1;
+        try
+        {
+            for (; n < runs.size(); ++n)
+            {
+                threads.emplace_back(
+                    propagateEffectiveLevel, std::vector<SiblingRange>{runs[n]}, size_t(1));
+            }
+        }
+        catch (const std::system_error &)
+        {
+            // Walk the runs we could not start a thread for ourselves.
+            for (; n < runs.size(); ++n)
+            {
+                propagateEffectiveLevel({runs[n]}, 1);
+            }
+        }
+        propagateEffectiveLevel({runs[0]}, 1);
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    void LogCategory::registerXlogLevel(std::atomic<LogLevel> *levelPtr)
+    {
+        xlogLevel_.push_back(levelPtr);
+    }
+
+    void LogCategory::addHandler(std::shared_ptr<LogHandler> handler)
+    {
+        {
+            std::lock_guard<std::mutex> lock(handlersMutex_);
+            handlers_.emplace_back(std::move(handler));
+        }
+        db_->updateDispatchLists(this);
+    }
+
+    void LogCategory::clearHandlers()
+    {
+        std::vector<std::shared_ptr<LogHandler>> emptyHandlersList;
+        // Swap out the handlers list with the handlers_ lock held.
+        {
+            std::lock_guard<std::mutex> lock(handlersMutex_);
+            handlers_.swap(emptyHandlersList);
+        }
+        db_->updateDispatchLists(this);
+        // Destroy emptyHandlersList now that the handlers_ lock is released.
+        // This way we don't hold the handlers_ lock while invoking any of the
+        // LogHandler destructors.
+    }
+
+    std::vector<std::shared_ptr<LogHandler>> LogCategory::getHandlers() const
+    {
+        std::lock_guard<std::mutex> lock(handlersMutex_);
+        return handlers_;
+    }
+
+    void LogCategory::replaceHandlers(
+        std::vector<std::shared_ptr<LogHandler>> handlers)
+    {
+        {
+            std::lock_guard<std::mutex> lock(handlersMutex_);
+            handlers_.swap(handlers);
+        }
+        db_->updateDispatchLists(this);
+        // The old handlers are destroyed here, without the lock held.
+    }
+
+    void LogCategory::updateHandlers(const std::unordered_map<
+                                     std::shared_ptr<LogHandler>,
+                                     std::shared_ptr<LogHandler>> &handlerMap)
     {
-        parent_->firstChild_ = this;
+        {
+            std::lock_guard<std::mutex> lock(handlersMutex_);
+            for (auto &entry : handlers_)
+            {
+                auto iter = handlerMap.find(entry);
+                if (iter != handlerMap.end())
+                {
+                    entry = iter->second;
+                }
+            }
+        }
+        db_->updateDispatchLists(this);
     }
 
 } // namespace tinylog
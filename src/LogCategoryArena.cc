@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogCategoryArena.h"
+
+#include <cstring>
+#include <new>
+
+#include "LogCategory.h"
+
+namespace tinylog
+{
+    constexpr size_t LogCategoryArena::kCategoriesPerBlock;
+    constexpr size_t LogCategoryArena::kNameBlockSize;
+
+    LogCategoryArena::LogCategoryArena() {}
+
+    LogCategoryArena::~LogCategoryArena()
+    {
+        // Children point at their parents, and parents are always created
+        // first, so destroy the categories newest first.
+        for (auto it = categories_.rbegin(); it != categories_.rend(); ++it)
+        {
+            (*it)->~LogCategory();
+        }
+    }
+
+    void LogCategoryArena::BlockDeleter::operator()(void *block) const
+    {
+        ::operator delete(block, std::align_val_t{alignof(LogCategory)});
+    }
+
+    LogCategory *LogCategoryArena::createRoot(LoggerDB *db)
+    {
+        auto *category = new (allocateCategory()) LogCategory(db);
+        categories_.push_back(category);
+        return category;
+    }
+
+    LogCategory *LogCategoryArena::create(StringPiece name, LogCategory *parent)
+    {
+        auto interned = intern(name);
+        auto *category = new (allocateCategory()) LogCategory(interned, parent);
+        categories_.push_back(category);
+        return category;
+    }
+
+    void *LogCategoryArena::allocateCategory()
+    {
+        if (categoriesInBlock_ == kCategoriesPerBlock)
+        {
+            categoryBlocks_.emplace_back(::operator new(
+                sizeof(LogCategory) * kCategoriesPerBlock,
+                std::align_val_t{alignof(LogCategory)}));
+            categoriesInBlock_ = 0;
+        }
+        auto *block = static_cast<char *>(categoryBlocks_.back().get());
+        return block + sizeof(LogCategory) * categoriesInBlock_++;
+    }
+
+    StringPiece LogCategoryArena::intern(StringPiece name)
+    {
+        size_t size = name.size();
+        if (size > nameSpace_)
+        {
+            // Give unusually long names a block of their own, rather than
+            // wasting the rest of the current one.
+            if (size > kNameBlockSize / 4)
+            {
+                nameBlocks_.emplace_back(new char[size]);
+                std::memcpy(nameBlocks_.back().get(), name.data(), size);
+                return StringPiece(nameBlocks_.back().get(), name.size());
+            }
+            nameBlocks_.emplace_back(new char[kNameBlockSize]);
+            nameCursor_ = nameBlocks_.back().get();
+            nameSpace_ = kNameBlockSize;
+        }
+        char *result = nameCursor_;
+        std::memcpy(result, name.data(), size);
+        nameCursor_ += size;
+        nameSpace_ -= size;
+        return StringPiece(result, name.size());
+    }
+
+} // namespace tinylog
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogCategoryMap.h"
+
+#include "LogCategory.h"
+
+namespace tinylog
+{
+    constexpr size_t LogCategoryMap::kInitialCapacity;
+
+    LogCategoryMap::LogCategoryMap()
+    {
+        tables_.emplace_back(new Table(kInitialCapacity));
+        table_.store(tables_.back().get(), std::memory_order_release);
+    }
+
+    LogCategoryMap::~LogCategoryMap() {}
+
+    LogCategory *LogCategoryMap::find(const CategoryKey &key) const noexcept
+    {
+        // The table is at most half full, so the probe always ends at an
+        // empty slot within a few steps.
+        const Table *table = table_.load(std::memory_order_acquire);
+        const size_t hash = key.hash();
+        for (size_t idx = hash & table->mask;; idx = (idx + 1) & table->mask)
+        {
+            const Slot &slot = table->slots[idx];
+            auto *category = slot.category.load(std::memory_order_acquire);
+            if (!category)
+            {
+                return nullptr;
+            }
+            if (slot.hash.load(std::memory_order_relaxed) == hash &&
+                key.matches(category->getName()))
+            {
+                return category;
+            }
+        }
+    }
+
+    LogCategory *LogCategoryMap::insertRoot(LoggerDB *db)
+    {
+        CategoryKey key{""};
+        auto *category = arena_.createRoot(db);
+        add(key.hash(), category);
+        return category;
+    }
+
+    LogCategory *LogCategoryMap::insert(const CategoryKey &key, LogCategory *parent)
+    {
+        return insert(key, parent, [](LogCategory *) {});
+    }
+
+    void LogCategoryMap::add(size_t hash, LogCategory *category)
+    {
+        // Keep the load factor at or below one half.  The arena already
+        // counts the new category.
+        auto *table = table_.load(std::memory_order_relaxed);
+        if (arena_.size() * 2 > table->capacity())
+        {
+            grow();
+            table = table_.load(std::memory_order_relaxed);
+        }
+        table->add(hash, category);
+    }
+
+    void LogCategoryMap::Table::add(size_t hash, LogCategory *category)
+    {
+        for (size_t idx = hash & mask;; idx = (idx + 1) & mask)
+        {
+            Slot &slot = slots[idx];
+            if (!slot.category.load(std::memory_order_relaxed))
+            {
+                slot.hash.store(hash, std::memory_order_relaxed);
+                slot.category.store(category, std::memory_order_release);
+                return;
+            }
+        }
+    }
+
+    void LogCategoryMap::grow()
+    {
+        auto *oldTable = table_.load(std::memory_order_relaxed);
+        std::unique_ptr<Table> newTable{new Table(oldTable->capacity() * 2)};
+        for (size_t idx = 0; idx < oldTable->capacity(); ++idx)
+        {
+            const Slot &slot = oldTable->slots[idx];
+            auto *category = slot.category.load(std::memory_order_relaxed);
+            if (category)
+            {
+                newTable->add(slot.hash.load(std::memory_order_relaxed), category);
+            }
+        }
+
+        // Publish the new table.  Readers still probing the old one find
+        // the same categories there, so it is retired rather than freed.
+        table_.store(newTable.get(), std::memory_order_release);
+        tables_.push_back(std::move(newTable));
+    }
+
+} // namespace tinylog
@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogClock.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define TINYLOG_HAVE_TSC 1
+#else
+#define TINYLOG_HAVE_TSC 0
+#endif
+
+using std::chrono::nanoseconds;
+using std::chrono::system_clock;
+
+namespace
+{
+    int64_t readClockNs(clockid_t clock)
+    {
+        struct timespec ts;
+        clock_gettime(clock, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    system_clock::time_point toTimePoint(int64_t ns)
+    {
+        return system_clock::time_point{
+            std::chrono::duration_cast<system_clock::duration>(nanoseconds{ns})};
+    }
+
+    uint64_t readTsc()
+    {
+#if TINYLOG_HAVE_TSC
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    /**
+     * The number of attempts takeSample() makes to get a narrow sample.
+     */
+    constexpr int kMaxSampleAttempts = 16;
+
+    /**
+     * takeSample() stops early once it gets a sample this narrow.
+     */
+    constexpr int64_t kGoodSampleWindowNs = 1000;
+
+} // namespace
+
+namespace tinylog
+{
+    constexpr std::chrono::milliseconds TscLogClock::kDefaultRecalibrationInterval;
+    constexpr std::chrono::milliseconds TscLogClock::kInitialCalibrationInterval;
+    constexpr std::chrono::microseconds TscLogClock::kMaxSampleWindow;
+    constexpr std::chrono::microseconds TscLogClock::kMaxDrift;
+
+    std::shared_ptr<LogClock> LogClock::create(LogClockType type)
+    {
+        switch (type)
+        {
+        case LogClockType::SYSTEM:
+            return std::make_shared<SystemLogClock>();
+        case LogClockType::REALTIME_COARSE:
+            return std::make_shared<CoarseLogClock>();
+        case LogClockType::TSC:
+            if (TscLogClock::isSupported())
+            {
+                return std::make_shared<TscLogClock>();
+            }
+            return std::make_shared<SystemLogClock>();
+        }
+        throw std::invalid_argument("unknown LogClockType");
+    }
+
+    SystemLogClock &SystemLogClock::instance()
+    {
+        // Leaked so that messages logged during static destruction can still
+        // use it.
+        static auto *clock = new SystemLogClock();
+        return *clock;
+    }
+
+    LogClock::time_point CoarseLogClock::now() const
+    {
+        return toTimePoint(readClockNs(CLOCK_REALTIME_COARSE));
+    }
+
+    nanoseconds CoarseLogClock::getResolution()
+    {
+        struct timespec ts;
+        clock_getres(CLOCK_REALTIME_COARSE, &ts);
+        return std::chrono::seconds{ts.tv_sec} + nanoseconds{ts.tv_nsec};
+    }
+
+    TscLogClock::TscLogClock(std::chrono::milliseconds recalibrationInterval)
+        : recalibrationInterval_{recalibrationInterval}
+    {
+        if (!isSupported())
+        {
+            throw std::runtime_error("this CPU does not have an invariant TSC");
+        }
+
+        rateBase_ = takeSample();
+        std::this_thread::sleep_for(kInitialCalibrationInterval);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            updateLocked(takeSample());
+        }
+        thread_ = std::thread([this]
+                              { recalibrationLoop(); });
+    }
+
+    TscLogClock::~TscLogClock()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    bool TscLogClock::isSupported()
+    {
+#if TINYLOG_HAVE_TSC
+        static bool const supported = []
+        {
+            unsigned int eax, ebx, ecx, edx;
+            if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+            {
+                return false;
+            }
+            // CPUID.80000007H:EDX[8] is the invariant TSC flag.
+            return (edx & (1u << 8)) != 0;
+        }();
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    LogClock::time_point TscLogClock::now() const
+    {
+        uint64_t seq;
+        uint64_t baseTsc;
+        int64_t baseRealtimeNs;
+        uint64_t nsPerTick;
+        do
+        {
+            seq = calibration_.seq.load(std::memory_order_acquire);
+            baseTsc = calibration_.baseTsc.load(std::memory_order_relaxed);
+            baseRealtimeNs =
+                calibration_.baseRealtimeNs.load(std::memory_order_relaxed);
+            nsPerTick = calibration_.nsPerTick.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((seq & 1) ||
+                 seq != calibration_.seq.load(std::memory_order_relaxed));
+
+        uint64_t tsc = readTsc();
+        int64_t offsetNs;
+        if (tsc >= baseTsc)
+        {
+            offsetNs = static_cast<int64_t>(
+                (static_cast<unsigned __int128>(tsc - baseTsc) * nsPerTick) >> kShift);
+        }
+        else
+        {
+            offsetNs = -static_cast<int64_t>(
+                (static_cast<unsigned __int128>(baseTsc - tsc) * nsPerTick) >> kShift);
+        }
+        return toTimePoint(baseRealtimeNs + offsetNs);
+    }
+
+    void TscLogClock::recalibrate()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        updateLocked(takeSample());
+    }
+
+    double TscLogClock::getTicksPerSecond() const
+    {
+        auto nsPerTick = calibration_.nsPerTick.load(std::memory_order_relaxed);
+        return 1e9 * static_cast<double>(uint64_t{1} << kShift) /
+               static_cast<double>(nsPerTick);
+    }
+
+    TscLogClock::Sample TscLogClock::takeSample()
+    {
+        Sample best{0, 0, 0, std::numeric_limits<int64_t>::max()};
+        for (int attempt = 0; attempt < kMaxSampleAttempts; ++attempt)
+        {
+            // CLOCK_MONOTONIC brackets the other two readings, so the width
+            // of the bracket bounds the error in pairing them up.
+            auto monotonicBefore = readClockNs(CLOCK_MONOTONIC);
+            auto tsc = readTsc();
+            auto realtime = readClockNs(CLOCK_REALTIME);
+            auto monotonicAfter = readClockNs(CLOCK_MONOTONIC);
+
+            auto window = monotonicAfter - monotonicBefore;
+            if (window < best.windowNs)
+            {
+                best = Sample{tsc, realtime, monotonicBefore + window / 2, window};
+            }
+            if (window <= kGoodSampleWindowNs)
+            {
+                break;
+            }
+        }
+        return best;
+    }
+
+    void TscLogClock::updateLocked(const Sample &sample)
+    {
+        auto nsPerTick = calibration_.nsPerTick.load(std::memory_order_relaxed);
+        if (nsPerTick != 0 && nanoseconds{sample.windowNs} > kMaxSampleWindow)
+        {
+            return;
+        }
+
+        // Only adopt a new rate if it was measured over a baseline at least
+        // as long as the time it will be used for.  Otherwise just move the
+        // offset, which resets the drift accumulated under the current rate.
+        auto intervalNs = nanoseconds{recalibrationInterval_}.count();
+        auto baseline = sample.monotonicNs - rateBase_.monotonicNs;
+        if (baseline > 0 && sample.tsc > rateBase_.tsc &&
+            baseline >= std::min(intervalNs, rateBaselineNs_))
+        {
+            nsPerTick = static_cast<uint64_t>(
+                (static_cast<unsigned __int128>(baseline) << kShift) /
+                (sample.tsc - rateBase_.tsc));
+            rateBaselineNs_ = baseline;
+            if (baseline >= intervalNs)
+            {
+                rateBase_ = sample;
+            }
+        }
+
+        auto seq = calibration_.seq.load(std::memory_order_relaxed);
+        calibration_.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        calibration_.baseTsc.store(sample.tsc, std::memory_order_relaxed);
+        calibration_.baseRealtimeNs.store(
+            sample.realtimeNs, std::memory_order_relaxed);
+        calibration_.nsPerTick.store(nsPerTick, std::memory_order_relaxed);
+        calibration_.seq.store(seq + 2, std::memory_order_release);
+    }
+
+    nanoseconds TscLogClock::getNextIntervalLocked() const
+    {
+        return std::min<nanoseconds>(
+            recalibrationInterval_, nanoseconds{rateBaselineNs_});
+    }
+
+    void TscLogClock::recalibrationLoop()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            auto deadline = std::chrono::steady_clock::now() + getNextIntervalLocked();
+            if (cv_.wait_until(lock, deadline, [this]
+                               { return stop_; }))
+            {
+                return;
+            }
+            updateLocked(takeSample());
+        }
+    }
+
+} // namespace tinylog
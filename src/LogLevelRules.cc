@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogLevelRules.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "LogName.h"
+
+namespace tinylog
+{
+    namespace
+    {
+        /**
+         * Split the next component off the front of a canonical name.
+         */
+        StringPiece nextComponent(StringPiece &name)
+        {
+            const char *dot =
+                static_cast<const char *>(std::memchr(name.data(), '.', name.size()));
+            if (!dot)
+            {
+                StringPiece component = name;
+                name = StringPiece{};
+                return component;
+            }
+            StringPiece component{name.data(), static_cast<int>(dot - name.data())};
+            name.remove_prefix(component.size() + 1);
+            return component;
+        }
+    } // namespace
+
+    LogLevelRules::LogLevelRules() : nodes_(1), edges_(16) {}
+
+    const LogLevelRules::Rule &LogLevelRules::add(
+        StringPiece pattern, LogLevel level, bool inherit)
+    {
+        auto canonicalPattern = LogName::canonicalize(pattern);
+        StringPiece remaining{canonicalPattern};
+        uint32_t node = 0;
+        while (!remaining.empty())
+        {
+            node = getOrAddChild(node, nextComponent(remaining));
+        }
+
+        nodes_[node].rule = static_cast<uint32_t>(rules_.size());
+        rules_.push_back(Rule{std::move(canonicalPattern), level, inherit});
+        return rules_.back();
+    }
+
+    uint32_t LogLevelRules::getOrAddChild(uint32_t node, StringPiece component)
+    {
+        uint32_t *child;
+        bool repeats = false;
+        if (component == "**")
+        {
+            // "**.**" matches the same names as "**".
+            if (nodes_[node].repeats)
+            {
+                return node;
+            }
+            child = &nodes_[node].anyComponents;
+            repeats = true;
+        }
+        else if (component == "*")
+        {
+            child = &nodes_[node].anyComponent;
+        }
+        else if (std::memchr(component.data(), '*', component.size()))
+        {
+            throw std::invalid_argument(
+                "log level rule components may only use '*' as \"*\" or \"**\": " +
+                component.str());
+        }
+        else
+        {
+            auto hash = LogName::hashCanonical(component);
+            auto existing = findChild(node, component, hash);
+            if (existing != kNone)
+            {
+                return existing;
+            }
+
+            // Keep the load factor at or below one half.
+            if ((numEdges_ + 1) * 2 > edges_.size())
+            {
+                std::vector<Edge> oldEdges(edges_.size() * 2);
+                oldEdges.swap(edges_);
+                for (auto &edge : oldEdges)
+                {
+                    if (edge.child != kNone)
+                    {
+                        insertEdge(std::move(edge));
+                    }
+                }
+            }
+            uint32_t newNode = static_cast<uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+            insertEdge(Edge{node, newNode, hash, component.str()});
+            ++numEdges_;
+            return newNode;
+        }
+
+        if (*child == kNone)
+        {
+            *child = static_cast<uint32_t>(nodes_.size());
+            // Adding the node may move the one child points into.
+            uint32_t newNode = *child;
+            nodes_.emplace_back();
+            nodes_[newNode].repeats = repeats;
+            return newNode;
+        }
+        return *child;
+    }
+
+    size_t LogLevelRules::edgeIndex(uint32_t node, size_t hash) const
+    {
+        constexpr uint64_t kMultiplier = 0x9e3779b97f4a7c15ULL;
+        return ((hash ^ (node * kMultiplier)) * kMultiplier >> 32) & (edges_.size() - 1);
+    }
+
+    void LogLevelRules::insertEdge(Edge edge)
+    {
+        size_t mask = edges_.size() - 1;
+        size_t idx = edgeIndex(edge.parent, edge.hash);
+        while (edges_[idx].child != kNone)
+        {
+            idx = (idx + 1) & mask;
+        }
+        edges_[idx] = std::move(edge);
+    }
+
+    uint32_t LogLevelRules::findChild(
+        uint32_t node, StringPiece component, size_t hash) const
+    {
+        size_t mask = edges_.size() - 1;
+        for (size_t idx = edgeIndex(node, hash);; idx = (idx + 1) & mask)
+        {
+            const auto &edge = edges_[idx];
+            if (edge.child == kNone)
+            {
+                return kNone;
+            }
+            if (edge.parent == node && edge.hash == hash &&
+                StringPiece{edge.component} == component)
+            {
+                return edge.child;
+            }
+        }
+    }
+
+    void LogLevelRules::addState(std::vector<uint32_t> &states, uint32_t node) const
+    {
+        // A "**" may match no components at all, so reaching a node also
+        // reaches the node after its "**" child.
+        while (node != kNone &&
+               std::find(states.begin(), states.end(), node) == states.end())
+        {
+            states.push_back(node);
+            node = nodes_[node].anyComponents;
+        }
+    }
+
+    const LogLevelRules::Rule *LogLevelRules::match(StringPiece canonicalName) const
+    {
+        if (rules_.empty())
+        {
+            return nullptr;
+        }
+
+        // The set of trie nodes that match the components seen so far.  This
+        // only ever holds a handful of nodes: one per pattern prefix that
+        // matches, not one per rule.  The sets are reused across calls to
+        // avoid allocating for every category created.
+        static thread_local std::vector<uint32_t> states;
+        static thread_local std::vector<uint32_t> nextStates;
+        states.clear();
+        addState(states, 0);
+        StringPiece remaining = canonicalName;
+        while (!remaining.empty())
+        {
+            auto component = nextComponent(remaining);
+            auto hash = LogName::hashCanonical(component);
+            nextStates.clear();
+            for (auto state : states)
+            {
+                const auto &node = nodes_[state];
+                if (node.repeats)
+                {
+                    addState(nextStates, state);
+                }
+                addState(nextStates, findChild(state, component, hash));
+                addState(nextStates, node.anyComponent);
+            }
+            if (nextStates.empty())
+            {
+                return nullptr;
+            }
+            states.swap(nextStates);
+        }
+
+        uint32_t best = kNone;
+        for (auto state : states)
+        {
+            auto rule = nodes_[state].rule;
+            if (rule != kNone && (best == kNone || rule > best))
+            {
+                best = rule;
+            }
+        }
+        return best == kNone ? nullptr : &rules_[best];
+    }
+
+} // namespace tinylog
@@ -16,7 +16,13 @@
 
 #include "LogMessage.h"
 
+#include <cstring>
+#include <thread>
+
 #include "LogCategory.h"
+#include "LogMessageSanitizer.h"
+#include "LoggerDB.h"
+#include "system/ThreadId.h"
 
 using std::chrono::system_clock;
 
@@ -26,29 +32,44 @@ namespace
     {
         return category->getDB()->getContextString();
     }
+
+    system_clock::time_point getTimestampFromCategory(
+        const tinylog::LogCategory *category)
+    {
+        return category->getDB()->now();
+    }
+
+    tinylog::StringPiece getCategoryName(const tinylog::LogCategory *category)
+    {
+        return category ? tinylog::StringPiece{category->getName()}
+                        : tinylog::StringPiece{};
+    }
 }
 
 namespace tinylog
 {
+    LogMessage::LogMessage(
+        const LogCategory *category,
+        LogLevel level,
+        const LogCallsite *callsite,
+        StringPiece msg)
+        : LogMessage(
+              category, level, getTimestampFromCategory(category), callsite, msg) {}
+
     LogMessage::LogMessage(
         const LogCategory *category,
         LogLevel level,
         StringPiece filename,
         unsigned int lineNumber,
         StringPiece functionName,
-        std::string &&msg)
-        : category_{category},
-          level_{level},
-          threadID_{getOSThreadID()},
-          timestamp_{system_clock::now()},
-          filename_{filename},
-          lineNumber_{lineNumber},
-          functionName_{functionName},
-          contextString_{getContexStringFromCategory(category_)},
-          rawMessage_{std::move(msg)}
-    {
-        sanitizeMessage();
-    }
+        StringPiece msg)
+        : LogMessage(
+              category,
+              level,
+              getTimestampFromCategory(category),
+              LogCallsiteRegistry::intern(
+                  filename, lineNumber, functionName, getCategoryName(category), level),
+              msg) {}
 
     LogMessage::LogMessage(
         const LogCategory *category,
@@ -57,101 +78,170 @@ namespace tinylog
         StringPiece filename,
         unsigned int lineNumber,
         StringPiece functionName,
-        std::string &&msg)
+        StringPiece msg)
+        : LogMessage(
+              category,
+              level,
+              timestamp,
+              LogCallsiteRegistry::intern(
+                  filename, lineNumber, functionName, getCategoryName(category), level),
+              msg) {}
+
+    LogMessage::LogMessage(
+        const LogCategory *category,
+        LogLevel level,
+        system_clock::time_point timestamp,
+        const LogCallsite *callsite,
+        StringPiece msg)
         : category_{category},
           level_{level},
           threadID_{getOSThreadID()},
           timestamp_{timestamp},
-          filename_{filename},
-          lineNumber_{lineNumber},
-          functionName_{functionName},
-          contextString_{getContexStringFromCategory(category_)},
-          rawMessage_{std::move(msg)}
+          callsite_{callsite}
     {
-        sanitizeMessage();
-    }
+        auto context = getContextStringFromCategory(category_);
+        if (static_cast<size_t>(msg.size() + context.size()) <= kInlineCapacity)
+        {
+            storeText(msg, context, 0);
+            return;
+        }
 
-    StringPiece LogMessage::getFileBaseName() const
-    {
-        auto idx = filename_.rfind('/');
-        if (idx == std::string::npos)
+        // The text goes to the heap, so sanitize it now: then the sanitized
+        // copy, if one is needed, can share the same heap block.
+        auto scan = detail::scanMessage(msg);
+        auto sanitizedLength = scan.numEscaped == 0
+                                   ? 0
+                                   : static_cast<size_t>(msg.size()) + 3 * scan.numEscaped;
+        char *sanitized = storeText(msg, context, sanitizedLength);
+        numNewlines_ = scan.numNewlines;
+        if (sanitizedLength > 0)
         {
-            return filename_;
+            detail::escapeMessage(rawMessage_, sanitized);
+            message_ = StringPiece(sanitized, static_cast<int>(sanitizedLength));
         }
-        return filename_.subpiece(idx + 1);
+        sanitizeState_.store(SANITIZED, std::memory_order_relaxed);
     }
 
-    void LogMessage::sanitizeMessage()
+    LogMessage::LogMessage(const LogMessage &other)
+        : category_{other.category_},
+          level_{other.level_},
+          threadID_{other.threadID_},
+          timestamp_{other.timestamp_},
+          callsite_{other.callsite_}
     {
-        // Compute how long the sanitized string will be.
-        size_t sanitizedLength = 0;
-        size_t numNewlines = 0;
-        for (const char c : rawMessage_)
+        // Only carry over the sanitized message if it is complete; otherwise
+        // this copy sanitizes its own rawMessage_ on demand.
+        bool sanitized =
+            other.sanitizeState_.load(std::memory_order_acquire) == SANITIZED;
+        auto length = sanitized ? static_cast<size_t>(other.message_.size()) : 0;
+        char *buffer = storeText(other.rawMessage_, other.contextString_, length);
+        if (sanitized)
         {
-            if (static_cast<unsigned char>(c) < 0x20)
+            numNewlines_ = other.numNewlines_;
+            if (length > 0)
             {
-                // Newlines and tabs are emitted directly with no escaping.
-                // All other control characters are emitted as \xNN (4 characters)
-                if (c == '\n')
-                {
-                    sanitizedLength += 1;
-                    ++numNewlines;
-                }
-                else if (c == '\t')
-                {
-                    sanitizedLength += 1;
-                }
-                else
+                if (!buffer)
                 {
-                    sanitizedLength += 4;
+                    buffer = allocateSanitized(length);
                 }
+                memcpy(buffer, other.message_.data(), length);
+                message_ = StringPiece(buffer, static_cast<int>(length));
             }
-            else if (c == 0x7f)
-            {
-                // Bytes above the ASCII range are emitted as \xNN (4 characters)
-                sanitizedLength += 4;
-            }
-            else
+            sanitizeState_.store(SANITIZED, std::memory_order_relaxed);
+        }
+    }
+
+    char *LogMessage::storeText(
+        StringPiece rawMessage, StringPiece context, size_t sanitizedLength)
+    {
+        auto rawLength = static_cast<size_t>(rawMessage.size());
+        auto contextLength = static_cast<size_t>(context.size());
+        auto total = rawLength + contextLength;
+
+        char *buffer;
+        char *sanitized = nullptr;
+        if (total <= kInlineCapacity)
+        {
+            buffer = inlineBuffer_;
+            inlineUsed_ = total;
+        }
+        else
+        {
+            heapBuffer_ = LogMessageArena::allocatePtr(total + sanitizedLength);
+            buffer = heapBuffer_.get();
+            inlineUsed_ = 0;
+            if (sanitizedLength > 0)
             {
-                // This character will be emitted as-is, with no escaping.
-                ++sanitizedLength;
+                sanitized = buffer + total;
             }
         }
-        numNewlines_ = numNewlines;
-        // If nothing is different, just use rawMessage_ directly,
-        // and don't populate message_.
-        if (sanitizedLength == rawMessage_.size())
+
+        if (rawLength > 0)
+        {
+            memcpy(buffer, rawMessage.data(), rawLength);
+        }
+        if (contextLength > 0)
+        {
+            memcpy(buffer + rawLength, context.data(), contextLength);
+        }
+        rawMessage_ = StringPiece(buffer, static_cast<int>(rawLength));
+        contextString_ = StringPiece(buffer + rawLength, static_cast<int>(contextLength));
+        return sanitized;
+    }
+
+    char *LogMessage::allocateSanitized(size_t length) const
+    {
+        if (length <= kInlineCapacity - inlineUsed_)
+        {
+            return inlineBuffer_ + inlineUsed_;
+        }
+        sanitizedBuffer_ = LogMessageArena::allocatePtr(length);
+        return sanitizedBuffer_.get();
+    }
+
+    SharedLogMessage makeSharedLogMessage(const LogMessage &message)
+    {
+        return std::allocate_shared<const LogMessage>(
+            LogMessageArenaAllocator<LogMessage>{}, message);
+    }
+
+    void LogMessage::sanitizeSlow() const
+    {
+        uint8_t expected = UNSANITIZED;
+        if (sanitizeState_.compare_exchange_strong(
+                expected, SANITIZING, std::memory_order_acquire))
         {
+            sanitizeMessage();
+            sanitizeState_.store(SANITIZED, std::memory_order_release);
             return;
         }
 
-        message_.reserve(sanitizedLength);
-        for (const char c : rawMessage_)
+        // Another thread is sanitizing the message.  This only takes as long
+        // as one pass over the message, so just wait for it.
+        while (sanitizeState_.load(std::memory_order_acquire) != SANITIZED)
         {
-            if (static_cast<unsigned char>(c) < 0x20)
-            {
-                if (c == '\n' || c == '\t')
-                {
-                    message_.push_back(c);
-                }
-                else
-                {
-                    static constexpr StringPiece hexdigits{"0123456789abcdef"};
-                    std::array<char, 4> data{
-                        {'\\', 'x', hexdigits[(c >> 4) & 0xf], hexdigits[c & 0xf]}};
-                    message_.append(data.data(), data.size());
-                }
-            }
-            else if (c == 0x7f)
-            {
-                constexpr std::array<char, 4> data{{'\\', 'x', '7', 'f'}};
-                message_.append(data.data(), data.size());
-            }
-            else
-            {
-                message_.push_back(c);
-            }
+            std::this_thread::yield();
         }
     }
 
+    void LogMessage::sanitizeMessage() const
+    {
+        // Compute how long the sanitized string will be.  Newlines and tabs
+        // are emitted directly with no escaping, while other control
+        // characters and DEL are emitted as \xNN (4 characters).
+        auto scan = detail::scanMessage(rawMessage_);
+        numNewlines_ = scan.numNewlines;
+        // If nothing is different, just use rawMessage_ directly,
+        // and don't populate message_.
+        if (scan.numEscaped == 0)
+        {
+            return;
+        }
+
+        auto length = static_cast<size_t>(rawMessage_.size()) + 3 * scan.numEscaped;
+        char *buffer = allocateSanitized(length);
+        detail::escapeMessage(rawMessage_, buffer);
+        message_ = StringPiece(buffer, static_cast<int>(length));
+    }
+
 } // namespace tinylog
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogMessageArena.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace tinylog
+{
+    namespace
+    {
+        struct Slab
+        {
+            /**
+             * The number of live allocations from this slab, plus one while
+             * a thread is still allocating from it.
+             */
+            std::atomic<size_t> refs{0};
+            size_t used{0};
+        };
+
+        /**
+         * Every allocation is preceded by a header pointing to its slab, or
+         * nullptr if it was allocated with malloc.
+         */
+        struct BlockHeader
+        {
+            Slab *slab;
+        };
+
+        constexpr size_t kAlignment = LogMessageArena::kAlignment;
+        static_assert(alignof(BlockHeader) <= kAlignment, "");
+        constexpr size_t kSlabDataOffset =
+            (sizeof(Slab) + kAlignment - 1) & ~(kAlignment - 1);
+        constexpr size_t kSlabCapacity =
+            LogMessageArena::kSlabSize - kSlabDataOffset;
+
+        char *slabData(Slab *slab)
+        {
+            return reinterpret_cast<char *>(slab) + kSlabDataOffset;
+        }
+
+        class SlabPool
+        {
+        public:
+            static SlabPool &get()
+            {
+                // Leaked so that messages freed during static destruction
+                // can still return their slabs.
+                static auto *pool = new SlabPool();
+                return *pool;
+            }
+
+            Slab *acquire()
+            {
+                Slab *slab = nullptr;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (!freeSlabs_.empty())
+                    {
+                        slab = freeSlabs_.back();
+                        freeSlabs_.pop_back();
+                    }
+                }
+                if (!slab)
+                {
+                    void *mem = malloc(LogMessageArena::kSlabSize);
+                    if (!mem)
+                    {
+                        throw std::bad_alloc();
+                    }
+                    slab = new (mem) Slab();
+                    numSlabs_.fetch_add(1, std::memory_order_relaxed);
+                }
+                slab->used = 0;
+                // The reference held by the allocating thread.
+                slab->refs.store(1, std::memory_order_relaxed);
+                return slab;
+            }
+
+            void release(Slab *slab) noexcept
+            {
+                if (slab->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                {
+                    return;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (freeSlabs_.size() < LogMessageArena::kMaxFreeSlabs)
+                    {
+                        freeSlabs_.push_back(slab);
+                        return;
+                    }
+                }
+                slab->~Slab();
+                free(slab);
+                numSlabs_.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            size_t getNumSlabs() const
+            {
+                return numSlabs_.load(std::memory_order_relaxed);
+            }
+
+            size_t getNumFreeSlabs()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return freeSlabs_.size();
+            }
+
+        private:
+            SlabPool() { freeSlabs_.reserve(LogMessageArena::kMaxFreeSlabs); }
+
+            std::mutex mutex_;
+            std::vector<Slab *> freeSlabs_;
+            std::atomic<size_t> numSlabs_{0};
+        };
+
+        /**
+         * The slab the current thread is allocating from.
+         *
+         * SlabReleaser hands it back to the SlabPool at thread exit and sets
+         * exited, so messages copied by later thread_local destructors are
+         * allocated with malloc instead of starting a slab nobody returns.
+         */
+        struct ThreadSlab
+        {
+            Slab *current{nullptr};
+            bool exited{false};
+        };
+        thread_local ThreadSlab threadSlab;
+
+        struct SlabReleaser
+        {
+            ~SlabReleaser()
+            {
+                if (threadSlab.current)
+                {
+                    SlabPool::get().release(threadSlab.current);
+                    threadSlab.current = nullptr;
+                }
+                threadSlab.exited = true;
+            }
+        };
+
+        char *allocateFromSystem(size_t size)
+        {
+            void *mem = malloc(sizeof(BlockHeader) + size);
+            if (!mem)
+            {
+                throw std::bad_alloc();
+            }
+            auto *header = new (mem) BlockHeader{nullptr};
+            return reinterpret_cast<char *>(header + 1);
+        }
+
+    } // namespace
+
+    char *LogMessageArena::allocate(size_t size)
+    {
+        size_t total =
+            (sizeof(BlockHeader) + size + kAlignment - 1) & ~(kAlignment - 1);
+        auto &ts = threadSlab;
+        if (size > kMaxArenaAllocation || ts.exited)
+        {
+            return allocateFromSystem(size);
+        }
+
+        Slab *slab = ts.current;
+        if (!slab || slab->used + total > kSlabCapacity)
+        {
+            auto &pool = SlabPool::get();
+            if (slab)
+            {
+                pool.release(slab);
+            }
+            else
+            {
+                static thread_local SlabReleaser releaser;
+                (void)releaser;
+            }
+            slab = pool.acquire();
+            ts.current = slab;
+        }
+
+        auto *header = new (slabData(slab) + slab->used) BlockHeader{slab};
+        slab->used += total;
+        slab->refs.fetch_add(1, std::memory_order_relaxed);
+        return reinterpret_cast<char *>(header + 1);
+    }
+
+    void LogMessageArena::deallocate(char *ptr) noexcept
+    {
+        if (!ptr)
+        {
+            return;
+        }
+        auto *header = reinterpret_cast<BlockHeader *>(ptr) - 1;
+        if (!header->slab)
+        {
+            free(header);
+            return;
+        }
+        SlabPool::get().release(header->slab);
+    }
+
+    size_t LogMessageArena::getNumSlabs()
+    {
+        return SlabPool::get().getNumSlabs();
+    }
+
+    size_t LogMessageArena::getNumFreeSlabs()
+    {
+        return SlabPool::get().getNumFreeSlabs();
+    }
+
+} // namespace tinylog
@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogMessageSanitizer.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define TINYLOG_SANITIZER_X86 1
+#else
+#define TINYLOG_SANITIZER_X86 0
+#endif
+
+namespace tinylog
+{
+    namespace detail
+    {
+        namespace
+        {
+            inline bool needsEscape(char c)
+            {
+                auto uc = static_cast<unsigned char>(c);
+                // Newlines and tabs are emitted directly with no escaping.
+                // All other control characters, and DEL, are emitted as \xNN.
+                return (uc < 0x20 && c != '\n' && c != '\t') || uc == 0x7f;
+            }
+
+            inline char *writeEscaped(char c, char *out)
+            {
+                static constexpr StringPiece hexdigits{"0123456789abcdef"};
+                out[0] = '\\';
+                out[1] = 'x';
+                out[2] = hexdigits[(c >> 4) & 0xf];
+                out[3] = hexdigits[c & 0xf];
+                return out + 4;
+            }
+
+            void scanScalar(
+                const char *p, const char *end, MessageScanResult &result)
+            {
+                for (; p != end; ++p)
+                {
+                    if (*p == '\n')
+                    {
+                        ++result.numNewlines;
+                    }
+                    else if (needsEscape(*p))
+                    {
+                        ++result.numEscaped;
+                    }
+                }
+            }
+
+            const char *findEscapeScalar(const char *p, const char *end)
+            {
+                while (p != end && !needsEscape(*p))
+                {
+                    ++p;
+                }
+                return p;
+            }
+
+#if TINYLOG_SANITIZER_X86
+            // The SIMD kernels classify a whole vector of bytes at once,
+            // producing masks of the bytes that need escaping and of the
+            // newlines.  SSE2 has no unsigned byte comparison, so
+            // "c <= 0x1f" is computed as "min(c, 0x1f) == c".
+
+            inline void classifySse2(__m128i v, __m128i &esc, __m128i &nl)
+            {
+                auto ctrl = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1f)), v);
+                nl = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+                auto tab = _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'));
+                auto del = _mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f));
+                esc = _mm_or_si128(_mm_andnot_si128(_mm_or_si128(nl, tab), ctrl), del);
+            }
+
+            inline size_t horizontalSumSse2(__m128i counts)
+            {
+                auto sums = _mm_sad_epu8(counts, _mm_setzero_si128());
+                return static_cast<size_t>(_mm_cvtsi128_si64(sums)) +
+                       static_cast<size_t>(_mm_extract_epi16(sums, 4));
+            }
+
+            void scanSse2(const char *p, const char *end, MessageScanResult &result)
+            {
+                // POPCNT is not part of the x86-64 baseline, so instead of
+                // counting mask bits this accumulates the 0xff compare results
+                // into per-byte counters, and sums them before they can
+                // overflow.
+                while (end - p >= 16)
+                {
+                    auto escCounts = _mm_setzero_si128();
+                    auto nlCounts = _mm_setzero_si128();
+                    for (int n = 0; n < 255 && end - p >= 16; ++n, p += 16)
+                    {
+                        __m128i esc;
+                        __m128i nl;
+                        classifySse2(
+                            _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), esc, nl);
+                        escCounts = _mm_sub_epi8(escCounts, esc);
+                        nlCounts = _mm_sub_epi8(nlCounts, nl);
+                    }
+                    result.numEscaped += horizontalSumSse2(escCounts);
+                    result.numNewlines += horizontalSumSse2(nlCounts);
+                }
+                scanScalar(p, end, result);
+            }
+
+            const char *findEscapeSse2(const char *p, const char *end)
+            {
+                for (; end - p >= 16; p += 16)
+                {
+                    __m128i esc;
+                    __m128i nl;
+                    classifySse2(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), esc, nl);
+                    auto escapeMask = static_cast<uint32_t>(_mm_movemask_epi8(esc));
+                    if (escapeMask != 0)
+                    {
+                        return p + __builtin_ctz(escapeMask);
+                    }
+                }
+                return findEscapeScalar(p, end);
+            }
+
+            __attribute__((target("avx2"))) inline void classifyAvx2(
+                __m256i v, uint32_t &escapeMask, uint32_t &newlineMask)
+            {
+                auto ctrl = _mm256_cmpeq_epi8(
+                    _mm256_min_epu8(v, _mm256_set1_epi8(0x1f)), v);
+                auto nl = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+                auto tab = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'));
+                auto del = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7f));
+                auto esc = _mm256_or_si256(
+                    _mm256_andnot_si256(_mm256_or_si256(nl, tab), ctrl), del);
+                escapeMask = static_cast<uint32_t>(_mm256_movemask_epi8(esc));
+                newlineMask = static_cast<uint32_t>(_mm256_movemask_epi8(nl));
+            }
+
+            __attribute__((target("avx2,popcnt"))) void scanAvx2(
+                const char *p, const char *end, MessageScanResult &result)
+            {
+                for (; end - p >= 32; p += 32)
+                {
+                    uint32_t escapeMask;
+                    uint32_t newlineMask;
+                    classifyAvx2(
+                        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)),
+                        escapeMask,
+                        newlineMask);
+                    result.numEscaped += __builtin_popcount(escapeMask);
+                    result.numNewlines += __builtin_popcount(newlineMask);
+                }
+                scanSse2(p, end, result);
+            }
+
+            __attribute__((target("avx2"))) const char *findEscapeAvx2(
+                const char *p, const char *end)
+            {
+                for (; end - p >= 32; p += 32)
+                {
+                    uint32_t escapeMask;
+                    uint32_t newlineMask;
+                    classifyAvx2(
+                        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)),
+                        escapeMask,
+                        newlineMask);
+                    if (escapeMask != 0)
+                    {
+                        return p + __builtin_ctz(escapeMask);
+                    }
+                }
+                return findEscapeSse2(p, end);
+            }
+#endif // TINYLOG_SANITIZER_X86
+
+            SanitizerIsa detectBestSanitizerIsa()
+            {
+#if TINYLOG_SANITIZER_X86
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+                {
+                    return SanitizerIsa::AVX2;
+                }
+                // SSE2 is part of the x86-64 baseline.
+                return SanitizerIsa::SSE2;
+#else
+                return SanitizerIsa::SCALAR;
+#endif
+            }
+
+            template <typename Find>
+            char *escapeWith(tinylog::StringPiece msg, char *out, Find find)
+            {
+                const char *p = msg.begin();
+                const char *end = msg.end();
+                while (true)
+                {
+                    // Copy the run of bytes that need no escaping in one go.
+                    const char *next = find(p, end);
+                    memcpy(out, p, next - p);
+                    out += next - p;
+                    if (next == end)
+                    {
+                        return out;
+                    }
+                    out = writeEscaped(*next, out);
+                    p = next + 1;
+                }
+            }
+
+        } // namespace
+
+        SanitizerIsa getBestSanitizerIsa()
+        {
+            static const SanitizerIsa best = detectBestSanitizerIsa();
+            return best;
+        }
+
+        bool isSanitizerIsaSupported(SanitizerIsa isa)
+        {
+            return static_cast<int>(isa) <= static_cast<int>(getBestSanitizerIsa());
+        }
+
+        const char *getSanitizerIsaName(SanitizerIsa isa)
+        {
+            switch (isa)
+            {
+            case SanitizerIsa::SCALAR:
+                return "scalar";
+            case SanitizerIsa::SSE2:
+                return "sse2";
+            case SanitizerIsa::AVX2:
+                return "avx2";
+            }
+            return "unknown";
+        }
+
+        MessageScanResult scanMessage(tinylog::StringPiece msg)
+        {
+            return scanMessage(msg, getBestSanitizerIsa());
+        }
+
+        MessageScanResult scanMessage(tinylog::StringPiece msg, SanitizerIsa isa)
+        {
+            MessageScanResult result;
+            switch (isa)
+            {
+#if TINYLOG_SANITIZER_X86
+            case SanitizerIsa::AVX2:
+                scanAvx2(msg.begin(), msg.end(), result);
+                break;
+            case SanitizerIsa::SSE2:
+                scanSse2(msg.begin(), msg.end(), result);
+                break;
+#endif
+            default:
+                scanScalar(msg.begin(), msg.end(), result);
+                break;
+            }
+            return result;
+        }
+
+        char *escapeMessage(tinylog::StringPiece msg, char *out)
+        {
+            return escapeMessage(msg, out, getBestSanitizerIsa());
+        }
+
+        char *escapeMessage(tinylog::StringPiece msg, char *out, SanitizerIsa isa)
+        {
+            switch (isa)
+            {
+#if TINYLOG_SANITIZER_X86
+            case SanitizerIsa::AVX2:
+                return escapeWith(msg, out, findEscapeAvx2);
+            case SanitizerIsa::SSE2:
+                return escapeWith(msg, out, findEscapeSse2);
+#endif
+            default:
+                return escapeWith(msg, out, findEscapeScalar);
+            }
+        }
+
+    } // namespace detail
+
+} // namespace tinylog
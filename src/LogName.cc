@@ -16,83 +16,119 @@
 
 #include "LogName.h"
 
-namespace
-{
-    constexpr bool isSeparator(char c)
-    {
-        return c == '.' || c == '/';
-    }
-} // namespace
+#include <cstring>
 
 namespace tinylog
 {
     std::string LogName::canonicalize(StringPiece input)
     {
-        std::string cname;
-        cname.reserve(input.size());
+        std::string cname(input.size(), '\0');
+        cname.resize(canonicalizeTo(input, &cname[0]));
+        return cname;
+    }
 
-        // Ignore trailing category separator characters
-        size_t end = input.size();
-        while (end > 0 && isSeparator(input[end - 1]))
-        {
-            --end;
-        }
+    namespace
+    {
+        /**
+         * Names at least this long are hashed a word at a time.  Shorter
+         * names are not worth the setup, and most category names are short.
+         */
+        constexpr size_t kWordHashThreshold = 32;
 
-        bool ignoreSeparator = true;
-        for (size_t idx = 0; idx < end; ++idx)
+        constexpr uint32_t pow33(unsigned int n)
         {
-            if (isSeparator(input[idx]))
+            uint32_t result = 1;
+            while (n-- > 0)
             {
-                if (ignoreSeparator)
-                {
-                    continue;
-                }
-                cname.push_back('.');
-                ignoreSeparator = true;
+                result *= 33;
             }
-            else
+            return result;
+        }
+
+        /**
+         * Return c0 * 33^7 + c1 * 33^6 + ... + c7 (mod 2^32), where c0 is the
+         * first of the 8 bytes at data.
+         *
+         * Feeding 8 bytes through the "hash * 33 + c" step of LogName::hash()
+         * is the same as multiplying the hash by 33^8 and adding this, and
+         * computing it with SWAR arithmetic needs 3 multiplications instead
+         * of a chain of 8 dependent ones.
+         */
+        inline uint32_t hashWord(const char *data)
+        {
+            uint64_t word;
+            std::memcpy(&word, data, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            word = __builtin_bswap64(word);
+#endif
+            // Combine adjacent bytes into 16-bit lanes: c0 * 33 + c1, ...
+            // These are at most 255 * 34, so lanes never carry into each other.
+            constexpr uint64_t kLowBytes = 0x00ff00ff00ff00ffULL;
+            uint64_t pairs = (word & kLowBytes) * 33 + ((word >> 8) & kLowBytes);
+
+            // Then adjacent 16-bit lanes into 32-bit lanes, which hold at most
+            // 255 * 34 * 1090.
+            constexpr uint64_t kLowPairs = 0x0000ffff0000ffffULL;
+            uint64_t quads =
+                (pairs & kLowPairs) * pow33(2) + ((pairs >> 16) & kLowPairs);
+
+            return static_cast<uint32_t>(quads) * pow33(4) +
+                   static_cast<uint32_t>(quads >> 32);
+        }
+
+    } // namespace
+
+    size_t LogName::hashCanonical(StringPiece name)
+    {
+        // This must produce exactly the same values as hash(), since XLOG()
+        // statements compute their hashes at compile time with hash().
+        uint32_t hash = 5381;
+        const char *data = name.data();
+        size_t size = name.size();
+        size_t idx = 0;
+        if (size >= kWordHashThreshold)
+        {
+            for (; idx + 8 <= size; idx += 8)
             {
-                cname.push_back(input[idx]);
-                ignoreSeparator = false;
+                hash = hash * pow33(8) + hashWord(data + idx);
             }
         }
-        return cname;
+        for (; idx < size; ++idx)
+        {
+            hash = ((hash << 5) + hash) + static_cast<uint8_t>(data[idx]);
+        }
+        return hash;
     }
 
-    size_t LogName::hash(StringPiece name)
+    bool LogName::isCanonical(StringPiece name)
     {
-        // Code based on StringPiece::hash(), but which ignores leading and trailing
-        // category separator characters, as well as multiple consecutive separator
-        // characters, so equivalent names result in the same hash.
-        uint32_t hash = 5381;
-
-        size_t end = name.size();
-        while (end > 0 && isSeparator(name[end - 1]))
+        if (name.empty())
         {
-            --end;
+            return true;
         }
-
-        bool ignoreSeparator = true;
-        for (size_t idx = 0; idx < end; ++idx)
+        if (name.front() == '.' || name.back() == '.')
         {
-            uint8_t value;
-            if (isSeparator(name[idx]))
-            {
-                if (ignoreSeparator)
-                {
-                    continue;
-                }
-                value = '.';
-                ignoreSeparator = true;
-            }
-            else
+            return false;
+        }
+        // Names are mostly letters, so skip between separators with memchr()
+        // rather than checking one character at a time.
+        const char *data = name.data();
+        const char *end = data + name.size();
+        if (std::memchr(data, '/', name.size()) != nullptr)
+        {
+            return false;
+        }
+        for (auto *dot = static_cast<const char *>(std::memchr(data, '.', name.size()));
+             dot != nullptr;
+             dot = static_cast<const char *>(std::memchr(dot + 1, '.', end - dot - 1)))
+        {
+            // The name does not end with '.', so dot + 1 is in bounds.
+            if (dot[1] == '.')
             {
-                value = static_cast<uint8_t>(name[idx]);
-                ignoreSeparator = false;
+                return false;
             }
-            hash = ((hash << 5) + hash) + value;
         }
-        return hash;
+        return true;
     }
 
     int LogName::cmp(StringPiece a, StringPiece b)
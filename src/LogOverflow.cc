@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogOverflow.h"
+
+#include <stdexcept>
+
+namespace tinylog
+{
+    LogOverflowPolicy stringToLogOverflowPolicy(StringPiece name)
+    {
+        if (name == "block")
+        {
+            return LogOverflowPolicy::BLOCK;
+        }
+        else if (name == "drop_newest")
+        {
+            return LogOverflowPolicy::DROP_NEWEST;
+        }
+        else if (name == "drop_oldest")
+        {
+            return LogOverflowPolicy::DROP_OLDEST;
+        }
+        else if (name == "drop_below_level")
+        {
+            return LogOverflowPolicy::DROP_BELOW_LEVEL;
+        }
+        throw std::invalid_argument("unknown log overflow policy: " + name.str());
+    }
+
+    StringPiece logOverflowPolicyToString(LogOverflowPolicy policy)
+    {
+        switch (policy)
+        {
+        case LogOverflowPolicy::BLOCK:
+            return "block";
+        case LogOverflowPolicy::DROP_NEWEST:
+            return "drop_newest";
+        case LogOverflowPolicy::DROP_OLDEST:
+            return "drop_oldest";
+        case LogOverflowPolicy::DROP_BELOW_LEVEL:
+            return "drop_below_level";
+        }
+        return "unknown";
+    }
+
+    LogDropCounters::Bucket LogDropCounters::getBucket(LogLevel level)
+    {
+        if (level < LogLevel::INFO)
+        {
+            return BUCKET_DBG;
+        }
+        else if (level < LogLevel::WARN)
+        {
+            return BUCKET_INFO;
+        }
+        else if (level < LogLevel::ERROR)
+        {
+            return BUCKET_WARN;
+        }
+        else if (level < LogLevel::CRITICAL)
+        {
+            return BUCKET_ERROR;
+        }
+        else if (level < LogLevel::DFATAL)
+        {
+            return BUCKET_CRITICAL;
+        }
+        return BUCKET_FATAL;
+    }
+
+    void LogDropCounters::recordDrop(LogLevel level)
+    {
+        auto bucket = getBucket(level);
+        total_[bucket].fetch_add(1, std::memory_order_relaxed);
+        pending_[bucket].fetch_add(1, std::memory_order_relaxed);
+        unreported_.fetch_add(1, std::memory_order_release);
+    }
+
+    uint64_t LogDropCounters::getNumDropped(LogLevel level) const
+    {
+        return total_[getBucket(level)].load(std::memory_order_relaxed);
+    }
+
+    uint64_t LogDropCounters::getNumDropped() const
+    {
+        uint64_t total = 0;
+        for (const auto &count : total_)
+        {
+            total += count.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    std::string LogDropCounters::takeDropSummary()
+    {
+        if (unreported_.load(std::memory_order_acquire) == 0)
+        {
+            return std::string();
+        }
+
+        static constexpr std::array<StringPiece, NUM_BUCKETS> bucketNames{
+            {"DEBUG", "INFO", "WARN", "ERROR", "CRITICAL", "FATAL"}};
+
+        uint64_t numDropped = 0;
+        std::string details;
+        for (size_t bucket = 0; bucket < NUM_BUCKETS; ++bucket)
+        {
+            auto count = pending_[bucket].exchange(0, std::memory_order_relaxed);
+            if (count == 0)
+            {
+                continue;
+            }
+            numDropped += count;
+            if (!details.empty())
+            {
+                details.append(", ");
+            }
+            details.append(bucketNames[bucket].data(), bucketNames[bucket].size());
+            details.append(": ");
+            details.append(std::to_string(count));
+        }
+        unreported_.fetch_sub(numDropped, std::memory_order_relaxed);
+        if (numDropped == 0)
+        {
+            return std::string();
+        }
+
+        return "tinylog: " + std::to_string(numDropped) +
+               " log messages dropped (" + details + ")\n";
+    }
+
+} // namespace tinylog
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogStream.h"
+
+#include <cstring>
+
+#include "ThreadLocalPool.h"
+
+namespace tinylog
+{
+    namespace
+    {
+        constexpr size_t kNumPooledStreams = 4;
+
+        using LogStreamPool = detail::ThreadLocalPool<LogStream, kNumPooledStreams>;
+
+    } // namespace
+
+    constexpr size_t LogStreamBuffer::kInitialCapacity;
+    constexpr size_t LogStreamBuffer::kMaxRetainedCapacity;
+
+    LogStreamBuffer::LogStreamBuffer() : str_(kInitialCapacity, '\0')
+    {
+        setp(&str_[0], &str_[0] + str_.size());
+    }
+
+    void LogStreamBuffer::reset()
+    {
+        if (str_.size() > kMaxRetainedCapacity)
+        {
+            std::string(kInitialCapacity, '\0').swap(str_);
+        }
+        setp(&str_[0], &str_[0] + str_.size());
+    }
+
+    void LogStreamBuffer::grow(size_t minExtra)
+    {
+        auto used = static_cast<size_t>(pptr() - pbase());
+        auto newSize = str_.size() * 2;
+        if (newSize < used + minExtra)
+        {
+            newSize = used + minExtra;
+        }
+        str_.resize(newSize);
+        setp(&str_[0], &str_[0] + str_.size());
+        advance(used);
+    }
+
+    void LogStreamBuffer::advance(size_t n)
+    {
+        // pbump() takes an int, so advance in steps for very large messages.
+        constexpr size_t kMaxStep = 0x40000000;
+        while (n > 0)
+        {
+            auto step = n > kMaxStep ? kMaxStep : n;
+            pbump(static_cast<int>(step));
+            n -= step;
+        }
+    }
+
+    LogStreamBuffer::int_type LogStreamBuffer::overflow(int_type ch)
+    {
+        if (ch == traits_type::eof())
+        {
+            return traits_type::not_eof(ch);
+        }
+        grow(1);
+        *pptr() = static_cast<char>(ch);
+        pbump(1);
+        return ch;
+    }
+
+    std::streamsize LogStreamBuffer::xsputn(const char *s, std::streamsize n)
+    {
+        if (n <= 0)
+        {
+            return 0;
+        }
+        auto count = static_cast<size_t>(n);
+        if (static_cast<size_t>(epptr() - pptr()) < count)
+        {
+            grow(count);
+        }
+        memcpy(pptr(), s, count);
+        advance(count);
+        return n;
+    }
+
+    LogStream::LogStream() : std::ostream(nullptr), defaultFlags_{flags()}
+    {
+        rdbuf(&buffer_);
+    }
+
+    LogStream::~LogStream() {}
+
+    void LogStream::reset()
+    {
+        buffer_.reset();
+        clear();
+        flags(defaultFlags_);
+        precision(6);
+        width(0);
+        fill(' ');
+    }
+
+    LogStream *LogStream::acquire()
+    {
+        if (auto *stream = LogStreamPool::tryAcquire())
+        {
+            stream->pooled_ = true;
+            return stream;
+        }
+        return new LogStream();
+    }
+
+    void LogStream::release(LogStream *stream) noexcept
+    {
+        if (!stream->pooled_)
+        {
+            delete stream;
+            return;
+        }
+        // The stream was destroyed with the pool if this thread is exiting,
+        // so it is only reset while the pool still owns it.
+        auto reset = [](LogStream &pooled)
+        {
+            pooled.reset();
+        };
+        LogStreamPool::release(stream, reset);
+    }
+
+} // namespace tinylog
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogStreamProcessor.h"
+
+#include <cstdio>
+#include <exception>
+
+#include "LogCategory.h"
+#include "LogMessage.h"
+
+namespace tinylog
+{
+    LogStreamProcessor::~LogStreamProcessor() noexcept
+    {
+        if (stream_)
+        {
+            logNow();
+            LogStream::release(stream_);
+        }
+    }
+
+    void LogStreamProcessor::logNow() noexcept
+    {
+        // The text is copied straight out of the pooled stream buffer into
+        // the LogMessage's own storage.
+        try
+        {
+            auto text = stream_->getText();
+            if (callsite_)
+            {
+                LogMessage message{category_, level_, callsite_, text};
+                category_->admitMessage(message);
+            }
+            else
+            {
+                LogMessage message{
+                    category_, level_, filename_, lineNumber_, functionName_, text};
+                category_->admitMessage(message);
+            }
+        }
+        catch (const std::exception &ex)
+        {
+            // This is called from a destructor, so report the error directly
+            // rather than letting it escape.
+            fprintf(stderr,
+                    "error logging message from %s:%u: %s\n",
+                    callsite_ ? callsite_->getFileName().str().c_str()
+                              : filename_.str().c_str(),
+                    callsite_ ? callsite_->getLineNumber() : lineNumber_,
+                    ex.what());
+        }
+    }
+
+} // namespace tinylog
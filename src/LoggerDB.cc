@@ -1,7 +1,393 @@
 #include "LoggerDB.h"
 
+#include <algorithm>
+#include <array>
 #include <set>
+#include <stdexcept>
 
 #include "LogCategory.h"
 #include "LogHandler.h"
-#include "LogLevel.h"
\ No newline at end of file
+#include "LogHandlerFactory.h"
+#include "LogLevel.h"
+#include "Rcu.h"
+
+namespace tinylog
+{
+    class LoggerDB::ContextCallbackList::CallbacksObj
+    {
+        using StorageBlock = std::array<ContextCallback, 16>;
+
+    public:
+        CallbacksObj() : end_{block_.begin()} {}
+
+        /**
+         * Iterate over all of the callbacks added so far.
+         *
+         * This may be called concurrently with write(): callbacks are never
+         * moved once written, and end_ is only advanced after the new
+         * callback has been stored.
+         */
+        template <typename F>
+        void forEach(F f) const
+        {
+            auto end = end_.load(std::memory_order_acquire);
+            for (auto it = block_.begin(); it != end; ++it)
+            {
+                f(*it);
+            }
+        }
+
+        /**
+         * Append a callback.  Returns false if the block is full.
+         *
+         * Only one thread may call write() at a time.
+         */
+        bool write(ContextCallback &&callback)
+        {
+            auto end = end_.load(std::memory_order_relaxed);
+            if (end == block_.end())
+            {
+                return false;
+            }
+            *end = std::move(callback);
+            end_.store(end + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        StorageBlock block_;
+        std::atomic<StorageBlock::iterator> end_;
+    };
+
+    LoggerDB::ContextCallbackList::~ContextCallbackList()
+    {
+        delete callbacks_.load(std::memory_order_relaxed);
+    }
+
+    void LoggerDB::ContextCallbackList::addCallback(ContextCallback callback)
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        auto *callbacks = callbacks_.load(std::memory_order_relaxed);
+        if (!callbacks)
+        {
+            callbacks = new CallbacksObj();
+            callbacks_.store(callbacks, std::memory_order_release);
+        }
+        if (!callbacks->write(std::move(callback)))
+        {
+            throw std::length_error("too many log context callbacks");
+        }
+    }
+
+    std::string LoggerDB::ContextCallbackList::getContextString() const
+    {
+        auto *callbacks = callbacks_.load(std::memory_order_acquire);
+        if (!callbacks)
+        {
+            return {};
+        }
+
+        std::string output;
+        callbacks->forEach([&](const ContextCallback &callback)
+                           {
+            try
+            {
+                auto str = callback();
+                if (!str.empty())
+                {
+                    output += ' ';
+                    output += str;
+                }
+            }
+            catch (const std::exception &ex)
+            {
+                output += " [error:";
+                output += ex.what();
+                output += ']';
+            } });
+        return output;
+    }
+
+    LoggerDB &LoggerDB::get()
+    {
+        // Intentionally leaked, so that log statements made from static
+        // destructors in other translation units still have a LoggerDB.
+        static LoggerDB *db = new LoggerDB();
+        return *db;
+    }
+
+    LoggerDB::LoggerDB()
+    {
+        // Create the root log category
+        CategoryKey rootKey{""};
+        getShard(rootKey.hash()).loggersByName.wlock()->insertRoot(this);
+    }
+
+    LoggerDB::LoggerDB(TestConstructorArg) : LoggerDB() {}
+
+    LoggerDB::~LoggerDB() {}
+
+    LogCategory *LoggerDB::getCategory(tinylog::StringPiece name)
+    {
+        // Categories are almost always created at startup, so first look for
+        // an existing one without taking the lock.
+        CategoryKey key{name};
+        auto *category = getShard(key.hash()).loggersByName.unsafeGetUnlocked().find(key);
+        if (category)
+        {
+            return category;
+        }
+        std::shared_lock<std::shared_mutex> treeLock(treeMutex_);
+        return getOrCreateCategoryLocked(key);
+    }
+
+    LogCategory *LoggerDB::getCategoryOrNull(tinylog::StringPiece name)
+    {
+        // This is wait-free: it runs concurrently with category creation
+        // rather than waiting for the shard lock.
+        CategoryKey key{name};
+        return getShard(key.hash()).loggersByName.unsafeGetUnlocked().find(key);
+    }
+
+    void LoggerDB::setLevel(tinylog::StringPiece name, LogLevel level, bool inherit)
+    {
+        std::unique_lock<std::shared_mutex> treeLock(treeMutex_);
+        LogCategory *category = getOrCreateCategoryLocked(CategoryKey{name});
+        category->setLevelLocked(level, inherit);
+    }
+
+    void LoggerDB::setLevel(LogCategory *category, LogLevel level, bool inherit)
+    {
+        std::unique_lock<std::shared_mutex> treeLock(treeMutex_);
+        category->setLevelLocked(level, inherit);
+    }
+
+    void LoggerDB::addLevelRule(tinylog::StringPiece pattern, LogLevel level, bool inherit)
+    {
+        std::unique_lock<std::shared_mutex> treeLock(treeMutex_);
+        const auto &rule = levelRules_.add(pattern, level, inherit);
+        for (auto &shard : loggersByName_)
+        {
+            shard.loggersByName.wlock()->forEach([&](LogCategory *category)
+                                                 {
+                // The new rule was added last, so it wins wherever it matches.
+                if (levelRules_.match(category->getName()) == &rule)
+                {
+                    category->setLevelLocked(rule.level, rule.inherit);
+                } });
+        }
+    }
+
+    void LoggerDB::setLevelPropagationThreads(size_t numThreads)
+    {
+        levelPropagationThreads_.store(
+            std::max<size_t>(numThreads, 1), std::memory_order_relaxed);
+    }
+
+    void LoggerDB::updateDispatchLists(LogCategory *category)
+    {
+        {
+            // Hold the tree lock exclusively, so no child is created from a
+            // stale copy of its parent's list while we walk the subtree.
+            std::unique_lock<std::shared_mutex> treeLock(treeMutex_);
+            category->updateDispatchListsLocked();
+        }
+
+        // Free the replaced lists once no thread is logging through them.
+        // This waits for messages being dispatched, without holding the tree
+        // lock, so category creation and logging carry on meanwhile.
+        RcuDomain::getDefault().synchronize();
+    }
+
+    void LoggerDB::cleanupHandlers()
+    {
+        // Get a copy of all categories, so we can call clearHandlers() without
+        // holding any shard locks.  We don't need to worry about LogCategory
+        // lifetime, since LogCategory objects always live for the lifetime of
+        // the LoggerDB.
+        std::vector<LogCategory *> categories;
+        for (auto &shard : loggersByName_)
+        {
+            auto loggersByName = shard.loggersByName.wlock();
+            loggersByName->forEach([&](LogCategory *category)
+                                   { categories.push_back(category); });
+        }
+
+        for (auto *category : categories)
+        {
+            category->clearHandlers();
+        }
+    }
+
+    size_t LoggerDB::flushAllHandlers()
+    {
+        // Build a set of all LogHandlers.  We use a set to avoid calling flush()
+        // more than once on the same handler if it is registered on multiple
+        // different categories.
+        std::set<std::shared_ptr<LogHandler>> handlers;
+        for (auto &shard : loggersByName_)
+        {
+            auto loggersByName = shard.loggersByName.wlock();
+            loggersByName->forEach([&](LogCategory *category)
+                                   {
+                for (const auto &handler : category->getHandlers())
+                {
+                    handlers.emplace(handler);
+                } });
+        }
+
+        // Call flush() on each handler
+        for (const auto &handler : handlers)
+        {
+            handler->flush();
+        }
+        return handlers.size();
+    }
+
+    void LoggerDB::addContextCallback(ContextCallback callback)
+    {
+        contextCallbacks_.addCallback(std::move(callback));
+    }
+
+    std::string LoggerDB::getContextString() const
+    {
+        return contextCallbacks_.getContextString();
+    }
+
+    LoggerDB::NameShard &LoggerDB::getShard(size_t hash)
+    {
+        // LogCategoryMap indexes its table with the low bits of the hash, so
+        // mix them all into the shard index instead of taking those bits.
+        constexpr uint64_t kMultiplier = 0x9e3779b97f4a7c15ULL;
+        return loggersByName_[(hash * kMultiplier) >> 60];
+    }
+
+    LogCategory *LoggerDB::getOrCreateCategoryLocked(const CategoryKey &key)
+    {
+        auto &shard = getShard(key.hash());
+        auto *category = shard.loggersByName.unsafeGetUnlocked().find(key);
+        if (category)
+        {
+            return category;
+        }
+
+        // Create the parent before taking our shard's lock, so that we only
+        // ever hold one shard lock at a time.  The parent chain may well
+        // span several shards.
+        LogCategory *parent = getOrCreateCategoryLocked(key.parent());
+
+        // Another thread may have created the category while we were not
+        // holding the shard lock.
+        auto loggersByName = shard.loggersByName.wlock();
+        category = loggersByName->find(key);
+        if (category)
+        {
+            return category;
+        }
+        return createCategoryLocked(*loggersByName, key, parent);
+    }
+
+    LogCategory *LoggerDB::createCategoryLocked(
+        LoggerNameMap &loggersByName,
+        const CategoryKey &key,
+        LogCategory *parent)
+    {
+        return loggersByName.insert(key, parent, [this](LogCategory *category)
+                                    {
+            // Apply the level rules before anyone else can see the category.
+            // It has no children or XLOG() levels yet, so setting its level
+            // does not need the tree lock held exclusively.
+            if (const auto *rule = levelRules_.match(category->getName()))
+            {
+                category->setLevelLocked(rule->level, rule->inherit);
+            } });
+    }
+
+    LogLevel LoggerDB::xlogInit(
+        tinylog::StringPiece categoryName,
+        std::atomic<LogLevel> *xlogCategoryLevel,
+        LogCategory **xlogCategory)
+    {
+        return xlogInit(
+            categoryName, LogName::hash(categoryName), xlogCategoryLevel, xlogCategory);
+    }
+
+    LogLevel LoggerDB::xlogInit(
+        tinylog::StringPiece categoryName,
+        size_t categoryHash,
+        std::atomic<LogLevel> *xlogCategoryLevel,
+        LogCategory **xlogCategory)
+    {
+        // Hold the tree lock so the category's level cannot change until its
+        // new XLOG() level is registered.
+        std::shared_lock<std::shared_mutex> treeLock(treeMutex_);
+        CategoryKey key{categoryName, categoryHash};
+        auto *category = getOrCreateCategoryLocked(key);
+
+        // xlogInit() may be called from multiple threads simultaneously.
+        // Only one needs to perform the initialization.  Every thread
+        // initializing this callsite finds the same category, so its shard
+        // lock serializes them, and protects the category's xlogLevel_ list.
+        auto loggersByName = getShard(key.hash()).loggersByName.wlock();
+        if (xlogCategory != nullptr && *xlogCategory != nullptr)
+        {
+            return xlogCategoryLevel->load(std::memory_order_acquire);
+        }
+
+        if (xlogCategory)
+        {
+            // Set *xlogCategory before we update xlogCategoryLevel below.
+            // This is important, since the XLOG() macros check
+            // xlogCategoryLevel to tell if *xlogCategory has been
+            // initialized yet.
+            *xlogCategory = category;
+        }
+        auto level = category->getEffectiveLevel();
+        xlogCategoryLevel->store(level, std::memory_order_release);
+        category->registerXlogLevel(xlogCategoryLevel);
+        return level;
+    }
+
+    LogCategory *LoggerDB::xlogInitCategory(
+        tinylog::StringPiece categoryName,
+        LogCategory **xlogCategory,
+        std::atomic<bool> *isInitialized)
+    {
+        if (isInitialized->load(std::memory_order_acquire))
+        {
+            return *xlogCategory;
+        }
+
+        std::shared_lock<std::shared_mutex> treeLock(treeMutex_);
+        CategoryKey key{categoryName};
+        auto *category = getOrCreateCategoryLocked(key);
+
+        // As in xlogInit(), the shard lock serializes initialization.
+        auto loggersByName = getShard(key.hash()).loggersByName.wlock();
+        if (isInitialized->load(std::memory_order_relaxed))
+        {
+            return *xlogCategory;
+        }
+        *xlogCategory = category;
+        isInitialized->store(true, std::memory_order_release);
+        return category;
+    }
+
+    void LoggerDB::setClock(std::shared_ptr<LogClock> clock)
+    {
+        std::lock_guard<std::mutex> lock(clockMutex_);
+        if (!clock)
+        {
+            clock_.store(&SystemLogClock::instance(), std::memory_order_release);
+            return;
+        }
+        clock_.store(clock.get(), std::memory_order_release);
+        clocks_.push_back(std::move(clock));
+    }
+
+    void LoggerDB::setClock(LogClockType type)
+    {
+        setClock(LogClock::create(type));
+    }
+
+} // namespace tinylog
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Rcu.h"
+
+#include <thread>
+
+namespace tinylog
+{
+    constexpr size_t RcuDomain::kNumStripes;
+
+    RcuDomain::~RcuDomain() {}
+
+    RcuDomain &RcuDomain::getDefault()
+    {
+        // Intentionally leaked, like the LoggerDB singleton, since logging
+        // may happen during static destruction.
+        static RcuDomain *domain = new RcuDomain();
+        return *domain;
+    }
+
+    size_t RcuDomain::getStripeIndex()
+    {
+        // Spread threads over the stripes round-robin, in the order they
+        // first read.
+        static std::atomic<size_t> nextIndex{0};
+        static thread_local size_t index =
+            nextIndex.fetch_add(1, std::memory_order_relaxed) % kNumStripes;
+        return index;
+    }
+
+    void RcuDomain::waitForReaders(unsigned int parity)
+    {
+        while (true)
+        {
+            int64_t readers = 0;
+            for (const auto &stripe : stripes_)
+            {
+                readers += stripe.readers[parity].load(std::memory_order_acquire);
+            }
+            if (readers == 0)
+            {
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    void RcuDomain::synchronize()
+    {
+        std::vector<std::shared_ptr<const void>> retired;
+        {
+            std::lock_guard<std::mutex> lock(retiredMutex_);
+            retired.swap(retired_);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(synchronizeMutex_);
+
+            // Order the caller's pointer updates before the counter reads
+            // below: a reader that is not counted yet will see them.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            // A reader may have read the parity just before the previous
+            // synchronize() flipped it, and only then counted itself.  Such a
+            // reader is counted against the parity that is not current, and
+            // may be using an object retired since, so wait for it first.
+            auto current = epoch_.load(std::memory_order_relaxed) & 1;
+            waitForReaders(current ^ 1);
+
+            // Then start a new epoch, and wait for the readers of the old one.
+            epoch_.fetch_add(1, std::memory_order_seq_cst);
+            waitForReaders(current);
+        }
+
+        // retired is destroyed here, once no reader can see its contents.
+    }
+
+} // namespace tinylog
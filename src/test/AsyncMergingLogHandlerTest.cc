@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AsyncMergingLogHandler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "LogCategory.h"
+#include "LogFormatter.h"
+#include "LogWriter.h"
+#include "LoggerDB.h"
+
+using namespace tinylog;
+using std::chrono::system_clock;
+
+namespace
+{
+    class TimestampFormatter : public LogFormatter
+    {
+    public:
+        std::string formatMessage(
+            const LogMessage &message, const LogCategory * /* handlerCategory */) override
+        {
+            return std::to_string(message.getTimestamp().time_since_epoch().count());
+        }
+    };
+
+    class TestLogWriter : public LogWriter
+    {
+    public:
+        void writeMessage(StringPiece buffer, uint32_t /* flags */) override
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            messages_.push_back(buffer.str());
+        }
+
+        void flush() override {}
+
+        std::vector<std::string> getMessages()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return messages_;
+        }
+
+    private:
+        std::mutex mutex_;
+        std::vector<std::string> messages_;
+    };
+
+    /**
+     * A LogWriter that blocks inside its first writeMessage() call until
+     * unblock() is called.
+     */
+    class GatedLogWriter : public TestLogWriter
+    {
+    public:
+        void writeMessage(StringPiece buffer, uint32_t flags) override
+        {
+            {
+                std::unique_lock<std::mutex> lock(gateMutex_);
+                if (!opened_)
+                {
+                    blocked_ = true;
+                    gateCV_.notify_all();
+                    gateCV_.wait(lock, [this] { return opened_; });
+                }
+            }
+            TestLogWriter::writeMessage(buffer, flags);
+        }
+
+        void waitUntilBlocked()
+        {
+            std::unique_lock<std::mutex> lock(gateMutex_);
+            gateCV_.wait(lock, [this] { return blocked_; });
+        }
+
+        void unblock()
+        {
+            std::lock_guard<std::mutex> lock(gateMutex_);
+            opened_ = true;
+            gateCV_.notify_all();
+        }
+
+    private:
+        std::mutex gateMutex_;
+        std::condition_variable gateCV_;
+        bool blocked_{false};
+        bool opened_{false};
+    };
+} // namespace
+
+TEST(AsyncMergingLogHandler, keepsPerThreadOrder)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto writer = std::make_shared<TestLogWriter>();
+    AsyncMergingLogHandler handler{std::make_shared<TimestampFormatter>(), writer};
+
+    // Enqueue interleaved timestamps from several threads concurrently.
+    constexpr int kNumThreads = 4;
+    constexpr int kMessagesPerThread = 100;
+    auto base = system_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; ++t)
+    {
+        threads.emplace_back([&, t]
+                             {
+            for (int n = 0; n < kMessagesPerThread; ++n)
+            {
+                auto ts = base + std::chrono::microseconds(n * kNumThreads + t);
+                LogMessage message{
+                    category, LogLevel::INFO, ts, __FILE__, __LINE__, __func__, std::string{"x"}};
+                handler.handleMessage(message, category);
+            } });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    handler.flush();
+
+    auto messages = writer->getMessages();
+    ASSERT_EQ(kNumThreads * kMessagesPerThread, messages.size());
+    // Messages from one thread always stay in order, however the rounds of
+    // the merge happen to be split.
+    std::vector<int64_t> lastPerThread(kNumThreads, -1);
+    for (const auto &msg : messages)
+    {
+        auto ts = system_clock::time_point{system_clock::duration{std::stoll(msg)}};
+        auto offset =
+            std::chrono::duration_cast<std::chrono::microseconds>(ts - base).count();
+        auto t = offset % kNumThreads;
+        EXPECT_LT(lastPerThread[t], offset);
+        lastPerThread[t] = offset;
+    }
+}
+
+TEST(AsyncMergingLogHandler, drainRoundIsFullySorted)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto writer = std::make_shared<GatedLogWriter>();
+    AsyncMergingLogHandler handler{std::make_shared<TimestampFormatter>(), writer};
+
+    // Park the I/O thread inside the first write, so everything logged below
+    // is picked up by a single drain round.
+    auto base = system_clock::now();
+    LogMessage first{
+        category, LogLevel::INFO, base, __FILE__, __LINE__, __func__, std::string{"x"}};
+    handler.handleMessage(first, category);
+    writer->waitUntilBlocked();
+
+    auto logRange = [&](int offset)
+    {
+        for (int n = 0; n < 50; ++n)
+        {
+            LogMessage message{
+                category, LogLevel::INFO,
+                base + std::chrono::microseconds(2 * n + offset + 1),
+                __FILE__, __LINE__, __func__, std::string{"x"}};
+            handler.handleMessage(message, category);
+        }
+    };
+    std::thread even([&] { logRange(0); });
+    std::thread odd([&] { logRange(1); });
+    even.join();
+    odd.join();
+    writer->unblock();
+    handler.flush();
+
+    auto messages = writer->getMessages();
+    ASSERT_EQ(101, messages.size());
+    EXPECT_TRUE(std::is_sorted(
+        messages.begin(), messages.end(),
+        [](const std::string &a, const std::string &b)
+        { return std::stoll(a) < std::stoll(b); }));
+}
+
+TEST(AsyncMergingLogHandler, reclaimsExitedThreadBuffers)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto writer = std::make_shared<TestLogWriter>();
+    AsyncMergingLogHandler handler{std::make_shared<TimestampFormatter>(), writer, 4};
+
+    for (int t = 0; t < 8; ++t)
+    {
+        std::thread([&]
+                    {
+            for (int n = 0; n < 20; ++n)
+            {
+                LogMessage message{
+                    category, LogLevel::INFO, __FILE__, __LINE__, __func__, std::string{"x"}};
+                handler.handleMessage(message, category);
+            } })
+            .join();
+    }
+    handler.flush();
+    EXPECT_EQ(160, writer->getMessages().size());
+
+    // Each exiting thread wakes the I/O thread, which reclaims the buffer
+    // without any further logging.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (handler.getNumBuffers() != 0 &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(0, handler.getNumBuffers());
+}
+
+TEST(AsyncMergingLogHandler, flushWaitsForWrite)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto writer = std::make_shared<GatedLogWriter>();
+    AsyncMergingLogHandler handler{std::make_shared<TimestampFormatter>(), writer, 4};
+
+    LogMessage message{
+        category, LogLevel::INFO, __FILE__, __LINE__, __func__, std::string{"x"}};
+    handler.handleMessage(message, category);
+    // The message has been popped from its buffer, but not written yet.
+    writer->waitUntilBlocked();
+
+    std::atomic<bool> flushed{false};
+    std::thread flusher([&]
+                        {
+        handler.flush();
+        flushed = true; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(flushed.load());
+
+    writer->unblock();
+    flusher.join();
+    EXPECT_EQ(1, writer->getMessages().size());
+}
@@ -0,0 +1,503 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AsyncRingLogHandler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "LogCategory.h"
+#include "LogFormatter.h"
+#include "LogWriter.h"
+#include "LoggerDB.h"
+
+using namespace tinylog;
+
+namespace
+{
+    class TestLogFormatter : public LogFormatter
+    {
+    public:
+        std::string formatMessage(
+            const LogMessage &message, const LogCategory * /* handlerCategory */) override
+        {
+            return message.getMessage().str();
+        }
+    };
+
+    /**
+     * A LogFormatter that records the address of each message it formats.
+     */
+    class AddressRecordingFormatter : public LogFormatter
+    {
+    public:
+        std::string formatMessage(
+            const LogMessage &message, const LogCategory * /* handlerCategory */) override
+        {
+            addresses.push_back(&message);
+            return message.getMessage().str();
+        }
+
+        std::vector<const LogMessage *> addresses;
+    };
+
+    /**
+     * A LogFormatter that blocks inside its first formatMessage() call until
+     * unblock() is called, while the I/O thread still holds the message's
+     * slot.
+     */
+    class GatedLogFormatter : public TestLogFormatter
+    {
+    public:
+        std::string formatMessage(
+            const LogMessage &message, const LogCategory *handlerCategory) override
+        {
+            {
+                std::unique_lock<std::mutex> lock(gateMutex_);
+                if (!opened_)
+                {
+                    blocked_ = true;
+                    gateCV_.notify_all();
+                    gateCV_.wait(lock, [this] { return opened_; });
+                }
+            }
+            return TestLogFormatter::formatMessage(message, handlerCategory);
+        }
+
+        void waitUntilBlocked()
+        {
+            std::unique_lock<std::mutex> lock(gateMutex_);
+            gateCV_.wait(lock, [this] { return blocked_; });
+        }
+
+        void unblock()
+        {
+            std::lock_guard<std::mutex> lock(gateMutex_);
+            opened_ = true;
+            gateCV_.notify_all();
+        }
+
+    private:
+        std::mutex gateMutex_;
+        std::condition_variable gateCV_;
+        bool blocked_{false};
+        bool opened_{false};
+    };
+
+    class TestLogWriter : public LogWriter
+    {
+    public:
+        explicit TestLogWriter(std::chrono::milliseconds delay = {}) : delay_{delay} {}
+
+        void writeMessage(StringPiece buffer, uint32_t /* flags */) override
+        {
+            if (delay_.count() > 0)
+            {
+                std::this_thread::sleep_for(delay_);
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            messages_.push_back(buffer.str());
+        }
+
+        void flush() override {}
+
+        std::vector<std::string> getMessages()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return messages_;
+        }
+
+    private:
+        std::chrono::milliseconds const delay_;
+        std::mutex mutex_;
+        std::vector<std::string> messages_;
+    };
+
+    /**
+     * A LogWriter that blocks inside its first writeMessage() call until
+     * unblock() is called, so tests can fill up the ring deterministically.
+     */
+    class GatedLogWriter : public TestLogWriter
+    {
+    public:
+        void writeMessage(StringPiece buffer, uint32_t flags) override
+        {
+            {
+                std::unique_lock<std::mutex> lock(gateMutex_);
+                if (!opened_)
+                {
+                    blocked_ = true;
+                    gateCV_.notify_all();
+                    gateCV_.wait(lock, [this] { return opened_; });
+                }
+            }
+            TestLogWriter::writeMessage(buffer, flags);
+        }
+
+        void waitUntilBlocked()
+        {
+            std::unique_lock<std::mutex> lock(gateMutex_);
+            gateCV_.wait(lock, [this] { return blocked_; });
+        }
+
+        void unblock()
+        {
+            std::lock_guard<std::mutex> lock(gateMutex_);
+            opened_ = true;
+            gateCV_.notify_all();
+        }
+
+    private:
+        std::mutex gateMutex_;
+        std::condition_variable gateCV_;
+        bool blocked_{false};
+        bool opened_{false};
+    };
+
+    /**
+     * Log a message whose text is its index, and return the message list
+     * without any drop summary lines.
+     */
+    void logNumber(
+        AsyncRingLogHandler &handler, const LogCategory *category, int n,
+        LogLevel level = LogLevel::INFO)
+    {
+        LogMessage message{
+            category, level, __FILE__, __LINE__, __func__, std::to_string(n)};
+        handler.handleMessage(message, category);
+    }
+
+    std::vector<std::string> withoutSummaries(const std::vector<std::string> &messages)
+    {
+        std::vector<std::string> result;
+        for (const auto &msg : messages)
+        {
+            if (msg.find("log messages dropped") == std::string::npos)
+            {
+                result.push_back(msg);
+            }
+        }
+        return result;
+    }
+} // namespace
+
+TEST(AsyncRingLogHandler, flushProcessesEverything)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto writer = std::make_shared<TestLogWriter>();
+    AsyncRingLogHandler handler{std::make_shared<TestLogFormatter>(), writer, 8};
+    EXPECT_EQ(8, handler.getCapacity());
+
+    for (int n = 0; n < 100; ++n)
+    {
+        LogMessage message{
+            category, LogLevel::INFO, __FILE__, __LINE__, __func__,
+            std::to_string(n)};
+        handler.handleMessage(message, category);
+    }
+    handler.flush();
+
+    auto messages = writer->getMessages();
+    ASSERT_EQ(100, messages.size());
+    for (int n = 0; n < 100; ++n)
+    {
+        EXPECT_EQ(std::to_string(n), messages[n]);
+    }
+}
+
+TEST(AsyncRingLogHandler, sharedMessage)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto formatter = std::make_shared<AddressRecordingFormatter>();
+    auto writer = std::make_shared<TestLogWriter>();
+    AsyncRingLogHandler handler{formatter, writer, 8};
+    EXPECT_TRUE(handler.keepsMessages());
+
+    LogMessage message{
+        category, LogLevel::INFO, __FILE__, __LINE__, __func__, std::string{"hi"}};
+    auto shared = makeSharedLogMessage(message);
+    handler.handleSharedMessage(shared, category);
+    handler.handleMessage(message, category);
+    handler.flush();
+
+    // The shared message is queued as-is, while a plain message is copied.
+    ASSERT_EQ(2, formatter->addresses.size());
+    EXPECT_EQ(shared.get(), formatter->addresses[0]);
+    EXPECT_NE(&message, formatter->addresses[1]);
+    EXPECT_EQ(1, shared.use_count());
+    EXPECT_EQ((std::vector<std::string>{"hi", "hi"}), writer->getMessages());
+}
+
+TEST(AsyncRingLogHandler, multipleProducers)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto writer = std::make_shared<TestLogWriter>();
+    AsyncRingLogHandler handler{std::make_shared<TestLogFormatter>(), writer, 16};
+
+    constexpr int kNumThreads = 8;
+    constexpr int kMessagesPerThread = 1000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; ++t)
+    {
+        threads.emplace_back([&, t]
+                             {
+            for (int n = 0; n < kMessagesPerThread; ++n)
+            {
+                LogMessage message{
+                    category, LogLevel::INFO, __FILE__, __LINE__, __func__,
+                    std::to_string(t) + ":" + std::to_string(n)};
+                handler.handleMessage(message, category);
+            } });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    handler.flush();
+
+    // Every message must arrive, and each thread's messages must stay in order.
+    auto messages = writer->getMessages();
+    ASSERT_EQ(kNumThreads * kMessagesPerThread, messages.size());
+    std::vector<int> next(kNumThreads, 0);
+    for (const auto &msg : messages)
+    {
+        auto sep = msg.find(':');
+        auto t = std::stoi(msg.substr(0, sep));
+        EXPECT_EQ(next[t], std::stoi(msg.substr(sep + 1)));
+        next[t]++;
+    }
+}
+
+TEST(AsyncRingLogHandler, handleMessageDoesNotWaitForWriter)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto writer = std::make_shared<TestLogWriter>(std::chrono::milliseconds(20));
+    AsyncRingLogHandler handler{std::make_shared<TestLogFormatter>(), writer, 64};
+
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < 10; ++n)
+    {
+        LogMessage message{
+            category, LogLevel::INFO, __FILE__, __LINE__, __func__, std::string{"slow"}};
+        handler.handleMessage(message, category);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_LT(elapsed, std::chrono::milliseconds(100));
+
+    handler.flush();
+    EXPECT_EQ(10, writer->getMessages().size());
+}
+
+TEST(AsyncRingLogHandler, levelFilter)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto writer = std::make_shared<TestLogWriter>();
+    AsyncRingLogHandler handler{std::make_shared<TestLogFormatter>(), writer};
+    handler.setLevel(LogLevel::WARN);
+
+    LogMessage info{category, LogLevel::INFO, __FILE__, __LINE__, __func__, std::string{"info"}};
+    LogMessage warn{category, LogLevel::WARN, __FILE__, __LINE__, __func__, std::string{"warn"}};
+    handler.handleMessage(info, category);
+    handler.handleMessage(warn, category);
+    handler.flush();
+
+    EXPECT_EQ(std::vector<std::string>{"warn"}, writer->getMessages());
+}
+
+TEST(AsyncRingLogHandler, dropNewest)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto writer = std::make_shared<GatedLogWriter>();
+    AsyncRingLogHandler handler{std::make_shared<TestLogFormatter>(), writer, 4};
+    handler.setOverflowPolicy(LogOverflowPolicy::DROP_NEWEST);
+
+    // Message 0 has left the ring by the time the I/O thread blocks writing
+    // it, so 1-4 fill up the ring.
+    logNumber(handler, category, 0);
+    writer->waitUntilBlocked();
+    for (int n = 1; n <= 4; ++n)
+    {
+        logNumber(handler, category, n);
+    }
+    logNumber(handler, category, 5, LogLevel::DBG);
+    logNumber(handler, category, 6, LogLevel::INFO);
+    writer->unblock();
+    handler.flush();
+
+    auto messages = writer->getMessages();
+    EXPECT_EQ(
+        (std::vector<std::string>{"0", "1", "2", "3", "4"}),
+        withoutSummaries(messages));
+    EXPECT_NE(
+        messages.end(),
+        std::find(
+            messages.begin(), messages.end(),
+            "tinylog: 2 log messages dropped (DEBUG: 1, INFO: 1)\n"));
+    EXPECT_EQ(2, handler.getDropCounters().getNumDropped());
+    EXPECT_EQ(1, handler.getDropCounters().getNumDropped(LogLevel::DBG));
+    EXPECT_EQ(1, handler.getDropCounters().getNumDropped(LogLevel::INFO));
+}
+
+TEST(AsyncRingLogHandler, dropOldest)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto writer = std::make_shared<GatedLogWriter>();
+    AsyncRingLogHandler handler{std::make_shared<TestLogFormatter>(), writer, 4};
+    handler.setOverflowPolicy(LogOverflowPolicy::DROP_OLDEST);
+
+    logNumber(handler, category, 0);
+    writer->waitUntilBlocked();
+    for (int n = 1; n <= 6; ++n)
+    {
+        logNumber(handler, category, n);
+    }
+    writer->unblock();
+    handler.flush();
+
+    // 1-4 filled up the ring, then 5 and 6 evicted 1 and 2.
+    EXPECT_EQ(
+        (std::vector<std::string>{"0", "3", "4", "5", "6"}),
+        withoutSummaries(writer->getMessages()));
+    EXPECT_EQ(2, handler.getDropCounters().getNumDropped(LogLevel::INFO));
+}
+
+TEST(AsyncRingLogHandler, dropOldestWhileFormatting)
+{
+    // While the I/O thread formats 0 it still holds that slot, so 4 has to
+    // wait for it.  Evicting 1-3 would not free the slot.
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto formatter = std::make_shared<GatedLogFormatter>();
+    auto writer = std::make_shared<GatedLogWriter>();
+    AsyncRingLogHandler handler{formatter, writer, 4};
+    handler.setOverflowPolicy(LogOverflowPolicy::DROP_OLDEST);
+
+    logNumber(handler, category, 0);
+    formatter->waitUntilBlocked();
+    for (int n = 1; n <= 3; ++n)
+    {
+        logNumber(handler, category, n);
+    }
+    std::thread overflowThread([&] { logNumber(handler, category, 4); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(0, handler.getDropCounters().getNumDropped());
+
+    // Once 0 is being written its slot is free, so each further message
+    // that overflows the ring evicts exactly one.
+    formatter->unblock();
+    overflowThread.join();
+    writer->waitUntilBlocked();
+    logNumber(handler, category, 5);
+    EXPECT_EQ(1, handler.getDropCounters().getNumDropped());
+    logNumber(handler, category, 6);
+    EXPECT_EQ(2, handler.getDropCounters().getNumDropped());
+    writer->unblock();
+    handler.flush();
+
+    EXPECT_EQ(
+        (std::vector<std::string>{"0", "3", "4", "5", "6"}),
+        withoutSummaries(writer->getMessages()));
+}
+
+TEST(AsyncRingLogHandler, dropBelowLevel)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto writer = std::make_shared<GatedLogWriter>();
+    AsyncRingLogHandler handler{std::make_shared<TestLogFormatter>(), writer, 4};
+    handler.setOverflowPolicy(LogOverflowPolicy::DROP_BELOW_LEVEL);
+    EXPECT_EQ(LogLevel::ERROR, handler.getDropThreshold());
+
+    logNumber(handler, category, 0);
+    writer->waitUntilBlocked();
+    for (int n = 1; n <= 4; ++n)
+    {
+        logNumber(handler, category, n);
+    }
+    logNumber(handler, category, 5, LogLevel::WARN);
+
+    // ERROR messages wait for space rather than being dropped.
+    std::thread errorThread(
+        [&] { logNumber(handler, category, 6, LogLevel::ERROR); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    writer->unblock();
+    errorThread.join();
+    handler.flush();
+
+    EXPECT_EQ(
+        (std::vector<std::string>{"0", "1", "2", "3", "4", "6"}),
+        withoutSummaries(writer->getMessages()));
+    EXPECT_EQ(1, handler.getDropCounters().getNumDropped(LogLevel::WARN));
+    EXPECT_EQ(0, handler.getDropCounters().getNumDropped(LogLevel::ERROR));
+}
+
+TEST(AsyncRingLogHandler, flushDuringEvictions)
+{
+    // Logging threads evicting messages race with the I/O thread to claim
+    // them.  flush() must keep returning while that happens, and once logging
+    // stops, every message must have been either written or counted as
+    // dropped.
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto writer = std::make_shared<TestLogWriter>();
+    AsyncRingLogHandler handler{std::make_shared<TestLogFormatter>(), writer, 4};
+    handler.setOverflowPolicy(LogOverflowPolicy::DROP_OLDEST);
+
+    constexpr int kNumThreads = 4;
+    constexpr int kMessagesPerThread = 5000;
+    std::atomic<bool> done{false};
+    std::thread flusher([&]
+                        {
+        while (!done.load())
+        {
+            handler.flush();
+        } });
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; ++t)
+    {
+        threads.emplace_back([&]
+                             {
+            for (int n = 0; n < kMessagesPerThread; ++n)
+            {
+                logNumber(handler, category, n);
+            } });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    done = true;
+    flusher.join();
+    handler.flush();
+
+    auto written = withoutSummaries(writer->getMessages()).size();
+    EXPECT_EQ(
+        kNumThreads * kMessagesPerThread,
+        written + handler.getDropCounters().getNumDropped());
+}
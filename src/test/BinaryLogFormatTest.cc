@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BinaryLogFormat.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "LogCategory.h"
+#include "LogMessage.h"
+#include "LoggerDB.h"
+
+using namespace tinylog;
+using std::chrono::system_clock;
+
+namespace
+{
+    std::vector<DecodedLogRecord> decodeAll(tinylog::StringPiece data, size_t chunkSize)
+    {
+        std::vector<DecodedLogRecord> records;
+        BinaryLogDecoder decoder{
+            [&records](const DecodedLogRecord &record)
+            { records.push_back(record); }};
+        for (size_t offset = 0; offset < static_cast<size_t>(data.size());
+             offset += chunkSize)
+        {
+            decoder.feed(data.subpiece(offset, chunkSize));
+        }
+        decoder.finish();
+        return records;
+    }
+} // namespace
+
+TEST(BinaryLogFormat, roundTrip)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("foo.bar");
+    BinaryLogFormatter formatter;
+
+    auto timestamp = system_clock::now();
+    std::string stream;
+    for (int n = 0; n < 3; ++n)
+    {
+        LogMessage message{
+            category, LogLevel::WARN, timestamp, "src/foo/bar.cc", 42, "doStuff",
+            "message " + std::to_string(n) + std::string("\0\x01", 2)};
+        stream += formatter.formatMessage(message, category);
+    }
+
+    // The same callsite must only be described once.
+    auto single = stream.size();
+    LogMessage other{
+        category, LogLevel::ERROR, timestamp, "src/foo/bar.cc", 43, "doStuff",
+        std::string{"other"}};
+    stream += formatter.formatMessage(other, category);
+
+    // Decoding must not depend on how the input is split up.
+    for (size_t chunkSize : {size_t(1), size_t(7), stream.size()})
+    {
+        auto records = decodeAll(stream, chunkSize);
+        ASSERT_EQ(4, records.size());
+        for (int n = 0; n < 3; ++n)
+        {
+            EXPECT_EQ("foo.bar", records[n].categoryName);
+            EXPECT_EQ(LogLevel::WARN, records[n].level);
+            EXPECT_EQ("src/foo/bar.cc", records[n].filename);
+            EXPECT_EQ(42, records[n].lineNumber);
+            EXPECT_EQ("doStuff", records[n].functionName);
+            EXPECT_EQ(timestamp, records[n].timestamp);
+            EXPECT_EQ(
+                "message " + std::to_string(n) + std::string("\0\x01", 2),
+                records[n].message);
+        }
+        EXPECT_EQ(LogLevel::ERROR, records[3].level);
+        EXPECT_EQ(43, records[3].lineNumber);
+        EXPECT_EQ("other", records[3].message);
+    }
+    EXPECT_LT(stream.size() - single, single / 2);
+}
+
+TEST(BinaryLogFormat, forwardReference)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    BinaryLogFormatter formatter;
+
+    LogMessage first{
+        category, LogLevel::INFO, system_clock::now(), "a.cc", 1, "f",
+        std::string{"first"}};
+    LogMessage second{
+        category, LogLevel::INFO, system_clock::now(), "a.cc", 1, "f",
+        std::string{"second"}};
+    auto firstData = formatter.formatMessage(first, category);
+    auto secondData = formatter.formatMessage(second, category);
+
+    // Simulate a LogWriter that reordered writes: the stream header and the
+    // callsite definition arrive after a message that refers to them.
+    auto headerSize = kBinaryLogMagic.size();
+    auto records = decodeAll(
+        firstData.substr(0, headerSize) + secondData + firstData.substr(headerSize),
+        1024);
+    ASSERT_EQ(2, records.size());
+    EXPECT_EQ("second", records[0].message);
+    EXPECT_EQ("a.cc", records[0].filename);
+    EXPECT_EQ("first", records[1].message);
+}
+
+TEST(BinaryLogFormat, multipleThreads)
+{
+    // Threads share a formatter and a stream, but format and write as two
+    // separate steps, as a synchronous LogHandler does.  Every message must
+    // be decodable as soon as it is read, without waiting for a callsite
+    // that another thread has yet to write.
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    BinaryLogFormatter formatter;
+
+    constexpr int kNumThreads = 8;
+    constexpr int kMessagesPerThread = 200;
+    constexpr int kNumCallsites = 10;
+    std::mutex writesMutex;
+    std::vector<std::string> writes;
+    auto format = [&](int t, int n)
+    {
+        LogMessage message{
+            category, LogLevel::INFO, system_clock::now(), "mt.cc",
+            static_cast<unsigned int>(n % kNumCallsites), "f",
+            std::to_string(t) + ":" + std::to_string(n)};
+        return formatter.formatMessage(message, category);
+    };
+    auto write = [&](std::string data)
+    {
+        std::lock_guard<std::mutex> lock(writesMutex);
+        writes.push_back(std::move(data));
+    };
+
+    // Thread 0 formats a message from every callsite first, but only writes
+    // them once all other threads have written theirs.
+    std::atomic<bool> primed{false};
+    std::atomic<int> numFinished{0};
+    std::vector<std::thread> threads;
+    threads.emplace_back([&]
+                         {
+        std::vector<std::string> held;
+        for (int n = 0; n < kNumCallsites; ++n)
+        {
+            held.push_back(format(0, n));
+        }
+        primed = true;
+        while (numFinished.load() < kNumThreads - 1)
+        {
+            std::this_thread::yield();
+        }
+        for (auto &data : held)
+        {
+            write(std::move(data));
+        }
+        for (int n = kNumCallsites; n < kMessagesPerThread; ++n)
+        {
+            write(format(0, n));
+        } });
+    for (int t = 1; t < kNumThreads; ++t)
+    {
+        threads.emplace_back([&, t]
+                             {
+            while (!primed.load())
+            {
+                std::this_thread::yield();
+            }
+            for (int n = 0; n < kMessagesPerThread; ++n)
+            {
+                write(format(t, n));
+            }
+            ++numFinished; });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    size_t numDecoded = 0;
+    std::vector<int> next(kNumThreads, 0);
+    BinaryLogDecoder decoder{[&](const DecodedLogRecord &record)
+                             {
+        ++numDecoded;
+        auto sep = record.message.find(':');
+        auto t = std::stoi(record.message.substr(0, sep));
+        auto n = std::stoi(record.message.substr(sep + 1));
+        EXPECT_EQ(next[t]++, n);
+        EXPECT_EQ("test", record.categoryName);
+        EXPECT_EQ(static_cast<unsigned int>(n % kNumCallsites), record.lineNumber); }};
+    for (size_t idx = 0; idx < writes.size(); ++idx)
+    {
+        // Each write holds exactly one MESSAGE record.
+        decoder.feed(writes[idx]);
+        ASSERT_EQ(idx + 1, numDecoded);
+    }
+    decoder.finish();
+}
+
+TEST(BinaryLogFormat, reset)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    BinaryLogFormatter formatter;
+    LogMessage message{
+        category, LogLevel::INFO, system_clock::now(), "a.cc", 1, "f",
+        std::string{"msg"}};
+
+    // After a reset, the next message starts a self-contained stream.
+    formatter.formatMessage(message, category);
+    formatter.reset();
+    auto records = decodeAll(formatter.formatMessage(message, category), 1024);
+    ASSERT_EQ(1, records.size());
+    EXPECT_EQ("a.cc", records[0].filename);
+}
+
+TEST(BinaryLogFormat, formatRecord)
+{
+    DecodedLogRecord record;
+    record.categoryName = "foo.bar";
+    record.level = LogLevel::ERROR;
+    record.filename = "src/foo/bar.cc";
+    record.lineNumber = 42;
+    record.functionName = "doStuff";
+    record.threadID = 1234;
+    record.message = std::string("bad\x01");
+
+    auto line = BinaryLogDecoder::formatRecord(record);
+    EXPECT_EQ('E', line[0]);
+    EXPECT_NE(
+        std::string::npos,
+        line.find(" 1234 bar.cc:42 doStuff] [foo.bar] bad\\x01\n"))
+        << line;
+}
+
+TEST(BinaryLogFormat, rejectsTextInput)
+{
+    BinaryLogDecoder decoder{[](const DecodedLogRecord &) {}};
+    EXPECT_THROW(decoder.feed("I1017 12:34:56.789012 not binary"), std::runtime_error);
+}
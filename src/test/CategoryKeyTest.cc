@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CategoryKey.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "LogName.h"
+
+using namespace tinylog;
+
+TEST(CategoryKey, canonicalName)
+{
+    std::string name = "foo.bar.test";
+    CategoryKey key{name};
+    EXPECT_EQ(StringPiece("foo.bar.test"), key.name());
+    EXPECT_EQ(LogName::hash(name), key.hash());
+
+    // Canonical names are referenced rather than copied.
+    EXPECT_EQ(name.data(), key.name().data());
+}
+
+TEST(CategoryKey, nonCanonicalName)
+{
+    std::string name = "/foo//bar/test.";
+    CategoryKey key{name};
+    EXPECT_EQ(StringPiece("foo.bar.test"), key.name());
+    EXPECT_EQ(LogName::hash(name), key.hash());
+    EXPECT_TRUE(key.matches("foo.bar.test"));
+    EXPECT_FALSE(key.matches("foo.bar.tes"));
+    EXPECT_FALSE(key.matches("foo.bar.tesT"));
+}
+
+TEST(CategoryKey, precomputedHash)
+{
+    CategoryKey key{"foo/bar", LogName::hash("foo.bar")};
+    EXPECT_EQ(StringPiece("foo.bar"), key.name());
+    EXPECT_EQ(LogName::hash("foo.bar"), key.hash());
+}
+
+TEST(CategoryKey, parent)
+{
+    CategoryKey key{"..foo..bar..test.."};
+    auto parent = key.parent();
+    EXPECT_EQ(StringPiece("foo.bar"), parent.name());
+    EXPECT_EQ(LogName::hash("foo.bar"), parent.hash());
+
+    auto root = parent.parent().parent();
+    EXPECT_EQ(StringPiece(""), root.name());
+    EXPECT_EQ(LogName::hash(""), root.hash());
+}
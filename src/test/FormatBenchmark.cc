@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Format.h"
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+using namespace tinylog;
+
+namespace
+{
+    const std::string kName = "request_handler";
+
+    void BM_Snprintf(benchmark::State &state)
+    {
+        int n = 0;
+        for (auto _ : state)
+        {
+            char buf[256];
+            snprintf(
+                buf,
+                sizeof(buf),
+                "%s handled %d requests in %.3fs, %zu bytes",
+                kName.c_str(),
+                n,
+                n * 0.001,
+                static_cast<size_t>(n) * 1024);
+            benchmark::DoNotOptimize(buf);
+            ++n;
+        }
+    }
+
+    void BM_Ostringstream(benchmark::State &state)
+    {
+        int n = 0;
+        for (auto _ : state)
+        {
+            std::ostringstream os;
+            os.precision(3);
+            os << kName << " handled " << n << " requests in " << std::fixed
+               << n * 0.001 << "s, " << static_cast<size_t>(n) * 1024 << " bytes";
+            benchmark::DoNotOptimize(os.str());
+            ++n;
+        }
+    }
+
+    void BM_Format(benchmark::State &state)
+    {
+        int n = 0;
+        for (auto _ : state)
+        {
+            auto result = format(
+                TINYLOG_FMT("{} handled {} requests in {:.3f}s, {} bytes"),
+                kName,
+                n,
+                n * 0.001,
+                static_cast<size_t>(n) * 1024);
+            benchmark::DoNotOptimize(result.data());
+            ++n;
+        }
+    }
+
+} // namespace
+
+BENCHMARK(BM_Snprintf);
+BENCHMARK(BM_Ostringstream);
+BENCHMARK(BM_Format);
+
+BENCHMARK_MAIN();
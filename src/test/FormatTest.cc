@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Format.h"
+
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "LogCategory.h"
+#include "LogMessage.h"
+#include "LoggerDB.h"
+
+using namespace tinylog;
+using detail::FormatArgKind;
+using detail::FormatError;
+
+namespace
+{
+    template <typename... Args>
+    constexpr FormatError check(StringPiece fmt)
+    {
+        return detail::checkFormat(
+            fmt, detail::kFormatArgKinds<Args...>, sizeof...(Args));
+    }
+
+    // The checks TINYLOG_FMT() strings go through at compile time.
+    static_assert(check<>("hello") == FormatError::NONE, "");
+    static_assert(check<int, const char *>("{} {}") == FormatError::NONE, "");
+    static_assert(check<>("{{}}") == FormatError::NONE, "");
+    static_assert(check<int>("{") == FormatError::UNMATCHED_BRACE, "");
+    static_assert(check<int>("{}}") == FormatError::UNMATCHED_BRACE, "");
+    static_assert(check<int>("{:q}") == FormatError::BAD_SPEC, "");
+    static_assert(check<double>("{:.}") == FormatError::BAD_SPEC, "");
+    static_assert(check<int>("{} {}") == FormatError::TOO_FEW_ARGS, "");
+    static_assert(check<int, int>("{}") == FormatError::TOO_MANY_ARGS, "");
+    static_assert(check<std::string>("{:d}") == FormatError::TYPE_MISMATCH, "");
+    static_assert(check<int>("{:.2f}") == FormatError::TYPE_MISMATCH, "");
+    static_assert(check<double>("{:x}") == FormatError::TYPE_MISMATCH, "");
+    static_assert(check<int *>("{:x}") == FormatError::NONE, "");
+
+    static_assert(detail::getFormatArgKind<char[4]>() == FormatArgKind::STRING, "");
+    static_assert(detail::getFormatArgKind<StringPiece>() == FormatArgKind::STRING, "");
+    static_assert(detail::getFormatArgKind<unsigned char>() == FormatArgKind::UINT, "");
+    static_assert(detail::getFormatArgKind<float>() == FormatArgKind::DOUBLE, "");
+    static_assert(detail::getFormatArgKind<void *>() == FormatArgKind::POINTER, "");
+    static_assert(detail::getFormatArgKind<LogLevel>() == FormatArgKind::UNSUPPORTED, "");
+
+} // namespace
+
+TEST(Format, basic)
+{
+    EXPECT_EQ("hello", format(TINYLOG_FMT("hello")).str());
+    EXPECT_EQ(
+        "x=5 y=-3 name=foo",
+        format(TINYLOG_FMT("x={} y={} name={}"), 5, -3, std::string{"foo"}).str());
+    EXPECT_EQ("{5}", format(TINYLOG_FMT("{{{}}}"), 5).str());
+    EXPECT_EQ("true false", format(TINYLOG_FMT("{} {}"), true, false).str());
+    EXPECT_EQ("c 99", format(TINYLOG_FMT("{} {:d}"), 'c', 'c').str());
+    EXPECT_EQ("(null)", format(TINYLOG_FMT("{}"), static_cast<const char *>(nullptr)).str());
+    EXPECT_EQ("abc", format(TINYLOG_FMT("{}"), StringPiece{"abc"}).str());
+}
+
+TEST(Format, integers)
+{
+    EXPECT_EQ(
+        "-9223372036854775808",
+        format(TINYLOG_FMT("{}"), std::numeric_limits<int64_t>::min()).str());
+    EXPECT_EQ("18446744073709551615", format(TINYLOG_FMT("{}"), UINT64_MAX).str());
+    EXPECT_EQ("ff FF", format(TINYLOG_FMT("{:x} {:X}"), 255, 255u).str());
+    EXPECT_EQ("-ff", format(TINYLOG_FMT("{:x}"), -255).str());
+    EXPECT_EQ("00042", format(TINYLOG_FMT("{:05}"), 42).str());
+    EXPECT_EQ("-0042", format(TINYLOG_FMT("{:05d}"), -42).str());
+    EXPECT_EQ("   42", format(TINYLOG_FMT("{:5}"), 42).str());
+    EXPECT_EQ("0x10", format(TINYLOG_FMT("{}"), reinterpret_cast<void *>(16)).str());
+    EXPECT_EQ(
+        "0x00001f",
+        format(TINYLOG_FMT("{:08}"), reinterpret_cast<void *>(31)).str());
+    EXPECT_EQ(
+        "0x001F", format(TINYLOG_FMT("{:06X}"), reinterpret_cast<void *>(31)).str());
+    EXPECT_EQ("  0x1f", format(TINYLOG_FMT("{:6}"), reinterpret_cast<void *>(31)).str());
+}
+
+TEST(Format, floatingPoint)
+{
+    EXPECT_EQ("1.5", format(TINYLOG_FMT("{}"), 1.5).str());
+    EXPECT_EQ("3.142", format(TINYLOG_FMT("{:.3f}"), 3.14159).str());
+    EXPECT_EQ("3.141590", format(TINYLOG_FMT("{:f}"), 3.14159).str());
+    EXPECT_EQ("1.50e+03", format(TINYLOG_FMT("{:.2e}"), 1500.0).str());
+    EXPECT_EQ("-0001.50", format(TINYLOG_FMT("{:08.2f}"), -1.5).str());
+    EXPECT_EQ("0001.50", format(TINYLOG_FMT("{:07.2f}"), 1.5).str());
+    EXPECT_EQ("0.25", format(TINYLOG_FMT("{}"), 0.25f).str());
+    EXPECT_EQ(309u, format(TINYLOG_FMT("{:.0f}"), 1e308).size());
+}
+
+TEST(Format, strings)
+{
+    EXPECT_EQ("ab   |", format(TINYLOG_FMT("{:5}|"), "ab").str());
+    EXPECT_EQ("true |", format(TINYLOG_FMT("{:5s}|"), true).str());
+    std::string big(100000, 'x');
+    EXPECT_EQ(big + "!", format(TINYLOG_FMT("{}!"), big).str());
+}
+
+TEST(Format, runtimeChecked)
+{
+    EXPECT_EQ("1 2", format("{} {}", 1, 2).str());
+    std::string fmt = "{:.1f}";
+    EXPECT_EQ("0.5", format(fmt, 0.5).str());
+    EXPECT_THROW(format("{} {}", 1), std::invalid_argument);
+    EXPECT_THROW(format("{}", 1, 2), std::invalid_argument);
+    EXPECT_THROW(format("{:d}", "str"), std::invalid_argument);
+    EXPECT_THROW(format("{", 1), std::invalid_argument);
+}
+
+TEST(Format, bufferReuse)
+{
+    const char *data;
+    {
+        auto first = format(TINYLOG_FMT("{}"), 1);
+        data = first.data();
+    }
+    auto second = format(TINYLOG_FMT("{}"), 2);
+    EXPECT_EQ(data, second.data());
+    EXPECT_EQ("2", second.str());
+}
+
+TEST(Format, nested)
+{
+    // Results that are alive at the same time each get their own buffer,
+    // including beyond the number of pooled buffers.
+    std::vector<FormattedString> results;
+    for (int n = 0; n < 20; ++n)
+    {
+        results.push_back(format(TINYLOG_FMT("value {}"), n));
+    }
+    for (int n = 0; n < 20; ++n)
+    {
+        EXPECT_EQ("value " + std::to_string(n), results[n].str());
+    }
+
+    EXPECT_EQ(
+        "outer [inner 7]",
+        format(TINYLOG_FMT("outer [{}]"), format(TINYLOG_FMT("inner {}"), 7).piece())
+            .str());
+}
+
+TEST(Format, threads)
+{
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([t]
+                             {
+            for (int n = 0; n < 10000; ++n)
+            {
+                auto result = format(TINYLOG_FMT("{}:{}"), t, n);
+                EXPECT_EQ(std::to_string(t) + ":" + std::to_string(n), result.str());
+            } });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+TEST(Format, logMessage)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    LogMessage message{
+        category,
+        LogLevel::INFO,
+        "foo.cc",
+        1,
+        "func",
+        format(TINYLOG_FMT("{} + {} = {}"), 1, 2, 3)};
+    EXPECT_EQ(StringPiece{"1 + 2 = 3"}, message.getRawMessage());
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GlogStyleFormatter.h"
+
+#include <time.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "LogCategory.h"
+#include "LogMessage.h"
+#include "LoggerDB.h"
+
+using namespace tinylog;
+using std::chrono::system_clock;
+
+namespace
+{
+    /**
+     * The straightforward implementation: localtime_r() and snprintf() for
+     * every message.
+     */
+    std::string formatWithLocaltime(const LogMessage &message)
+    {
+        auto usecsSinceEpoch = std::chrono::duration_cast<std::chrono::microseconds>(
+                                   message.getTimestamp().time_since_epoch())
+                                   .count();
+        time_t seconds = static_cast<time_t>(usecsSinceEpoch / 1000000);
+        struct tm ltime;
+        localtime_r(&seconds, &ltime);
+        char header[256];
+        int length = snprintf(
+            header,
+            sizeof(header),
+            "I%02d%02d %02d:%02d:%02d.%06lld %5llu %s:%u] ",
+            ltime.tm_mon + 1,
+            ltime.tm_mday,
+            ltime.tm_hour,
+            ltime.tm_min,
+            ltime.tm_sec,
+            static_cast<long long>(usecsSinceEpoch % 1000000),
+            static_cast<unsigned long long>(message.getThreadID()),
+            message.getFileBaseName().str().c_str(),
+            message.getLineNumber());
+        auto msgData = message.getMessage();
+        std::string buffer;
+        buffer.reserve(length + msgData.size() + 1);
+        buffer.append(header, length);
+        buffer.append(msgData.data(), msgData.size());
+        buffer.push_back('\n');
+        return buffer;
+    }
+
+    /**
+     * Format messages whose timestamps advance by 1us, as they would when
+     * logging at a high rate.
+     */
+    template <typename Format>
+    void runBenchmark(benchmark::State &state, Format &&format)
+    {
+        LoggerDB db{LoggerDB::TESTING};
+        auto *category = db.getCategory("test");
+        auto timestamp = system_clock::now();
+        std::string text(64, 'a');
+        for (auto _ : state)
+        {
+            timestamp += std::chrono::microseconds{1};
+            LogMessage message{
+                category,
+                LogLevel::INFO,
+                timestamp,
+                "src/test/GlogStyleFormatterBenchmark.cc",
+                123,
+                "runBenchmark",
+                StringPiece{text}};
+            benchmark::DoNotOptimize(format(message, category));
+        }
+    }
+
+    void BM_Localtime(benchmark::State &state)
+    {
+        runBenchmark(state, [](const LogMessage &message, const LogCategory *)
+                     { return formatWithLocaltime(message); });
+    }
+
+    void BM_GlogStyleFormatter(benchmark::State &state)
+    {
+        GlogStyleFormatter formatter;
+        runBenchmark(state, [&](const LogMessage &message, const LogCategory *category)
+                     { return formatter.formatMessage(message, category); });
+    }
+
+} // namespace
+
+BENCHMARK(BM_Localtime)->Threads(1)->Threads(4);
+BENCHMARK(BM_GlogStyleFormatter)->Threads(1)->Threads(4);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GlogStyleFormatter.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Conv.h"
+#include "LogCategory.h"
+#include "LogMessage.h"
+#include "LoggerDB.h"
+
+using namespace tinylog;
+using namespace std::chrono_literals;
+using std::chrono::system_clock;
+
+namespace
+{
+    /**
+     * Format the header with localtime_r() and snprintf(), the way the
+     * formatter used to do it.
+     */
+    std::string expectedHeader(const LogMessage &message, char levelChar)
+    {
+        auto usecsSinceEpoch = std::chrono::duration_cast<std::chrono::microseconds>(
+                                   message.getTimestamp().time_since_epoch())
+                                   .count();
+        time_t seconds = static_cast<time_t>(usecsSinceEpoch / 1000000);
+        struct tm ltime;
+        localtime_r(&seconds, &ltime);
+        char buf[256];
+        snprintf(
+            buf,
+            sizeof(buf),
+            "%c%02d%02d %02d:%02d:%02d.%06lld %5llu %s:%u] ",
+            levelChar,
+            ltime.tm_mon + 1,
+            ltime.tm_mday,
+            ltime.tm_hour,
+            ltime.tm_min,
+            ltime.tm_sec,
+            static_cast<long long>(usecsSinceEpoch % 1000000),
+            static_cast<unsigned long long>(message.getThreadID()),
+            message.getFileBaseName().str().c_str(),
+            message.getLineNumber());
+        return buf;
+    }
+
+    /**
+     * Set the TZ environment variable for the duration of a test.
+     */
+    class ScopedTimeZone
+    {
+    public:
+        explicit ScopedTimeZone(const char *tz)
+        {
+            if (const char *old = getenv("TZ"))
+            {
+                old_ = old;
+                hadOld_ = true;
+            }
+            setenv("TZ", tz, 1);
+            tzset();
+        }
+
+        ~ScopedTimeZone()
+        {
+            if (hadOld_)
+            {
+                setenv("TZ", old_.c_str(), 1);
+            }
+            else
+            {
+                unsetenv("TZ");
+            }
+            tzset();
+        }
+
+    private:
+        std::string old_;
+        bool hadOld_{false};
+    };
+
+} // namespace
+
+TEST(Conv, uint64ToBuffer)
+{
+    char buf[32];
+    for (uint64_t v : {uint64_t{0}, uint64_t{7}, uint64_t{10}, uint64_t{99},
+                       uint64_t{100}, uint64_t{12345}, uint64_t{1000000},
+                       UINT64_MAX})
+    {
+        auto length = uint64ToBufferUnsafe(v, buf);
+        EXPECT_EQ(std::to_string(v), std::string(buf, length));
+        EXPECT_EQ(std::to_string(v).size(), digits10(v));
+    }
+
+    uint64ToBufferFixed(42, buf, 6);
+    EXPECT_EQ("000042", std::string(buf, 6));
+    uint64ToBufferFixed(7, buf, 1);
+    EXPECT_EQ("7", std::string(buf, 1));
+}
+
+TEST(GlogStyleFormatter, log)
+{
+    ScopedTimeZone tz{"America/Los_Angeles"};
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    GlogStyleFormatter formatter;
+
+    // 2017-04-17 13:45:56.123456 PDT
+    auto timestamp = system_clock::time_point{1492461956123456us};
+    LogMessage message{
+        category,
+        LogLevel::WARN,
+        timestamp,
+        "src/foo/bar.cc",
+        1234,
+        "testFunction",
+        StringPiece{"hello world"}};
+    auto header = expectedHeader(message, 'W');
+    EXPECT_EQ("W0417 13:45:56.123456", header.substr(0, 21));
+    EXPECT_EQ(header + "hello world\n", formatter.formatMessage(message, category));
+
+    LogMessage fatal{
+        category, LogLevel::FATAL, timestamp, "bar.cc", 1, "f", StringPiece{"x"}};
+    EXPECT_EQ('F', formatter.formatMessage(fatal, category)[0]);
+    LogMessage debug{
+        category, LogLevel::DBG, timestamp, "bar.cc", 1, "f", StringPiece{"x"}};
+    EXPECT_EQ('V', formatter.formatMessage(debug, category)[0]);
+}
+
+TEST(GlogStyleFormatter, multiline)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    GlogStyleFormatter formatter;
+
+    LogMessage message{
+        category,
+        LogLevel::INFO,
+        "bar.cc",
+        42,
+        "testFunction",
+        StringPiece{"line one\nline two\n\nline four\x01\n"}};
+    auto header = expectedHeader(message, 'I');
+    EXPECT_EQ(
+        header + "line one\n" + header + "line two\n" + header + "\n" + header +
+            "line four\\x01\n" + header + "\n",
+        formatter.formatMessage(message, category));
+}
+
+TEST(GlogStyleFormatter, localTime)
+{
+    // Check the cached local time against localtime_r() across a DST
+    // transition, year and leap day boundaries, and times that fall in the
+    // same second.
+    ScopedTimeZone tz{"America/Los_Angeles"};
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    GlogStyleFormatter formatter;
+
+    std::vector<system_clock::time_point> times;
+    // 2021-03-14 01:59:00 PST, one minute before the DST transition.
+    auto start = system_clock::time_point{1615715940s};
+    for (int n = 0; n < 200; ++n)
+    {
+        times.push_back(start + n * 1s + n * 1ms);
+        times.push_back(start + n * 1s + n * 1ms + 1us);
+    }
+    // 2019-12-31 23:59:59 PST and 2020-02-28 23:59:59 PST.
+    for (auto base : {1577865599s, 1582963199s})
+    {
+        for (int n = 0; n < 3; ++n)
+        {
+            times.push_back(system_clock::time_point{base + n * 1s});
+        }
+    }
+    // Several years apart, including before the epoch's first leap year.
+    for (auto base : {86400s, 951782400s, 4102444800s})
+    {
+        times.push_back(system_clock::time_point{base});
+    }
+
+    for (auto time : times)
+    {
+        LogMessage message{
+            category, LogLevel::ERROR, time, "bar.cc", 7, "f", StringPiece{"x"}};
+        EXPECT_EQ(
+            expectedHeader(message, 'E') + "x\n",
+            formatter.formatMessage(message, category));
+    }
+}
+
+TEST(GlogStyleFormatter, threads)
+{
+    ScopedTimeZone tz{"Asia/Kathmandu"};
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    GlogStyleFormatter formatter;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&, t]
+                             {
+            auto start = system_clock::time_point{1700000000s + t * 3600s};
+            for (int n = 0; n < 2000; ++n)
+            {
+                LogMessage message{
+                    category,
+                    LogLevel::INFO,
+                    start + n * 7ms,
+                    "bar.cc",
+                    7,
+                    "f",
+                    StringPiece{"x"}};
+                EXPECT_EQ(
+                    expectedHeader(message, 'I') + "x\n",
+                    formatter.formatMessage(message, category));
+            } });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+}
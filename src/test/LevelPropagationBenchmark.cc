@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "LogCategory.h"
+#include "LogLevel.h"
+#include "LoggerDB.h"
+
+using namespace tinylog;
+
+namespace
+{
+    constexpr int kCallsitesPerCategory = 5;
+
+    /**
+     * A category tree the size of a large service: state.range(0) leaf
+     * categories under 8 services, 64 modules and 512 components, with 5
+     * XLOG() callsites registered on each leaf.
+     */
+    struct LargeTree
+    {
+        explicit LargeTree(size_t numLeaves)
+            : db{LoggerDB::TESTING},
+              levels(numLeaves * kCallsitesPerCategory)
+        {
+            for (size_t n = 0; n < numLeaves; ++n)
+            {
+                auto name = "svc" + std::to_string(n % 8) + ".module" +
+                            std::to_string(n % 64) + ".component" +
+                            std::to_string(n % 512) + ".file" + std::to_string(n);
+                for (int c = 0; c < kCallsitesPerCategory; ++c)
+                {
+                    LogCategory *category = nullptr;
+                    db.xlogInit(name, &levels[n * kCallsitesPerCategory + c], &category);
+                }
+            }
+        }
+
+        LoggerDB db;
+        std::vector<std::atomic<LogLevel>> levels;
+    };
+
+    LargeTree &getTree(size_t numLeaves)
+    {
+        // Building a tree with a million callsites takes a while, so keep
+        // them around for every benchmark that uses the same size.
+        static std::vector<std::unique_ptr<LargeTree>> trees;
+        for (auto &tree : trees)
+        {
+            if (tree->levels.size() == numLeaves * kCallsitesPerCategory)
+            {
+                return *tree;
+            }
+        }
+        trees.push_back(std::make_unique<LargeTree>(numLeaves));
+        return *trees.back();
+    }
+
+    /**
+     * Change the root level, which changes the effective level of every
+     * category and callsite.
+     */
+    void BM_SetRootLevel(benchmark::State &state)
+    {
+        auto &tree = getTree(state.range(0));
+        tree.db.setLevelPropagationThreads(state.range(1));
+        auto *root = tree.db.getCategory("");
+        bool verbose = false;
+        for (auto _ : state)
+        {
+            verbose = !verbose;
+            root->setLevel(verbose ? LogLevel::DBG : LogLevel::WARN);
+        }
+        tree.db.setLevelPropagationThreads(1);
+        root->setLevel(LogLevel::ERROR);
+    }
+
+    /**
+     * Change the root level when every service sets its own level, so no
+     * effective level below the services changes.
+     */
+    void BM_SetRootLevelPruned(benchmark::State &state)
+    {
+        auto &tree = getTree(state.range(0));
+        for (int service = 0; service < 8; ++service)
+        {
+            tree.db.setLevel("svc" + std::to_string(service), LogLevel::INFO, false);
+        }
+        auto *root = tree.db.getCategory("");
+        bool verbose = false;
+        for (auto _ : state)
+        {
+            verbose = !verbose;
+            root->setLevel(verbose ? LogLevel::DBG : LogLevel::WARN);
+        }
+        for (int service = 0; service < 8; ++service)
+        {
+            tree.db.setLevel("svc" + std::to_string(service), LogLevel::MAX_LEVEL, true);
+        }
+        root->setLevel(LogLevel::ERROR);
+    }
+
+} // namespace
+
+BENCHMARK(BM_SetRootLevel)
+    ->Args({10000, 1})
+    ->Args({200000, 1})
+    ->Args({200000, 4})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_SetRootLevelPruned)
+    ->Args({200000, 1})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
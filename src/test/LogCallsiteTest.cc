@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogCallsite.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace tinylog;
+
+TEST(LogCallsite, constexprConstruction)
+{
+    static constexpr StringPiece baseName =
+        LogCallsite::getBaseName("src/foo/bar.cc");
+    static_assert(baseName.size() == 6, "base name computed at compile time");
+
+    static LogCallsite callsite{
+        "src/foo/bar.cc", 42, "doStuff", "foo.bar", LogLevel::WARN};
+    EXPECT_EQ(StringPiece("src/foo/bar.cc"), callsite.getFileName());
+    EXPECT_EQ(StringPiece("bar.cc"), callsite.getFileBaseName());
+    EXPECT_EQ(42, callsite.getLineNumber());
+    EXPECT_EQ(StringPiece("doStuff"), callsite.getFunctionName());
+    EXPECT_EQ(StringPiece("foo.bar"), callsite.getCategoryName());
+    EXPECT_EQ(LogLevel::WARN, callsite.getLevel());
+
+    EXPECT_EQ(StringPiece("bar.cc"), LogCallsite::getBaseName("bar.cc"));
+    EXPECT_EQ(StringPiece(""), LogCallsite::getBaseName("foo/"));
+}
+
+TEST(LogCallsite, registration)
+{
+    static LogCallsite first{"a.cc", 1, "f", "a", LogLevel::INFO};
+    static LogCallsite second{"a.cc", 2, "f", "a", LogLevel::INFO};
+
+    auto id1 = first.getId();
+    auto id2 = second.getId();
+    EXPECT_NE(0, id1);
+    EXPECT_NE(0, id2);
+    EXPECT_NE(id1, id2);
+    EXPECT_EQ(id1, first.getId());
+    EXPECT_EQ(&first, LogCallsiteRegistry::lookup(id1));
+    EXPECT_EQ(&second, LogCallsiteRegistry::lookup(id2));
+    EXPECT_EQ(nullptr, LogCallsiteRegistry::lookup(0));
+    EXPECT_GE(LogCallsiteRegistry::getNumCallsites(), 2);
+}
+
+TEST(LogCallsite, concurrentRegistration)
+{
+    static LogCallsite callsite{"b.cc", 7, "g", "b", LogLevel::ERROR};
+
+    std::vector<uint32_t> ids(8);
+    std::vector<std::thread> threads;
+    for (size_t n = 0; n < ids.size(); ++n)
+    {
+        threads.emplace_back([&ids, n]
+                             { ids[n] = callsite.getId(); });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    for (auto id : ids)
+    {
+        EXPECT_EQ(ids[0], id);
+    }
+    EXPECT_EQ(&callsite, LogCallsiteRegistry::lookup(ids[0]));
+}
+
+TEST(LogCallsite, intern)
+{
+    std::string file{"dir/c.cc"};
+    std::string function{"h"};
+    auto *callsite =
+        LogCallsiteRegistry::intern(file, 10, function, "c", LogLevel::DBG);
+    EXPECT_EQ(StringPiece("dir/c.cc"), callsite->getFileName());
+    EXPECT_EQ(StringPiece("c.cc"), callsite->getFileBaseName());
+    EXPECT_EQ(10, callsite->getLineNumber());
+    EXPECT_EQ(StringPiece("h"), callsite->getFunctionName());
+    EXPECT_EQ(StringPiece("c"), callsite->getCategoryName());
+    EXPECT_EQ(LogLevel::DBG, callsite->getLevel());
+
+    // The interned callsite owns copies of the strings.
+    file = "other.cc";
+    function = "other";
+    EXPECT_EQ(StringPiece("dir/c.cc"), callsite->getFileName());
+    EXPECT_EQ(StringPiece("h"), callsite->getFunctionName());
+
+    EXPECT_EQ(
+        callsite,
+        LogCallsiteRegistry::intern("dir/c.cc", 10, "h", "c", LogLevel::DBG));
+    EXPECT_NE(
+        callsite,
+        LogCallsiteRegistry::intern("dir/c.cc", 11, "h", "c", LogLevel::DBG));
+    EXPECT_NE(
+        callsite,
+        LogCallsiteRegistry::intern("dir/c.cc", 10, "h", "c", LogLevel::INFO));
+    EXPECT_EQ(callsite, LogCallsiteRegistry::lookup(callsite->getId()));
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogCategoryArena.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "LogCategory.h"
+
+using namespace tinylog;
+
+TEST(LogCategoryArena, create)
+{
+    LogCategoryArena arena;
+    auto *root = arena.createRoot(nullptr);
+    std::string name = "foo";
+    auto *foo = arena.create(name, root);
+
+    // The name is copied into the arena.
+    name = "bar";
+    EXPECT_EQ(StringPiece("foo"), foo->getName());
+    EXPECT_EQ(root, foo->getParent());
+    EXPECT_EQ(2, arena.size());
+
+    std::vector<LogCategory *> visited;
+    arena.forEach([&](LogCategory *category)
+                  { visited.push_back(category); });
+    EXPECT_EQ((std::vector<LogCategory *>{root, foo}), visited);
+}
+
+TEST(LogCategoryArena, layout)
+{
+    // Categories are packed side by side, each starting a cache line, and
+    // names of every size are interned.
+    LogCategoryArena arena;
+    auto *root = arena.createRoot(nullptr);
+    std::vector<LogCategory *> categories;
+    std::vector<std::string> names;
+    for (size_t n = 0; n < LogCategoryArena::kCategoriesPerBlock * 3; ++n)
+    {
+        names.push_back("category" + std::to_string(n));
+        if (n % 50 == 7)
+        {
+            names.back().append(LogCategoryArena::kNameBlockSize, 'x');
+        }
+        categories.push_back(arena.create(names.back(), root));
+    }
+
+    for (size_t n = 0; n < categories.size(); ++n)
+    {
+        EXPECT_EQ(0, reinterpret_cast<uintptr_t>(categories[n]) % 64);
+        EXPECT_EQ(StringPiece(names[n]), categories[n]->getName());
+    }
+    // The root took the first slot of the first block.
+    EXPECT_EQ(categories[0], root + 1);
+    EXPECT_EQ(
+        categories[LogCategoryArena::kCategoriesPerBlock - 2],
+        root + LogCategoryArena::kCategoriesPerBlock - 1);
+}
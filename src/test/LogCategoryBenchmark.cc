@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogCategory.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "LogHandler.h"
+#include "LogHandlerConfig.h"
+#include "LogMessage.h"
+#include "LoggerDB.h"
+
+using namespace tinylog;
+
+namespace
+{
+    class NullHandler : public LogHandler
+    {
+    public:
+        void handleMessage(const LogMessage &, const LogCategory *) override {}
+        void flush() override {}
+        LogHandlerConfig getConfig() const override
+        {
+            return LogHandlerConfig{"null"};
+        }
+    };
+
+    /**
+     * Admit a message at the bottom of an 8-level category tree, with one
+     * handler on the root and one halfway down, like a service that sends
+     * everything to a file and one subsystem to a separate log.
+     */
+    void BM_AdmitMessage(benchmark::State &state)
+    {
+        static LoggerDB *db = []
+        {
+            auto *result = new LoggerDB{LoggerDB::TESTING};
+            result->getCategory("")->addHandler(std::make_shared<NullHandler>());
+            result->getCategory("svc.storage.replication")
+                ->addHandler(std::make_shared<NullHandler>());
+            return result;
+        }();
+        auto *category =
+            db->getCategory("svc.storage.replication.raft.log.segment.writer");
+        LogMessage message{
+            category, LogLevel::INFO, "writer.cc", 1, "append", std::string{"msg"}};
+        for (auto _ : state)
+        {
+            category->admitMessage(message);
+        }
+    }
+
+    constexpr size_t kNumCategories = 50000;
+
+    /**
+     * A LoggerDB with 50k categories, five levels deep, and the leaf
+     * categories in a random order, so that visiting them in turn misses
+     * the cache the way lookups from all over a large program do.
+     */
+    const std::vector<LogCategory *> &getLargeTree()
+    {
+        static const auto leaves = []
+        {
+            auto *db = new LoggerDB{LoggerDB::TESTING};
+            std::vector<LogCategory *> result;
+            for (size_t n = 0; result.size() < kNumCategories; ++n)
+            {
+                result.push_back(db->getCategory(
+                    "svc" + std::to_string(n % 7) + ".module" + std::to_string(n % 53) +
+                    ".component" + std::to_string(n % 211) + ".File" +
+                    std::to_string(n) + ".cc"));
+            }
+            std::shuffle(result.begin(), result.end(), std::mt19937{1});
+            return result;
+        }();
+        return leaves;
+    }
+
+    void BM_LogCheck50k(benchmark::State &state)
+    {
+        const auto &categories = getLargeTree();
+        size_t n = 0;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(
+                categories[n++ % kNumCategories]->logCheck(LogLevel::INFO));
+        }
+    }
+
+    /**
+     * Walk from a leaf to the root, reading each category's effective level,
+     * as level propagation and dispatch-list rebuilds do.
+     */
+    void BM_ParentChainWalk50k(benchmark::State &state)
+    {
+        const auto &categories = getLargeTree();
+        size_t n = 0;
+        for (auto _ : state)
+        {
+            uint32_t sum = 0;
+            for (const auto *category = categories[n++ % kNumCategories];
+                 category != nullptr;
+                 category = category->getParent())
+            {
+                sum += static_cast<uint32_t>(category->getEffectiveLevel());
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+    }
+
+} // namespace
+
+BENCHMARK(BM_AdmitMessage)->Threads(1)->Threads(4);
+BENCHMARK(BM_LogCheck50k);
+BENCHMARK(BM_ParentChainWalk50k);
+
+BENCHMARK_MAIN();
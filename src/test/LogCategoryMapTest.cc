@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogCategoryMap.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "LogCategory.h"
+
+using namespace tinylog;
+
+namespace
+{
+    LogCategory *insert(LogCategoryMap &map, LogCategory *parent, const std::string &name)
+    {
+        return map.insert(CategoryKey{name}, parent);
+    }
+
+} // namespace
+
+TEST(LogCategoryMap, findAndInsert)
+{
+    LogCategory root{nullptr};
+    LogCategoryMap map;
+    EXPECT_EQ(nullptr, map.find(CategoryKey{"foo"}));
+
+    auto *foo = insert(map, &root, "foo");
+    auto *bar = insert(map, foo, "foo.bar");
+    EXPECT_EQ(2, map.size());
+
+    EXPECT_EQ(foo, map.find(CategoryKey{"foo"}));
+    EXPECT_EQ(bar, map.find(CategoryKey{"foo.bar"}));
+
+    // Lookups do not need a canonical name.
+    EXPECT_EQ(bar, map.find(CategoryKey{"/foo//bar/"}));
+    EXPECT_EQ(nullptr, map.find(CategoryKey{"foo.ba"}));
+}
+
+TEST(LogCategoryMap, grow)
+{
+    LogCategory root{nullptr};
+    LogCategoryMap map;
+
+    constexpr size_t kNumCategories = LogCategoryMap::kInitialCapacity * 20;
+    std::vector<LogCategory *> categories;
+    for (size_t n = 0; n < kNumCategories; ++n)
+    {
+        categories.push_back(insert(map, &root, "cat" + std::to_string(n)));
+    }
+    EXPECT_EQ(kNumCategories, map.size());
+
+    for (size_t n = 0; n < kNumCategories; ++n)
+    {
+        auto name = "cat" + std::to_string(n);
+        EXPECT_EQ(categories[n], map.find(CategoryKey{name}));
+    }
+
+    size_t visited = 0;
+    map.forEach([&](LogCategory *category)
+                { EXPECT_EQ(categories[visited++], category); });
+    EXPECT_EQ(kNumCategories, visited);
+}
+
+TEST(LogCategoryMap, concurrentFind)
+{
+    // Readers look categories up while the table grows under them.  Every
+    // category they have been told about must be found.
+    LogCategory root{nullptr};
+    LogCategoryMap map;
+
+    constexpr int kNumCategories = 5000;
+    constexpr int kNumReaders = 4;
+    std::vector<std::string> names;
+    for (int n = 0; n < kNumCategories; ++n)
+    {
+        names.push_back("tenant" + std::to_string(n) + ".requests");
+    }
+
+    std::atomic<int> inserted{0};
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < kNumReaders; ++t)
+    {
+        readers.emplace_back([&, t]
+                             {
+            int n = t;
+            while (true)
+            {
+                int done = inserted.load(std::memory_order_acquire);
+                if (done > 0)
+                {
+                    const auto &name = names[n % done];
+                    auto *category = map.find(CategoryKey{name});
+                    if (!category || !(category->getName() == name))
+                    {
+                        failed = true;
+                    }
+                    ++n;
+                }
+                if (done == kNumCategories)
+                {
+                    break;
+                }
+            } });
+    }
+
+    for (int n = 0; n < kNumCategories; ++n)
+    {
+        insert(map, &root, names[n]);
+        inserted.store(n + 1, std::memory_order_release);
+    }
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+    EXPECT_FALSE(failed.load());
+}
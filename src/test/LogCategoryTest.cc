@@ -0,0 +1,340 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogCategory.h"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "LogHandler.h"
+#include "LogHandlerConfig.h"
+#include "LogMessage.h"
+#include "LoggerDB.h"
+
+using namespace tinylog;
+
+namespace
+{
+    /**
+     * A LogHandler that records the messages it is given.
+     *
+     * If keepsMessages is true it asks for shared messages, the way the
+     * asynchronous handlers do.
+     */
+    class RecordingHandler : public LogHandler
+    {
+    public:
+        explicit RecordingHandler(bool keepsMessages)
+            : keepsMessages_{keepsMessages} {}
+
+        void handleMessage(
+            const LogMessage &message, const LogCategory *handlerCategory) override
+        {
+            messages_.emplace_back(message.getRawMessage().str(), handlerCategory);
+        }
+
+        bool keepsMessages() const override { return keepsMessages_; }
+
+        void handleSharedMessage(
+            const SharedLogMessage &message,
+            const LogCategory *handlerCategory) override
+        {
+            shared_.push_back(message);
+            handleMessage(*message, handlerCategory);
+        }
+
+        void flush() override {}
+
+        LogHandlerConfig getConfig() const override
+        {
+            return LogHandlerConfig{"recording"};
+        }
+
+        std::vector<std::pair<std::string, const LogCategory *>> messages_;
+        std::vector<SharedLogMessage> shared_;
+
+    private:
+        bool const keepsMessages_;
+    };
+
+    /**
+     * A LogHandler that counts messages, and tells when it is destroyed.
+     */
+    class CountingHandler : public LogHandler
+    {
+    public:
+        explicit CountingHandler(std::atomic<size_t> &count) : count_{count} {}
+
+        void handleMessage(const LogMessage &, const LogCategory *) override
+        {
+            count_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void flush() override {}
+
+        LogHandlerConfig getConfig() const override
+        {
+            return LogHandlerConfig{"counting"};
+        }
+
+    private:
+        std::atomic<size_t> &count_;
+    };
+
+    class ThrowingHandler : public LogHandler
+    {
+    public:
+        void handleMessage(const LogMessage &, const LogCategory *) override
+        {
+            throw std::runtime_error("handler failed");
+        }
+
+        void flush() override {}
+
+        LogHandlerConfig getConfig() const override
+        {
+            return LogHandlerConfig{"throwing"};
+        }
+    };
+
+} // namespace
+
+TEST(LogCategory, sharedMessage)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *parent = db.getCategory("foo");
+    auto *child = db.getCategory("foo.bar");
+
+    auto keeper1 = std::make_shared<RecordingHandler>(true);
+    auto keeper2 = std::make_shared<RecordingHandler>(true);
+    auto parentKeeper = std::make_shared<RecordingHandler>(true);
+    auto sync = std::make_shared<RecordingHandler>(false);
+    child->addHandler(keeper1);
+    child->addHandler(sync);
+    child->addHandler(keeper2);
+    parent->addHandler(parentKeeper);
+
+    LogMessage message{
+        child, LogLevel::ERROR, "foo.cc", 1, "func", std::string{"hello"}};
+    child->admitMessage(message);
+
+    // Every handler that keeps the message, at any level of the category
+    // hierarchy, gets the same shared copy.
+    ASSERT_EQ(1, keeper1->shared_.size());
+    ASSERT_EQ(1, keeper2->shared_.size());
+    ASSERT_EQ(1, parentKeeper->shared_.size());
+    EXPECT_EQ(keeper1->shared_[0], keeper2->shared_[0]);
+    EXPECT_EQ(keeper1->shared_[0], parentKeeper->shared_[0]);
+    EXPECT_NE(&message, keeper1->shared_[0].get());
+    EXPECT_EQ(3, keeper1->shared_[0].use_count());
+    EXPECT_EQ(StringPiece("hello"), keeper1->shared_[0]->getRawMessage());
+
+    // Handlers that don't keep the message get the original.
+    ASSERT_EQ(1, sync->messages_.size());
+    EXPECT_TRUE(sync->shared_.empty());
+
+    EXPECT_EQ(child, keeper1->messages_[0].second);
+    EXPECT_EQ(parent, parentKeeper->messages_[0].second);
+}
+
+TEST(LogCategory, noCopyWithoutKeepers)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto sync = std::make_shared<RecordingHandler>(false);
+    category->addHandler(sync);
+
+    LogMessage message{
+        category, LogLevel::ERROR, "foo.cc", 1, "func", std::string{"hello"}};
+    category->admitMessage(message);
+    ASSERT_EQ(1, sync->messages_.size());
+    EXPECT_EQ("hello", sync->messages_[0].first);
+}
+
+TEST(LogCategory, handlerErrors)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto recorder = std::make_shared<RecordingHandler>(true);
+    category->addHandler(std::make_shared<ThrowingHandler>());
+    category->addHandler(recorder);
+
+    LogMessage message{
+        category, LogLevel::ERROR, "foo.cc", 1, "func", std::string{"hello"}};
+    category->admitMessage(message);
+    EXPECT_EQ(1, recorder->messages_.size());
+
+    category->clearHandlers();
+    EXPECT_TRUE(category->getHandlers().empty());
+}
+
+TEST(LogCategory, dispatchOrder)
+{
+    // Handlers run from the category the message was admitted at up to the
+    // root, including handlers added after the children were created.
+    LoggerDB db{LoggerDB::TESTING};
+    auto *leaf = db.getCategory("a.b.c.d.e.f");
+    auto *middle = db.getCategory("a.b.c");
+    auto *root = db.getCategory("");
+
+    auto recorder = std::make_shared<RecordingHandler>(false);
+    root->addHandler(recorder);
+    middle->addHandler(recorder);
+    leaf->addHandler(recorder);
+
+    LogMessage message{
+        leaf, LogLevel::ERROR, "foo.cc", 1, "func", std::string{"hello"}};
+    leaf->admitMessage(message);
+    ASSERT_EQ(3, recorder->messages_.size());
+    EXPECT_EQ(leaf, recorder->messages_[0].second);
+    EXPECT_EQ(middle, recorder->messages_[1].second);
+    EXPECT_EQ(root, recorder->messages_[2].second);
+
+    // Categories created afterwards pick up their ancestors' handlers.
+    auto *sibling = db.getCategory("a.b.c.x");
+    LogMessage siblingMessage{
+        sibling, LogLevel::ERROR, "foo.cc", 1, "func", std::string{"hi"}};
+    sibling->admitMessage(siblingMessage);
+    ASSERT_EQ(5, recorder->messages_.size());
+    EXPECT_EQ(middle, recorder->messages_[3].second);
+    EXPECT_EQ(root, recorder->messages_[4].second);
+
+    middle->clearHandlers();
+    leaf->admitMessage(message);
+    ASSERT_EQ(7, recorder->messages_.size());
+    EXPECT_EQ(leaf, recorder->messages_[5].second);
+    EXPECT_EQ(root, recorder->messages_[6].second);
+}
+
+TEST(LogCategory, propagateLevelMessagesToParent)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *parent = db.getCategory("foo");
+    auto *child = db.getCategory("foo.bar");
+    auto *grandchild = db.getCategory("foo.bar.test");
+    auto parentHandler = std::make_shared<RecordingHandler>(false);
+    auto childHandler = std::make_shared<RecordingHandler>(false);
+    parent->addHandler(parentHandler);
+    child->addHandler(childHandler);
+
+    child->setPropagateLevelMessagesToParent(LogLevel::WARN);
+    EXPECT_EQ(LogLevel::WARN, child->getPropagateLevelMessagesToParentRelaxed());
+
+    auto log = [&](LogLevel level)
+    {
+        LogMessage message{
+            grandchild, level, "foo.cc", 1, "func", std::string{"msg"}};
+        grandchild->admitMessage(message);
+    };
+    log(LogLevel::INFO);
+    EXPECT_EQ(1, childHandler->messages_.size());
+    EXPECT_EQ(0, parentHandler->messages_.size());
+    log(LogLevel::WARN);
+    EXPECT_EQ(2, childHandler->messages_.size());
+    EXPECT_EQ(1, parentHandler->messages_.size());
+
+    child->setPropagateLevelMessagesToParent(LogLevel::MIN_LEVEL);
+    log(LogLevel::INFO);
+    EXPECT_EQ(3, childHandler->messages_.size());
+    EXPECT_EQ(2, parentHandler->messages_.size());
+}
+
+TEST(LogCategory, handlerChangesWhileLogging)
+{
+    // Threads log continuously while another thread keeps swapping the
+    // handlers up their category chains, the way a configuration reload at
+    // peak traffic would.  ASAN and TSAN check that no handler or dispatch
+    // list is freed while a message is being dispatched through it.
+    LoggerDB db{LoggerDB::TESTING};
+    constexpr int kNumLoggers = 6;
+    std::vector<LogCategory *> categories;
+    for (int n = 0; n < kNumLoggers; ++n)
+    {
+        categories.push_back(
+            db.getCategory("svc.module" + std::to_string(n % 3) + ".file" + std::to_string(n)));
+    }
+    auto *service = db.getCategory("svc");
+    auto *module = db.getCategory("svc.module1");
+
+    std::atomic<size_t> count{0};
+    std::atomic<bool> done{false};
+    std::vector<std::thread> loggers;
+    for (auto *category : categories)
+    {
+        loggers.emplace_back([&, category]
+                             {
+            LogMessage message{
+                category, LogLevel::ERROR, "foo.cc", 1, "func", std::string{"msg"}};
+            while (!done.load(std::memory_order_relaxed))
+            {
+                category->admitMessage(message);
+            } });
+    }
+
+    std::vector<std::weak_ptr<LogHandler>> oldHandlers;
+    for (int n = 0; n < 300; ++n)
+    {
+        auto handler = std::make_shared<CountingHandler>(count);
+        oldHandlers.push_back(handler);
+        switch (n % 4)
+        {
+        case 0:
+            service->replaceHandlers({handler});
+            break;
+        case 1:
+            module->addHandler(handler);
+            break;
+        case 2:
+            module->clearHandlers();
+            module->setPropagateLevelMessagesToParent(
+                n % 8 == 2 ? LogLevel::CRITICAL : LogLevel::MIN_LEVEL);
+            break;
+        default:
+            categories[n % kNumLoggers]->replaceHandlers({handler});
+            break;
+        }
+    }
+    // The service category ends up with a handler attached.  Let the
+    // loggers reach it before stopping them, even if none of them has been
+    // scheduled yet.
+    while (count.load() == 0)
+    {
+        std::this_thread::yield();
+    }
+    done = true;
+    for (auto &logger : loggers)
+    {
+        logger.join();
+    }
+
+    // Once the handlers are detached, nothing may keep them alive.
+    service->clearHandlers();
+    module->clearHandlers();
+    for (auto *category : categories)
+    {
+        category->clearHandlers();
+    }
+    for (const auto &handler : oldHandlers)
+    {
+        EXPECT_TRUE(handler.expired());
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogClock.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace tinylog;
+
+namespace
+{
+    void BM_Clock(benchmark::State &state, LogClockType type)
+    {
+        auto clock = LogClock::create(type);
+        if (clock->getType() != type)
+        {
+            state.SkipWithError("clock type not supported");
+            return;
+        }
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(clock->now());
+        }
+    }
+
+    void BM_SystemClock(benchmark::State &state)
+    {
+        BM_Clock(state, LogClockType::SYSTEM);
+    }
+    void BM_CoarseClock(benchmark::State &state)
+    {
+        BM_Clock(state, LogClockType::REALTIME_COARSE);
+    }
+    void BM_TscClock(benchmark::State &state)
+    {
+        BM_Clock(state, LogClockType::TSC);
+    }
+
+} // namespace
+
+BENCHMARK(BM_SystemClock)->Threads(1)->Threads(4);
+BENCHMARK(BM_CoarseClock)->Threads(1)->Threads(4);
+BENCHMARK(BM_TscClock)->Threads(1)->Threads(4);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogClock.h"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "LogCategory.h"
+#include "LogMessage.h"
+#include "LoggerDB.h"
+
+using namespace tinylog;
+using namespace std::chrono_literals;
+using std::chrono::nanoseconds;
+using std::chrono::system_clock;
+
+namespace
+{
+    class FixedLogClock : public LogClock
+    {
+    public:
+        explicit FixedLogClock(time_point time) : time_{time} {}
+
+        time_point now() const override { return time_; }
+        LogClockType getType() const override { return LogClockType::SYSTEM; }
+
+    private:
+        time_point const time_;
+    };
+
+    /**
+     * How far time lies outside of [before, after].
+     */
+    nanoseconds distance(
+        system_clock::time_point time,
+        system_clock::time_point before,
+        system_clock::time_point after)
+    {
+        if (time < before)
+        {
+            return before - time;
+        }
+        if (time > after)
+        {
+            return time - after;
+        }
+        return nanoseconds{0};
+    }
+
+} // namespace
+
+TEST(LogClock, create)
+{
+    EXPECT_EQ(LogClockType::SYSTEM, LogClock::create(LogClockType::SYSTEM)->getType());
+    EXPECT_EQ(
+        LogClockType::REALTIME_COARSE,
+        LogClock::create(LogClockType::REALTIME_COARSE)->getType());
+    EXPECT_EQ(
+        TscLogClock::isSupported() ? LogClockType::TSC : LogClockType::SYSTEM,
+        LogClock::create(LogClockType::TSC)->getType());
+}
+
+TEST(LogClock, coarse)
+{
+    CoarseLogClock clock;
+    EXPECT_GT(CoarseLogClock::getResolution().count(), 0);
+    for (int n = 0; n < 1000; ++n)
+    {
+        auto before = system_clock::now();
+        auto time = clock.now();
+        auto after = system_clock::now();
+        // The coarse clock lags behind by up to a few kernel ticks, but never
+        // runs ahead.
+        EXPECT_LE(time, after);
+        EXPECT_LT(before - time, 100ms);
+    }
+}
+
+TEST(LogClock, loggerDB)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    EXPECT_EQ(LogClockType::SYSTEM, db.getClock().getType());
+
+    auto fixedTime = system_clock::time_point{1234567890s};
+    db.setClock(std::make_shared<FixedLogClock>(fixedTime));
+    LogMessage message{
+        category, LogLevel::INFO, "foo.cc", 1, "func", StringPiece{"hello"}};
+    EXPECT_EQ(fixedTime, message.getTimestamp());
+
+    db.setClock(LogClockType::REALTIME_COARSE);
+    EXPECT_EQ(LogClockType::REALTIME_COARSE, db.getClock().getType());
+    db.setClock(nullptr);
+    EXPECT_EQ(&SystemLogClock::instance(), &db.getClock());
+}
+
+TEST(TscLogClock, driftBound)
+{
+    if (!TscLogClock::isSupported())
+    {
+        GTEST_SKIP() << "no invariant TSC";
+    }
+
+    // Use a short interval so the test covers several recalibrations,
+    // including the warm-up ones.
+    TscLogClock clock{50ms};
+    nanoseconds maxError{0};
+    auto end = std::chrono::steady_clock::now() + 1s;
+    while (std::chrono::steady_clock::now() < end)
+    {
+        auto before = system_clock::now();
+        auto time = clock.now();
+        auto after = system_clock::now();
+        maxError = std::max(maxError, distance(time, before, after));
+        std::this_thread::sleep_for(100us);
+    }
+    EXPECT_LE(maxError, TscLogClock::kMaxDrift);
+}
+
+TEST(TscLogClock, recalibrate)
+{
+    if (!TscLogClock::isSupported())
+    {
+        GTEST_SKIP() << "no invariant TSC";
+    }
+
+    TscLogClock clock;
+    auto ticksPerSecond = clock.getTicksPerSecond();
+    EXPECT_GT(ticksPerSecond, 1e8);
+
+    std::this_thread::sleep_for(20ms);
+    clock.recalibrate();
+    EXPECT_NEAR(ticksPerSecond, clock.getTicksPerSecond(), ticksPerSecond * 1e-3);
+
+    auto before = system_clock::now();
+    auto time = clock.now();
+    auto after = system_clock::now();
+    EXPECT_LE(distance(time, before, after), TscLogClock::kMaxDrift);
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogLevelRules.h"
+
+#include <stdexcept>
+#include <string>
+
+#include <gtest/gtest.h>
+
+using namespace tinylog;
+
+namespace
+{
+    /**
+     * Return the level of the rule that matches name, or UNINITIALIZED.
+     */
+    LogLevel matchLevel(const LogLevelRules &rules, StringPiece name)
+    {
+        const auto *rule = rules.match(name);
+        return rule ? rule->level : LogLevel::UNINITIALIZED;
+    }
+} // namespace
+
+TEST(LogLevelRules, literal)
+{
+    LogLevelRules rules;
+    EXPECT_EQ(nullptr, rules.match("foo"));
+
+    rules.add("foo.bar", LogLevel::DBG, true);
+    EXPECT_EQ(LogLevel::DBG, matchLevel(rules, "foo.bar"));
+    EXPECT_EQ(LogLevel::UNINITIALIZED, matchLevel(rules, "foo"));
+    EXPECT_EQ(LogLevel::UNINITIALIZED, matchLevel(rules, "foo.bar.baz"));
+    EXPECT_EQ(LogLevel::UNINITIALIZED, matchLevel(rules, "foo.ba"));
+
+    // Patterns are canonicalized like category names.
+    rules.add("/x//y/", LogLevel::WARN, false);
+    const auto *rule = rules.match("x.y");
+    ASSERT_NE(nullptr, rule);
+    EXPECT_EQ("x.y", rule->pattern);
+    EXPECT_EQ(LogLevel::WARN, rule->level);
+    EXPECT_FALSE(rule->inherit);
+
+    rules.add("", LogLevel::ERROR, true);
+    EXPECT_EQ(LogLevel::ERROR, matchLevel(rules, ""));
+}
+
+TEST(LogLevelRules, wildcards)
+{
+    LogLevelRules rules;
+    rules.add("rpc.*.client", LogLevel::DBG, true);
+    rules.add("db.**", LogLevel::WARN, true);
+    rules.add("a.**.z", LogLevel::INFO, true);
+
+    EXPECT_EQ(LogLevel::DBG, matchLevel(rules, "rpc.foo.client"));
+    EXPECT_EQ(LogLevel::UNINITIALIZED, matchLevel(rules, "rpc.client"));
+    EXPECT_EQ(LogLevel::UNINITIALIZED, matchLevel(rules, "rpc.foo.bar.client"));
+    EXPECT_EQ(LogLevel::UNINITIALIZED, matchLevel(rules, "rpc.foo.client.x"));
+
+    EXPECT_EQ(LogLevel::WARN, matchLevel(rules, "db"));
+    EXPECT_EQ(LogLevel::WARN, matchLevel(rules, "db.pool"));
+    EXPECT_EQ(LogLevel::WARN, matchLevel(rules, "db.pool.conn.x"));
+    EXPECT_EQ(LogLevel::UNINITIALIZED, matchLevel(rules, "dbx"));
+
+    EXPECT_EQ(LogLevel::INFO, matchLevel(rules, "a.z"));
+    EXPECT_EQ(LogLevel::INFO, matchLevel(rules, "a.b.z"));
+    EXPECT_EQ(LogLevel::INFO, matchLevel(rules, "a.z.z"));
+    EXPECT_EQ(LogLevel::INFO, matchLevel(rules, "a.b.c.d.z"));
+    EXPECT_EQ(LogLevel::UNINITIALIZED, matchLevel(rules, "a.b.z.c"));
+
+    EXPECT_THROW(rules.add("rpc.cli*", LogLevel::DBG, true), std::invalid_argument);
+    EXPECT_THROW(rules.add("***", LogLevel::DBG, true), std::invalid_argument);
+}
+
+TEST(LogLevelRules, lastRuleWins)
+{
+    LogLevelRules rules;
+    rules.add("**", LogLevel::ERROR, true);
+    rules.add("svc.*", LogLevel::INFO, true);
+    rules.add("svc.db", LogLevel::DBG, true);
+
+    EXPECT_EQ(LogLevel::ERROR, matchLevel(rules, ""));
+    EXPECT_EQ(LogLevel::ERROR, matchLevel(rules, "svc"));
+    EXPECT_EQ(LogLevel::INFO, matchLevel(rules, "svc.rpc"));
+    EXPECT_EQ(LogLevel::DBG, matchLevel(rules, "svc.db"));
+    EXPECT_EQ(LogLevel::ERROR, matchLevel(rules, "svc.db.pool"));
+
+    // Adding a pattern again replaces the old rule, and ranks it as the
+    // newest.
+    rules.add("svc.*", LogLevel::WARN, true);
+    EXPECT_EQ(LogLevel::WARN, matchLevel(rules, "svc.rpc"));
+    EXPECT_EQ(LogLevel::WARN, matchLevel(rules, "svc.db"));
+    rules.add("**", LogLevel::CRITICAL, true);
+    EXPECT_EQ(LogLevel::CRITICAL, matchLevel(rules, "svc.db"));
+}
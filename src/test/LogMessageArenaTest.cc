@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogMessageArena.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace tinylog;
+
+TEST(LogMessageArena, allocate)
+{
+    std::vector<char *> blocks;
+    for (size_t size : {size_t{1}, size_t{7}, size_t{300}, size_t{4000}})
+    {
+        char *block = LogMessageArena::allocate(size);
+        memset(block, 'x', size);
+        blocks.push_back(block);
+    }
+    // Larger than kMaxArenaAllocation, so this comes from malloc.
+    char *large = LogMessageArena::allocate(LogMessageArena::kMaxArenaAllocation + 1);
+    memset(large, 'y', LogMessageArena::kMaxArenaAllocation + 1);
+    blocks.push_back(large);
+
+    EXPECT_GE(LogMessageArena::getNumSlabs(), 1);
+    for (auto *block : blocks)
+    {
+        LogMessageArena::deallocate(block);
+    }
+    LogMessageArena::deallocate(nullptr);
+}
+
+TEST(LogMessageArena, slabsAreReused)
+{
+    // Allocate far more than one slab's worth, freeing as we go.  The freed
+    // slabs should be recycled rather than new ones allocated each time.
+    for (int n = 0; n < 10000; ++n)
+    {
+        LogMessageArena::Ptr block = LogMessageArena::allocatePtr(1000);
+        memset(block.get(), 'x', 1000);
+    }
+    EXPECT_LE(LogMessageArena::getNumSlabs(), 4);
+}
+
+TEST(LogMessageArena, crossThreadFree)
+{
+    // Blocks are allocated on the producer thread and freed on the consumer
+    // thread, the way asynchronous LogHandlers use the arena.
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<LogMessageArena::Ptr> queue;
+    bool done = false;
+    constexpr int kNumBlocks = 50000;
+    constexpr size_t kMaxQueued = 200;
+
+    std::thread consumer([&]
+                         {
+        size_t expected = 0;
+        while (true)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return !queue.empty() || done; });
+            if (queue.empty())
+            {
+                return;
+            }
+            auto block = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+            cv.notify_all();
+
+            char c = static_cast<char>('a' + expected % 26);
+            EXPECT_EQ(c, block[0]);
+            EXPECT_EQ(c, block[999]);
+            ++expected;
+        } });
+
+    std::thread producer([&]
+                         {
+        for (int n = 0; n < kNumBlocks; ++n)
+        {
+            auto block = LogMessageArena::allocatePtr(1000);
+            memset(block.get(), 'a' + n % 26, 1000);
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return queue.size() < kMaxQueued; });
+            queue.push_back(std::move(block));
+            cv.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        cv.notify_all(); });
+
+    producer.join();
+    consumer.join();
+
+    // At most kMaxQueued blocks were live at once, which is only a few slabs.
+    auto slabsPerQueue =
+        kMaxQueued * 1000 / LogMessageArena::kSlabSize + 2;
+    EXPECT_LE(LogMessageArena::getNumSlabs(), slabsPerQueue + 4);
+    // The producer thread has exited, so all its slabs are free again.  Only
+    // the slab this thread may be allocating from is still in use.
+    EXPECT_GE(LogMessageArena::getNumFreeSlabs() + 1, LogMessageArena::getNumSlabs());
+}
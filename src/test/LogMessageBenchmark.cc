@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogMessage.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "LogCategory.h"
+#include "LoggerDB.h"
+
+using namespace tinylog;
+
+namespace
+{
+    std::atomic<size_t> numAllocations{0};
+
+} // namespace
+
+void *operator new(size_t size)
+{
+    numAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace
+{
+    /**
+     * The message storage LogMessage used before it had inline storage: the
+     * caller builds a std::string that is moved in, plus a std::string each
+     * for the context and the sanitized message.
+     */
+    struct StringStorage
+    {
+        StringStorage(std::string &&raw, std::string &&context)
+            : rawMessage{std::move(raw)}, contextString{std::move(context)} {}
+
+        std::string rawMessage;
+        std::string contextString;
+        std::string message;
+    };
+
+    std::string makeMessage(size_t length, bool dirty)
+    {
+        std::string msg(length, 'a');
+        if (dirty && length > 0)
+        {
+            msg[length / 2] = '\x01';
+        }
+        return msg;
+    }
+
+    void reportAllocations(benchmark::State &state, size_t before)
+    {
+        state.counters["allocs/msg"] = benchmark::Counter(
+            static_cast<double>(numAllocations.load() - before),
+            benchmark::Counter::kAvgIterations);
+    }
+
+    void BM_StringStorage(benchmark::State &state, bool dirty)
+    {
+        auto msg = makeMessage(static_cast<size_t>(state.range(0)), dirty);
+        auto before = numAllocations.load();
+        for (auto _ : state)
+        {
+            StringStorage storage{std::string{msg}, std::string{}};
+            if (dirty)
+            {
+                storage.message.reserve(storage.rawMessage.size() + 3);
+            }
+            benchmark::DoNotOptimize(storage.message.data());
+        }
+        reportAllocations(state, before);
+    }
+
+    void BM_LogMessage(benchmark::State &state, bool dirty)
+    {
+        LoggerDB db{LoggerDB::TESTING};
+        auto *category = db.getCategory("test");
+        static LogCallsite callsite{
+            "LogMessageBenchmark.cc", 1, "BM_LogMessage", "test", LogLevel::INFO};
+
+        auto msg = makeMessage(static_cast<size_t>(state.range(0)), dirty);
+        auto before = numAllocations.load();
+        for (auto _ : state)
+        {
+            LogMessage message{category, LogLevel::INFO, &callsite, msg};
+            benchmark::DoNotOptimize(message.getMessage().data());
+        }
+        reportAllocations(state, before);
+    }
+
+    void BM_StringStorageClean(benchmark::State &state)
+    {
+        BM_StringStorage(state, false);
+    }
+    void BM_StringStorageDirty(benchmark::State &state)
+    {
+        BM_StringStorage(state, true);
+    }
+    void BM_LogMessageClean(benchmark::State &state)
+    {
+        BM_LogMessage(state, false);
+    }
+    void BM_LogMessageDirty(benchmark::State &state)
+    {
+        BM_LogMessage(state, true);
+    }
+
+} // namespace
+
+BENCHMARK(BM_StringStorageClean)->Arg(16)->Arg(64)->Arg(200)->Arg(1000);
+BENCHMARK(BM_LogMessageClean)->Arg(16)->Arg(64)->Arg(200)->Arg(1000);
+BENCHMARK(BM_StringStorageDirty)->Arg(16)->Arg(64)->Arg(200)->Arg(1000);
+BENCHMARK(BM_LogMessageDirty)->Arg(16)->Arg(64)->Arg(200)->Arg(1000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogMessageSanitizer.h"
+
+#include <memory>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+using namespace tinylog;
+using namespace tinylog::detail;
+
+namespace
+{
+    // A message with no characters that need escaping, and one newline every
+    // 80 bytes.
+    std::string makeCleanMessage(size_t length)
+    {
+        std::string msg;
+        msg.reserve(length);
+        for (size_t n = 0; n < length; ++n)
+        {
+            msg.push_back(n % 80 == 79 ? '\n' : static_cast<char>('a' + n % 26));
+        }
+        return msg;
+    }
+
+    // A message with a control character every 64 bytes.
+    std::string makeDirtyMessage(size_t length)
+    {
+        auto msg = makeCleanMessage(length);
+        for (size_t n = 32; n < length; n += 64)
+        {
+            msg[n] = '\x01';
+        }
+        return msg;
+    }
+
+    void runSanitize(benchmark::State &state, SanitizerIsa isa, bool dirty)
+    {
+        if (!isSanitizerIsaSupported(isa))
+        {
+            state.SkipWithError("not supported on this CPU");
+            return;
+        }
+        auto length = static_cast<size_t>(state.range(0));
+        auto msg = dirty ? makeDirtyMessage(length) : makeCleanMessage(length);
+        for (auto _ : state)
+        {
+            // This mirrors LogMessage::sanitizeMessage().
+            auto scan = scanMessage(msg, isa);
+            benchmark::DoNotOptimize(scan);
+            if (scan.numEscaped != 0)
+            {
+                std::unique_ptr<char[]> out{new char[msg.size() + 3 * scan.numEscaped]};
+                benchmark::DoNotOptimize(escapeMessage(msg, out.get(), isa));
+            }
+        }
+        state.SetBytesProcessed(
+            static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(length));
+    }
+
+    void BM_SanitizeClean_Scalar(benchmark::State &state)
+    {
+        runSanitize(state, SanitizerIsa::SCALAR, false);
+    }
+    void BM_SanitizeClean_SSE2(benchmark::State &state)
+    {
+        runSanitize(state, SanitizerIsa::SSE2, false);
+    }
+    void BM_SanitizeClean_AVX2(benchmark::State &state)
+    {
+        runSanitize(state, SanitizerIsa::AVX2, false);
+    }
+    void BM_SanitizeDirty_Scalar(benchmark::State &state)
+    {
+        runSanitize(state, SanitizerIsa::SCALAR, true);
+    }
+    void BM_SanitizeDirty_SSE2(benchmark::State &state)
+    {
+        runSanitize(state, SanitizerIsa::SSE2, true);
+    }
+    void BM_SanitizeDirty_AVX2(benchmark::State &state)
+    {
+        runSanitize(state, SanitizerIsa::AVX2, true);
+    }
+
+} // namespace
+
+BENCHMARK(BM_SanitizeClean_Scalar)->RangeMultiplier(4)->Range(16, 64 << 10);
+BENCHMARK(BM_SanitizeClean_SSE2)->RangeMultiplier(4)->Range(16, 64 << 10);
+BENCHMARK(BM_SanitizeClean_AVX2)->RangeMultiplier(4)->Range(16, 64 << 10);
+BENCHMARK(BM_SanitizeDirty_Scalar)->RangeMultiplier(4)->Range(16, 64 << 10);
+BENCHMARK(BM_SanitizeDirty_SSE2)->RangeMultiplier(4)->Range(16, 64 << 10);
+BENCHMARK(BM_SanitizeDirty_AVX2)->RangeMultiplier(4)->Range(16, 64 << 10);
+
+BENCHMARK_MAIN();
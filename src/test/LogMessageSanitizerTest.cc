@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogMessageSanitizer.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace tinylog;
+using namespace tinylog::detail;
+
+namespace
+{
+    std::vector<SanitizerIsa> supportedIsas()
+    {
+        std::vector<SanitizerIsa> isas;
+        for (auto isa : {SanitizerIsa::SCALAR, SanitizerIsa::SSE2, SanitizerIsa::AVX2})
+        {
+            if (isSanitizerIsaSupported(isa))
+            {
+                isas.push_back(isa);
+            }
+        }
+        return isas;
+    }
+
+    std::string sanitize(StringPiece msg, SanitizerIsa isa)
+    {
+        auto scan = scanMessage(msg, SanitizerIsa::SCALAR);
+        std::string out(msg.size() + 3 * scan.numEscaped, '\0');
+        char *end = escapeMessage(msg, &out[0], isa);
+        EXPECT_EQ(out.data() + out.size(), end);
+        return out;
+    }
+
+} // namespace
+
+TEST(LogMessageSanitizer, escape)
+{
+    for (auto isa : supportedIsas())
+    {
+        SCOPED_TRACE(getSanitizerIsaName(isa));
+        EXPECT_EQ("", sanitize("", isa));
+        EXPECT_EQ("hello world", sanitize("hello world", isa));
+        EXPECT_EQ("a\tb\nc", sanitize("a\tb\nc", isa));
+        EXPECT_EQ("x\\x01y\\x7f", sanitize("x\x01y\x7f", isa));
+        EXPECT_EQ("\\x00", sanitize(StringPiece("\0", 1), isa));
+        EXPECT_EQ("\xe2\x9c\x93", sanitize("\xe2\x9c\x93", isa));
+
+        auto scan = scanMessage("line1\nline2\n\x1b[0m", isa);
+        EXPECT_EQ(2, scan.numNewlines);
+        EXPECT_EQ(1, scan.numEscaped);
+    }
+}
+
+TEST(LogMessageSanitizer, matchesScalar)
+{
+    // Compare each kernel against the scalar one on random inputs, with
+    // lengths chosen to exercise the vector loops and the scalar tails.
+    std::mt19937 rng{1234};
+    for (size_t length : {1, 15, 16, 17, 31, 32, 33, 63, 64, 100, 1000, 4097})
+    {
+        for (int density : {0, 1, 10, 50})
+        {
+            std::string msg(length, 'a');
+            for (auto &c : msg)
+            {
+                if (static_cast<int>(rng() % 100) < density)
+                {
+                    c = static_cast<char>(rng() % 256);
+                }
+                else
+                {
+                    c = static_cast<char>(0x20 + rng() % 0x5f);
+                }
+            }
+            auto expectedScan = scanMessage(msg, SanitizerIsa::SCALAR);
+            auto expected = sanitize(msg, SanitizerIsa::SCALAR);
+            EXPECT_EQ(msg.size() + 3 * expectedScan.numEscaped, expected.size());
+            for (auto isa : supportedIsas())
+            {
+                SCOPED_TRACE(getSanitizerIsaName(isa));
+                auto scan = scanMessage(msg, isa);
+                EXPECT_EQ(expectedScan.numEscaped, scan.numEscaped);
+                EXPECT_EQ(expectedScan.numNewlines, scan.numNewlines);
+                EXPECT_EQ(expected, sanitize(msg, isa));
+            }
+        }
+    }
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogMessage.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "LogCategory.h"
+#include "LoggerDB.h"
+
+using namespace tinylog;
+
+namespace
+{
+    void checkMessage(
+        StringPiece msg,
+        StringPiece expected,
+        size_t expectedNumNewlines)
+    {
+        LoggerDB db{LoggerDB::TESTING};
+        auto *category = db.getCategory("test");
+        LogMessage message{
+            category, LogLevel::INFO, "foo.cc", 10, "bar", msg};
+        EXPECT_EQ(msg, message.getRawMessage());
+        EXPECT_EQ(expected, message.getMessage());
+        EXPECT_EQ(expectedNumNewlines, message.getNumNewlines());
+        EXPECT_EQ(expectedNumNewlines > 0, message.containNewlines());
+    }
+
+} // namespace
+
+TEST(LogMessage, sanitize)
+{
+    checkMessage("foo", "foo", 0);
+    checkMessage("foo\nbar", "foo\nbar", 1);
+    checkMessage("\tfoo\n\nbar\n", "\tfoo\n\nbar\n", 3);
+    checkMessage("foo\x01 bar\x7f", "foo\\x01 bar\\x7f", 0);
+    checkMessage(StringPiece("a\0b", 3), "a\\x00b", 0);
+    checkMessage("\x1b[0m\n", "\\x1b[0m\n", 1);
+}
+
+TEST(LogMessage, copy)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+
+    LogMessage unsanitized{
+        category, LogLevel::INFO, "foo.cc", 10, "bar", std::string{"a\x02\nb"}};
+    LogMessage copy1{unsanitized};
+    EXPECT_EQ(StringPiece("a\\x02\nb"), copy1.getMessage());
+    EXPECT_EQ(1, copy1.getNumNewlines());
+
+    EXPECT_EQ(StringPiece("a\\x02\nb"), unsanitized.getMessage());
+    LogMessage copy2{unsanitized};
+    EXPECT_EQ(StringPiece("a\\x02\nb"), copy2.getMessage());
+    EXPECT_EQ(1, copy2.getNumNewlines());
+    EXPECT_EQ(unsanitized.getRawMessage(), copy2.getRawMessage());
+}
+
+TEST(LogMessage, sourceLocation)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+
+    LogMessage message{
+        category, LogLevel::WARN, "src/foo.cc", 10, "bar", std::string{"msg"}};
+    EXPECT_EQ(StringPiece("src/foo.cc"), message.getFileName());
+    EXPECT_EQ(StringPiece("foo.cc"), message.getFileBaseName());
+    EXPECT_EQ(10, message.getLineNumber());
+    EXPECT_EQ(StringPiece("bar"), message.getFunctionName());
+
+    // The source location is interned into a callsite, which is shared by
+    // messages logged from the same place.
+    const auto *callsite = message.getCallsite();
+    EXPECT_EQ(StringPiece("src/foo.cc"), callsite->getFileName());
+    EXPECT_EQ(10, callsite->getLineNumber());
+    EXPECT_EQ(StringPiece("bar"), callsite->getFunctionName());
+    EXPECT_EQ(StringPiece("test"), callsite->getCategoryName());
+    EXPECT_EQ(LogLevel::WARN, callsite->getLevel());
+    EXPECT_EQ(callsite, message.getCallsite());
+
+    LogMessage other{
+        category, LogLevel::WARN, "src/foo.cc", 10, "bar", std::string{"other"}};
+    EXPECT_EQ(callsite, other.getCallsite());
+    LogMessage copy{message};
+    EXPECT_EQ(callsite, copy.getCallsite());
+
+    static LogCallsite staticCallsite{
+        "src/baz.cc", 20, "qux", "test", LogLevel::ERROR};
+    LogMessage fromCallsite{
+        category, LogLevel::ERROR, &staticCallsite, std::string{"msg"}};
+    EXPECT_EQ(&staticCallsite, fromCallsite.getCallsite());
+    EXPECT_EQ(StringPiece("baz.cc"), fromCallsite.getFileBaseName());
+    EXPECT_EQ(20, fromCallsite.getLineNumber());
+    EXPECT_EQ(StringPiece("qux"), fromCallsite.getFunctionName());
+}
+
+TEST(LogMessage, storage)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+
+    // Messages around and beyond the inline capacity, clean and needing
+    // escapes whose sanitized form does not fit in the remaining space.
+    for (size_t length : {size_t{0},
+                          size_t{100},
+                          LogMessage::kInlineCapacity - 1,
+                          LogMessage::kInlineCapacity,
+                          LogMessage::kInlineCapacity + 1,
+                          size_t{5000}})
+    {
+        for (bool dirty : {false, true})
+        {
+            std::string raw(length, 'x');
+            std::string expected = raw;
+            if (dirty && length > 0)
+            {
+                raw[length / 2] = '\x05';
+                expected = raw.substr(0, length / 2) + "\\x05" +
+                           raw.substr(length / 2 + 1);
+            }
+            LogMessage message{category, LogLevel::INFO, "foo.cc", 10, "bar", raw};
+            LogMessage unsanitizedCopy{message};
+            EXPECT_EQ(StringPiece(raw), message.getRawMessage());
+            EXPECT_EQ(StringPiece(expected), message.getMessage());
+            LogMessage sanitizedCopy{message};
+
+            raw.assign(raw.size(), 'y');
+            EXPECT_EQ(StringPiece(expected), unsanitizedCopy.getMessage());
+            EXPECT_EQ(StringPiece(expected), sanitizedCopy.getMessage());
+            EXPECT_EQ(message.getRawMessage(), sanitizedCopy.getRawMessage());
+            EXPECT_EQ(
+                message.getContexString(), sanitizedCopy.getContexString());
+
+            // A message stored out of line keeps its sanitized text in the
+            // same heap block, right after the context string.
+            if (dirty && length > LogMessage::kInlineCapacity)
+            {
+                for (const auto *msg : {&message, &unsanitizedCopy, &sanitizedCopy})
+                {
+                    auto context = msg->getContexString();
+                    EXPECT_EQ(context.data() + context.size(), msg->getMessage().data());
+                }
+            }
+        }
+    }
+}
+
+TEST(LogMessage, concurrentSanitize)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+
+    std::string raw;
+    for (int n = 0; n < 1000; ++n)
+    {
+        raw += "line\x03\n";
+    }
+    std::string expected;
+    for (int n = 0; n < 1000; ++n)
+    {
+        expected += "line\\x03\n";
+    }
+
+    for (int iter = 0; iter < 20; ++iter)
+    {
+        LogMessage message{
+            category, LogLevel::INFO, "foo.cc", 10, "bar", std::string{raw}};
+        std::atomic<bool> go{false};
+        std::vector<std::thread> threads;
+        std::vector<std::string> results(4);
+        std::vector<size_t> newlines(4);
+        for (size_t t = 0; t < results.size(); ++t)
+        {
+            threads.emplace_back([&, t]
+                                 {
+                while (!go.load())
+                {
+                }
+                results[t] = message.getMessage().str();
+                newlines[t] = message.getNumNewlines(); });
+        }
+        go.store(true);
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        for (size_t t = 0; t < results.size(); ++t)
+        {
+            EXPECT_EQ(expected, results[t]);
+            EXPECT_EQ(1000, newlines[t]);
+        }
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogName.h"
+
+#include <benchmark/benchmark.h>
+
+#include "CategoryKey.h"
+
+using namespace tinylog;
+
+namespace
+{
+    constexpr const char *kShortName = "server.rpc.client";
+    constexpr const char *kLongName =
+        "home.builder.src.services.storage.replication.ReplicaSetManager.cc";
+    constexpr const char *kNonCanonicalName =
+        "/home/builder/src/services/storage/replication/ReplicaSetManager.cc";
+
+    void hash(benchmark::State &state, StringPiece name)
+    {
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(LogName::hash(name));
+        }
+    }
+
+    void hashCanonical(benchmark::State &state, StringPiece name)
+    {
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(LogName::hashCanonical(name));
+        }
+    }
+
+    void categoryKey(benchmark::State &state, StringPiece name)
+    {
+        for (auto _ : state)
+        {
+            CategoryKey key{name};
+            benchmark::DoNotOptimize(key.hash());
+        }
+    }
+
+} // namespace
+
+BENCHMARK_CAPTURE(hash, short, kShortName);
+BENCHMARK_CAPTURE(hashCanonical, short, kShortName);
+BENCHMARK_CAPTURE(hash, long, kLongName);
+BENCHMARK_CAPTURE(hashCanonical, long, kLongName);
+BENCHMARK_CAPTURE(categoryKey, canonical, kLongName);
+BENCHMARK_CAPTURE(categoryKey, nonCanonical, kNonCanonicalName);
+
+BENCHMARK_MAIN();
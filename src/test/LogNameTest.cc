@@ -39,6 +39,60 @@ TEST(LogName, canonicalize)
     EXPECT_EQ("a.b.c", LogName::canonicalize("/a.b.//.c/"));
 }
 
+namespace
+{
+    template <size_t N>
+    struct ConstexprName
+    {
+        constexpr explicit ConstexprName(const char (&input)[N])
+            : size{LogName::canonicalizeTo(StringPiece(input, N - 1), data)} {}
+
+        char data[N]{};
+        size_t size;
+    };
+
+    constexpr bool nameEquals(StringPiece a, StringPiece b)
+    {
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+        for (int idx = 0; idx < a.size(); ++idx)
+        {
+            if (a[idx] != b[idx])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr ConstexprName<11> kSourceName{"/a.b.//.c/"};
+    static_assert(
+        nameEquals(StringPiece(kSourceName.data, kSourceName.size), "a.b.c"),
+        "canonicalizeTo() must work at compile time");
+    static_assert(LogName::canonicalSize("/a.b.//.c/") == 5, "");
+    static_assert(
+        LogName::hash("src/foo/bar.cc") == LogName::hash("src.foo.bar.cc"),
+        "hash() must work at compile time");
+} // namespace
+
+TEST(LogName, canonicalizeTo)
+{
+    // canonicalizeTo() and canonicalSize() must agree with canonicalize().
+    for (StringPiece input : {
+             "", ".", "...", "/", ".//..////./", ".foo..bar.", "a.b.c", "a/b/c",
+             "a/b/c/", "a..b..c...", "....a.b.c", "a.b.c....", "////a.b.c",
+             "a.b.c////", "/a.b.//.c/", "/root/repo/src/test/LogNameTest.cc"})
+    {
+        std::string out(input.size(), '\0');
+        out.resize(LogName::canonicalizeTo(input, &out[0]));
+        EXPECT_EQ(LogName::canonicalize(input), out) << input.str();
+        EXPECT_EQ(out.size(), LogName::canonicalSize(input)) << input.str();
+        EXPECT_EQ(LogName::hash(input), LogName::hash(out)) << input.str();
+    }
+}
+
 TEST(LogName, getParent)
 {
     EXPECT_EQ(StringPiece(""), LogName::getParent("foo"));
@@ -70,6 +124,48 @@ TEST(LogName, hash)
     EXPECT_NE(LogName::hash("a.b.c"), LogName::hash("abc"));
 }
 
+TEST(LogName, hashCanonical)
+{
+    // hashCanonical() must agree with hash() at every length, including
+    // names long enough to be hashed a word at a time.
+    std::string name;
+    for (int n = 0; n < 200; ++n)
+    {
+        // Append "a.b" style segments, so the name stays canonical.
+        if (n % 9 == 8)
+        {
+            name.push_back('.');
+        }
+        name.push_back(static_cast<char>('a' + n * 7 % 26));
+        EXPECT_EQ(LogName::hash(name), LogName::hashCanonical(name)) << name;
+
+        // Check bytes with the high bit set as well.
+        auto highBit = name;
+        highBit.back() = '\xe9';
+        EXPECT_EQ(LogName::hash(highBit), LogName::hashCanonical(highBit));
+    }
+    EXPECT_EQ(LogName::hash(""), LogName::hashCanonical(""));
+
+    auto fileName =
+        LogName::canonicalize("/root/repo/src/some/long/directory/LogNameTest.cc");
+    EXPECT_EQ(LogName::hash(fileName), LogName::hashCanonical(fileName));
+}
+
+TEST(LogName, isCanonical)
+{
+    EXPECT_TRUE(LogName::isCanonical(""));
+    EXPECT_TRUE(LogName::isCanonical("foo"));
+    EXPECT_TRUE(LogName::isCanonical("a.b.c"));
+
+    EXPECT_FALSE(LogName::isCanonical("."));
+    EXPECT_FALSE(LogName::isCanonical("/"));
+    EXPECT_FALSE(LogName::isCanonical(".foo"));
+    EXPECT_FALSE(LogName::isCanonical("foo."));
+    EXPECT_FALSE(LogName::isCanonical("foo/bar"));
+    EXPECT_FALSE(LogName::isCanonical("foo..bar"));
+    EXPECT_FALSE(LogName::isCanonical("/foo"));
+}
+
 TEST(LogName, cmp)
 {
     EXPECT_EQ(0, LogName::cmp("foo", "foo."));
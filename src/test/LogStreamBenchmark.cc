@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogStream.h"
+
+#include <sstream>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+using namespace tinylog;
+
+namespace
+{
+    const std::string kName = "request_handler";
+
+    /**
+     * A fresh std::ostringstream per message, the way glog builds messages.
+     */
+    void BM_Ostringstream(benchmark::State &state)
+    {
+        int n = 0;
+        for (auto _ : state)
+        {
+            std::ostringstream os;
+            os << kName << " handled " << n << " requests in " << n * 0.001 << "s";
+            benchmark::DoNotOptimize(os.str());
+            ++n;
+        }
+    }
+
+    void BM_PooledLogStream(benchmark::State &state)
+    {
+        int n = 0;
+        for (auto _ : state)
+        {
+            auto *stream = LogStream::acquire();
+            *stream << kName << " handled " << n << " requests in " << n * 0.001 << "s";
+            benchmark::DoNotOptimize(stream->getText().data());
+            LogStream::release(stream);
+            ++n;
+        }
+    }
+
+} // namespace
+
+BENCHMARK(BM_Ostringstream)->Threads(1)->Threads(4);
+BENCHMARK(BM_PooledLogStream)->Threads(1)->Threads(4);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogStreamProcessor.h"
+
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "LogCategory.h"
+#include "LoggerDB.h"
+#include "src/test/TestLogHandler.h"
+
+using namespace tinylog;
+
+namespace
+{
+    using test::RecordingHandler;
+
+    std::string logAndReturn(const LogCategory *category, int depth)
+    {
+        if (depth > 0)
+        {
+            TINYLOG_STREAM(category, LogLevel::ERROR)
+                << "depth " << depth << " [" << logAndReturn(category, depth - 1) << "]";
+        }
+        return "d" + std::to_string(depth);
+    }
+
+} // namespace
+
+TEST(LogStream, log)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto handler = std::make_shared<RecordingHandler>();
+    category->addHandler(handler);
+
+    TINYLOG_STREAM(category, LogLevel::ERROR) << "x=" << 5 << ", y=" << 1.5;
+    TINYLOG_STREAM(category, LogLevel::ERROR);
+
+    int evaluated = 0;
+    auto sideEffect = [&]
+    {
+        ++evaluated;
+        return "unused";
+    };
+    TINYLOG_STREAM(category, LogLevel::INFO) << sideEffect();
+    EXPECT_EQ(0, evaluated);
+
+    EXPECT_EQ((std::vector<std::string>{"x=5, y=1.5", ""}), handler->getMessages());
+}
+
+TEST(LogStream, formattingIsReset)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto handler = std::make_shared<RecordingHandler>();
+    category->addHandler(handler);
+
+    TINYLOG_STREAM(category, LogLevel::ERROR)
+        << std::hex << std::setfill('0') << std::setw(4) << 255 << " "
+        << std::setprecision(2) << 3.14159;
+    TINYLOG_STREAM(category, LogLevel::ERROR) << 255 << " " << 3.14159;
+
+    EXPECT_EQ(
+        (std::vector<std::string>{"00ff 3.1", "255 3.14159"}), handler->getMessages());
+}
+
+TEST(LogStream, reentrant)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto handler = std::make_shared<RecordingHandler>();
+    category->addHandler(handler);
+
+    // Each statement's arguments log another statement, nested deeper than
+    // the number of pooled streams.
+    logAndReturn(category, 6);
+    EXPECT_EQ(
+        (std::vector<std::string>{
+            "depth 1 [d0]",
+            "depth 2 [d1]",
+            "depth 3 [d2]",
+            "depth 4 [d3]",
+            "depth 5 [d4]",
+            "depth 6 [d5]",
+        }),
+        handler->getMessages());
+}
+
+TEST(LogStream, streamsAreReused)
+{
+    auto *first = LogStream::acquire();
+    *first << "hello";
+    EXPECT_EQ(StringPiece{"hello"}, first->getText());
+    LogStream::release(first);
+
+    auto *second = LogStream::acquire();
+    EXPECT_EQ(first, second);
+    EXPECT_TRUE(second->empty());
+
+    // A large message grows the buffer, which is shrunk again on release.
+    std::string big(LogStreamBuffer::kMaxRetainedCapacity * 2, 'x');
+    *second << big << '!';
+    EXPECT_EQ(big + "!", second->getText().str());
+    LogStream::release(second);
+
+    auto *third = LogStream::acquire();
+    EXPECT_TRUE(third->empty());
+    *third << 42;
+    EXPECT_EQ(StringPiece{"42"}, third->getText());
+    LogStream::release(third);
+}
+
+TEST(LogStream, threads)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *category = db.getCategory("test");
+    auto handler = std::make_shared<RecordingHandler>();
+    category->addHandler(handler);
+
+    constexpr int kNumThreads = 4;
+    constexpr int kNumMessages = 1000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; ++t)
+    {
+        threads.emplace_back([category, t]
+                             {
+            for (int n = 0; n < kNumMessages; ++n)
+            {
+                TINYLOG_STREAM(category, LogLevel::ERROR) << t << ":" << n;
+            } });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    auto messages = handler->getMessages();
+    ASSERT_EQ(kNumThreads * kNumMessages, messages.size());
+    std::vector<int> next(kNumThreads, 0);
+    for (const auto &msg : messages)
+    {
+        auto colon = msg.find(':');
+        int t = std::stoi(msg.substr(0, colon));
+        EXPECT_EQ(next[t]++, std::stoi(msg.substr(colon + 1)));
+    }
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LoggerDB.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "LogCategory.h"
+#include "LogLevel.h"
+
+using namespace tinylog;
+
+namespace
+{
+    constexpr int kNumTenants = 1000;
+
+    /**
+     * Per-tenant categories, the way request handlers look them up.
+     */
+    const std::vector<std::string> &getTenantNames()
+    {
+        static const auto names = []
+        {
+            std::vector<std::string> result;
+            for (int n = 0; n < kNumTenants; ++n)
+            {
+                result.push_back("server.tenants.t" + std::to_string(n) + ".requests");
+            }
+            return result;
+        }();
+        return names;
+    }
+
+    LoggerDB &getTenantDB()
+    {
+        static LoggerDB *db = []
+        {
+            auto *result = new LoggerDB{LoggerDB::TESTING};
+            for (const auto &name : getTenantNames())
+            {
+                result->getCategory(name);
+            }
+            return result;
+        }();
+        return *db;
+    }
+
+    void BM_GetCategoryOrNull(benchmark::State &state)
+    {
+        auto &db = getTenantDB();
+        const auto &names = getTenantNames();
+        size_t n = state.thread_index() * 97;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(db.getCategoryOrNull(names[n % kNumTenants]));
+            ++n;
+        }
+    }
+
+    /**
+     * The same lookups, with names that have to be canonicalized first.
+     */
+    void BM_GetCategoryOrNullNonCanonical(benchmark::State &state)
+    {
+        auto &db = getTenantDB();
+        std::vector<std::string> names;
+        for (const auto &name : getTenantNames())
+        {
+            names.push_back("/" + name);
+            std::replace(names.back().begin(), names.back().end(), '.', '/');
+        }
+        size_t n = state.thread_index() * 97;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(db.getCategoryOrNull(names[n % kNumTenants]));
+            ++n;
+        }
+    }
+
+    void BM_GetExistingCategory(benchmark::State &state)
+    {
+        auto &db = getTenantDB();
+        const auto &names = getTenantNames();
+        size_t n = state.thread_index() * 97;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(db.getCategory(names[n % kNumTenants]));
+            ++n;
+        }
+    }
+
+    /**
+     * The categories a large service resolves at startup: a few services,
+     * each with many modules, each with a few files.
+     */
+    const std::vector<std::string> &getStartupNames()
+    {
+        static const auto names = []
+        {
+            std::vector<std::string> result;
+            for (int service = 0; service < 8; ++service)
+            {
+                for (int module = 0; module < 50; ++module)
+                {
+                    for (int file = 0; file < 10; ++file)
+                    {
+                        result.push_back(
+                            "svc" + std::to_string(service) + ".module" +
+                            std::to_string(module) + ".File" + std::to_string(file) +
+                            ".cc");
+                    }
+                }
+            }
+            return result;
+        }();
+        return names;
+    }
+
+    /**
+     * state.range(0) threads start at once and each resolve every startup
+     * category, in a different order, against an empty LoggerDB.  The time
+     * includes starting the threads.
+     */
+    void BM_ColdStart(benchmark::State &state)
+    {
+        const auto &names = getStartupNames();
+        const int numThreads = state.range(0);
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            auto db = std::make_unique<LoggerDB>(LoggerDB::TESTING);
+            state.ResumeTiming();
+
+            std::vector<std::thread> threads;
+            for (int t = 0; t < numThreads; ++t)
+            {
+                threads.emplace_back([&, t]
+                                     {
+                    size_t offset = t * names.size() / numThreads;
+                    for (size_t n = 0; n < names.size(); ++n)
+                    {
+                        db->getCategory(names[(n + offset) % names.size()]);
+                    } });
+            }
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+
+            state.PauseTiming();
+            db.reset();
+            state.ResumeTiming();
+        }
+        state.SetItemsProcessed(state.iterations() * names.size() * numThreads);
+    }
+
+    /**
+     * Resolve every startup category against a LoggerDB with state.range(0)
+     * glob level rules, most of which match some of the categories.
+     */
+    void BM_CreateWithLevelRules(benchmark::State &state)
+    {
+        const auto &names = getStartupNames();
+        const int numRules = state.range(0);
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            auto db = std::make_unique<LoggerDB>(LoggerDB::TESTING);
+            for (int n = 0; n < numRules; ++n)
+            {
+                auto service = "svc" + std::to_string(n % 8);
+                auto module = "module" + std::to_string(n % 50);
+                switch (n % 3)
+                {
+                case 0:
+                    db->addLevelRule(service + "." + module + ".*", LogLevel::DBG);
+                    break;
+                case 1:
+                    db->addLevelRule("*." + module + ".File" + std::to_string(n % 10),
+                                     LogLevel::INFO);
+                    break;
+                default:
+                    db->addLevelRule(service + ".**.rule" + std::to_string(n), LogLevel::WARN);
+                    break;
+                }
+            }
+            state.ResumeTiming();
+
+            for (const auto &name : names)
+            {
+                db->getCategory(name);
+            }
+
+            state.PauseTiming();
+            db.reset();
+            state.ResumeTiming();
+        }
+        state.SetItemsProcessed(state.iterations() * names.size());
+    }
+
+} // namespace
+
+BENCHMARK(BM_GetCategoryOrNull)->Threads(1)->Threads(4)->Threads(16);
+BENCHMARK(BM_GetCategoryOrNullNonCanonical)->Threads(1)->Threads(4)->Threads(16);
+BENCHMARK(BM_GetExistingCategory)->Threads(1)->Threads(4)->Threads(16);
+
+BENCHMARK(BM_ColdStart)
+    ->Arg(1)
+    ->Arg(8)
+    ->Arg(64)
+    ->Arg(256)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_CreateWithLevelRules)->Arg(0)->Arg(500)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LoggerDB.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "LogCategory.h"
+#include "LogLevel.h"
+
+using namespace tinylog;
+
+TEST(LoggerDB, getCategory)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    EXPECT_EQ(nullptr, db.getCategoryOrNull("foo.bar"));
+
+    auto *bar = db.getCategory("foo.bar");
+    EXPECT_EQ(StringPiece("foo.bar"), bar->getName());
+    EXPECT_EQ(bar, db.getCategory("/foo/bar/"));
+    EXPECT_EQ(bar, db.getCategoryOrNull("foo..bar"));
+
+    auto *foo = db.getCategoryOrNull("foo");
+    ASSERT_NE(nullptr, foo);
+    EXPECT_EQ(foo, bar->getParent());
+    EXPECT_EQ(db.getCategory(""), foo->getParent());
+}
+
+TEST(LoggerDB, concurrentCreation)
+{
+    // Many threads create overlapping parts of a category tree at once.
+    // Afterwards every category must have been linked into its parent's
+    // list of children, which level changes rely on to reach it.
+    LoggerDB db{LoggerDB::TESTING};
+    constexpr int kNumThreads = 8;
+    constexpr int kNumServices = 20;
+    constexpr int kNumModules = 30;
+
+    std::atomic<bool> start{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; ++t)
+    {
+        threads.emplace_back([&, t]
+                             {
+            while (!start.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+            for (int n = 0; n < kNumServices * kNumModules; ++n)
+            {
+                int idx = (n + t * 37) % (kNumServices * kNumModules);
+                db.getCategory(
+                    "svc" + std::to_string(idx / kNumModules) + ".mod" +
+                    std::to_string(idx % kNumModules) + ".impl");
+            } });
+    }
+    start.store(true, std::memory_order_release);
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    db.getCategory("")->setLevel(LogLevel::DBG);
+    for (int s = 0; s < kNumServices; ++s)
+    {
+        auto service = "svc" + std::to_string(s);
+        for (int m = 0; m < kNumModules; ++m)
+        {
+            auto *category = db.getCategoryOrNull(
+                service + ".mod" + std::to_string(m) + ".impl");
+            ASSERT_NE(nullptr, category);
+            EXPECT_EQ(LogLevel::DBG, category->getEffectiveLevel())
+                << category->getName().str();
+        }
+    }
+
+    db.setLevel("svc3", LogLevel::WARN, false);
+    EXPECT_EQ(LogLevel::WARN, db.getCategory("svc3.mod7.impl")->getEffectiveLevel());
+    EXPECT_EQ(LogLevel::DBG, db.getCategory("svc4.mod7.impl")->getEffectiveLevel());
+}
+
+TEST(LoggerDB, xlogInitDuringLevelChanges)
+{
+    // XLOG() levels registered while another thread changes levels must
+    // end up with the category's final effective level.
+    LoggerDB db{LoggerDB::TESTING};
+    constexpr int kNumCallsites = 200;
+    std::vector<std::atomic<LogLevel>> levels(kNumCallsites);
+    std::vector<LogCategory *> categories(kNumCallsites, nullptr);
+    for (auto &level : levels)
+    {
+        level.store(LogLevel::UNINITIALIZED);
+    }
+
+    std::thread setter([&]
+                       {
+        for (int n = 0; n < 100; ++n)
+        {
+            db.setLevel("app", n % 2 ? LogLevel::DBG : LogLevel::WARN);
+        }
+        db.setLevel("app", LogLevel::INFO); });
+    for (int n = 0; n < kNumCallsites; ++n)
+    {
+        auto name = "app.file" + std::to_string(n % 10) + ".cc";
+        db.xlogInit(name, &levels[n], &categories[n]);
+    }
+    setter.join();
+
+    for (int n = 0; n < kNumCallsites; ++n)
+    {
+        EXPECT_EQ(LogLevel::INFO, levels[n].load()) << n;
+        EXPECT_EQ(LogLevel::INFO, categories[n]->getEffectiveLevel());
+    }
+}
+
+TEST(LoggerDB, levelPropagation)
+{
+    // Level changes must reach every inheriting descendant, stop below
+    // categories that do not inherit, and give the same result whether or
+    // not they are spread across threads.
+    for (size_t numThreads : {1, 4})
+    {
+        LoggerDB db{LoggerDB::TESTING};
+        db.setLevelPropagationThreads(numThreads);
+        constexpr int kNumLeaves = 20000;
+        std::vector<std::atomic<LogLevel>> levels(kNumLeaves);
+        std::vector<LogCategory *> categories(kNumLeaves, nullptr);
+        for (int n = 0; n < kNumLeaves; ++n)
+        {
+            auto name = "svc" + std::to_string(n % 3) + ".file" + std::to_string(n);
+            db.xlogInit(name, &levels[n], &categories[n]);
+        }
+        db.setLevel("svc1", LogLevel::CRITICAL, false);
+        db.setLevel("svc2", LogLevel::ERROR);
+
+        db.setLevel("", LogLevel::DBG);
+        for (int n = 0; n < kNumLeaves; ++n)
+        {
+            auto expected = n % 3 == 1 ? LogLevel::CRITICAL : LogLevel::DBG;
+            EXPECT_EQ(expected, levels[n].load()) << numThreads << " " << n;
+            EXPECT_EQ(expected, categories[n]->getEffectiveLevel());
+        }
+
+        db.setLevel("", LogLevel::CRITICAL);
+        for (int n = 0; n < kNumLeaves; ++n)
+        {
+            auto expected = n % 3 == 2 ? LogLevel::ERROR : LogLevel::CRITICAL;
+            EXPECT_EQ(expected, levels[n].load()) << numThreads << " " << n;
+            EXPECT_EQ(expected, categories[n]->getEffectiveLevel());
+        }
+    }
+}
+
+TEST(LoggerDB, levelRules)
+{
+    LoggerDB db{LoggerDB::TESTING};
+    auto *existing = db.getCategory("rpc.foo.client");
+    auto *other = db.getCategory("rpc.foo.server");
+
+    db.addLevelRule("rpc.*.client", LogLevel::DBG);
+    db.addLevelRule("db.**", LogLevel::WARN, false);
+    EXPECT_EQ(LogLevel::DBG, existing->getLevel());
+    EXPECT_EQ(LogLevel::MAX_LEVEL, other->getLevel());
+
+    // Rules also apply to categories created later, including the parents
+    // created along with them.
+    std::atomic<LogLevel> xlogLevel{LogLevel::UNINITIALIZED};
+    LogCategory *xlogCategory = nullptr;
+    db.xlogInit("db.pool.conn", &xlogLevel, &xlogCategory);
+    EXPECT_EQ(LogLevel::WARN, xlogLevel.load());
+    EXPECT_EQ(LogLevel::WARN, xlogCategory->getLevelInfo().first);
+    EXPECT_FALSE(xlogCategory->getLevelInfo().second);
+    EXPECT_EQ(LogLevel::WARN, db.getCategory("db")->getLevel());
+    EXPECT_EQ(LogLevel::DBG, db.getCategory("rpc.bar.client")->getLevel());
+
+    // A later rule overrides an earlier one, and setLevel() overrides both.
+    db.addLevelRule("db.pool.*", LogLevel::ERROR, false);
+    EXPECT_EQ(LogLevel::ERROR, xlogLevel.load());
+    EXPECT_EQ(LogLevel::WARN, db.getCategory("db")->getLevel());
+    db.setLevel("db.pool.conn", LogLevel::INFO, false);
+    EXPECT_EQ(LogLevel::INFO, xlogLevel.load());
+}
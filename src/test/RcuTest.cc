@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Rcu.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace tinylog;
+
+namespace
+{
+    /**
+     * Sets a flag when it is destroyed.
+     */
+    struct Tracked
+    {
+        explicit Tracked(std::atomic<bool> &destroyed) : destroyed_{destroyed} {}
+        ~Tracked() { destroyed_ = true; }
+
+        std::atomic<bool> &destroyed_;
+    };
+
+} // namespace
+
+TEST(Rcu, retireWithoutReaders)
+{
+    RcuDomain domain;
+    std::atomic<bool> destroyed{false};
+    domain.retire(std::make_unique<Tracked>(destroyed));
+    EXPECT_FALSE(destroyed);
+    domain.synchronize();
+    EXPECT_TRUE(destroyed);
+}
+
+TEST(Rcu, synchronizeWaitsForReaders)
+{
+    RcuDomain domain;
+    std::atomic<bool> destroyed{false};
+    std::atomic<bool> readerStarted{false};
+    std::atomic<bool> releaseReader{false};
+
+    std::thread reader([&]
+                       {
+        RcuReader guard{domain};
+        // Read-side sections may nest.
+        RcuReader nested{domain};
+        readerStarted = true;
+        while (!releaseReader)
+        {
+            std::this_thread::yield();
+        } });
+    while (!readerStarted)
+    {
+        std::this_thread::yield();
+    }
+
+    domain.retire(std::make_unique<Tracked>(destroyed));
+    std::thread writer([&]
+                       { domain.synchronize(); });
+
+    // The reader started before synchronize(), so nothing may be freed
+    // until it finishes.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(destroyed);
+
+    releaseReader = true;
+    reader.join();
+    writer.join();
+    EXPECT_TRUE(destroyed);
+}
+
+TEST(Rcu, publishAndRetire)
+{
+    // Readers dereference the current object while a writer keeps replacing
+    // it.  ASAN and TSAN check that nothing is freed while in use.
+    RcuDomain domain;
+    std::atomic<const std::vector<int> *> current{new std::vector<int>(16, 0)};
+    std::atomic<bool> done{false};
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t)
+    {
+        readers.emplace_back([&]
+                             {
+            while (!done.load(std::memory_order_relaxed))
+            {
+                RcuReader guard{domain};
+                const auto *values = current.load(std::memory_order_seq_cst);
+                int first = (*values)[0];
+                for (int value : *values)
+                {
+                    EXPECT_EQ(first, value);
+                }
+            } });
+    }
+
+    for (int n = 1; n <= 200; ++n)
+    {
+        std::unique_ptr<const std::vector<int>> old{
+            current.exchange(new std::vector<int>(16, n))};
+        domain.retire(std::move(old));
+        domain.synchronize();
+    }
+    done = true;
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+    delete current.load();
+}
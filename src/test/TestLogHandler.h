@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "LogCategory.h"
+#include "LogHandler.h"
+#include "LogHandlerConfig.h"
+#include "LogMessage.h"
+
+namespace tinylog
+{
+    namespace test
+    {
+        /**
+         * A LogHandler that records the messages it receives, for tests to
+         * inspect.  It is safe to log to from multiple threads.
+         */
+        class RecordingHandler : public LogHandler
+        {
+        public:
+            void handleMessage(
+                const LogMessage &message, const LogCategory * /* handlerCategory */) override
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                messages_.push_back(message.getRawMessage().str());
+                categories_.push_back(message.getCategory());
+                functions_.push_back(message.getFunctionName().str());
+            }
+
+            void flush() override {}
+
+            LogHandlerConfig getConfig() const override
+            {
+                return LogHandlerConfig{"recording"};
+            }
+
+            /**
+             * Get the raw text of each message received so far.
+             */
+            std::vector<std::string> getMessages()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return messages_;
+            }
+
+            /**
+             * Get the category each message was logged to.
+             */
+            std::vector<const LogCategory *> getCategories()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return categories_;
+            }
+
+            /**
+             * Get the name of the function that logged each message.
+             */
+            std::vector<std::string> getFunctions()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return functions_;
+            }
+
+        private:
+            std::mutex mutex_;
+            std::vector<std::string> messages_;
+            std::vector<const LogCategory *> categories_;
+            std::vector<std::string> functions_;
+        };
+
+    } // namespace test
+} // namespace tinylog
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ThreadLocalPool.h"
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace tinylog;
+
+namespace
+{
+    std::atomic<int> numLive{0};
+    std::atomic<int> numResets{0};
+    std::atomic<bool> acquiredAfterExit{false};
+
+    struct Counted
+    {
+        Counted() { ++numLive; }
+        ~Counted() { --numLive; }
+    };
+
+    constexpr size_t kPoolSize = 3;
+    using CountedPool = detail::ThreadLocalPool<Counted, kPoolSize>;
+
+    void resetCounted(Counted &)
+    {
+        ++numResets;
+    }
+
+    /**
+     * Holds an object until this thread_local is destroyed.  It is
+     * constructed before the thread first uses the pool, so it is destroyed
+     * after the pool has been freed.
+     */
+    struct LateReleaser
+    {
+        ~LateReleaser()
+        {
+            if (held)
+            {
+                CountedPool::release(held, resetCounted);
+            }
+            acquiredAfterExit = CountedPool::tryAcquire() != nullptr;
+        }
+
+        Counted *held{nullptr};
+    };
+
+} // namespace
+
+TEST(ThreadLocalPool, acquireAndRelease)
+{
+    std::thread thread{[]
+                       {
+        std::set<Counted *> acquired;
+        for (size_t n = 0; n < kPoolSize; ++n)
+        {
+            auto *object = CountedPool::tryAcquire();
+            ASSERT_NE(nullptr, object);
+            acquired.insert(object);
+        }
+        EXPECT_EQ(kPoolSize, acquired.size());
+        EXPECT_EQ(nullptr, CountedPool::tryAcquire());
+
+        auto *object = *acquired.begin();
+        int resets = numResets.load();
+        CountedPool::release(object, resetCounted);
+        EXPECT_EQ(resets + 1, numResets.load());
+        EXPECT_EQ(object, CountedPool::tryAcquire()); }};
+    thread.join();
+}
+
+TEST(ThreadLocalPool, perThread)
+{
+    Counted *first = CountedPool::tryAcquire();
+    ASSERT_NE(nullptr, first);
+    Counted *other = nullptr;
+    std::thread thread{[&]
+                       {
+        other = CountedPool::tryAcquire();
+        CountedPool::release(other, resetCounted); }};
+    thread.join();
+    EXPECT_NE(nullptr, other);
+    EXPECT_NE(first, other);
+    CountedPool::release(first, resetCounted);
+}
+
+TEST(ThreadLocalPool, releaseAfterThreadExit)
+{
+    int live = numLive.load();
+    int resets = numResets.load();
+    std::thread thread{[]
+                       {
+        static thread_local LateReleaser late;
+        late.held = CountedPool::tryAcquire();
+        EXPECT_NE(nullptr, late.held); }};
+    thread.join();
+
+    // The pool was freed before LateReleaser ran, so release() must not
+    // reset the destroyed object, and the pool is not recreated.
+    EXPECT_EQ(live, numLive.load());
+    EXPECT_EQ(resets, numResets.load());
+    EXPECT_FALSE(acquiredAfterExit.load());
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "xlog.h"
+
+namespace tinylog
+{
+    namespace test
+    {
+        /**
+         * XLOG() statements in a header file log to the header's category,
+         * not that of the source file including it.
+         */
+        inline void xlogFromHeader(int n)
+        {
+            XLOG(INFO, "header ", n);
+        }
+
+        inline tinylog::StringPiece xlogHeaderFileName()
+        {
+            return __FILE__;
+        }
+
+    } // namespace test
+} // namespace tinylog
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Strip every XLOG() statement below INFO from this file.
+#define TINYLOG_MIN_LEVEL INFO
+
+#include "xlog.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "LogCategory.h"
+#include "LoggerDB.h"
+#include "src/test/TestLogHandler.h"
+
+using namespace tinylog;
+
+namespace
+{
+    using test::RecordingHandler;
+
+    /**
+     * Log one statement below and one at the minimum level.
+     *
+     * The messages are the strings the test looks for in the binary.
+     */
+    void logMarkers(int n)
+    {
+        XLOG(DBG, "tinylog-stripped-xlog-marker ", n);
+        XLOGF(DBG, "tinylog-stripped-xlogf-marker {}", n);
+        XLOG(INFO, "tinylog-kept-xlog-marker ", n);
+    }
+
+    /**
+     * Build a marker string at runtime, so this test's own copy of it does
+     * not end up in the binary.
+     */
+    std::string marker(std::string reversed)
+    {
+        std::reverse(reversed.begin(), reversed.end());
+        return reversed;
+    }
+
+    std::string readOwnBinary()
+    {
+        std::ifstream file("/proc/self/exe", std::ios::binary);
+        return std::string(
+            std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+} // namespace
+
+static_assert(kMinCompiledLogLevel == LogLevel::INFO, "");
+static_assert(!isLogLevelCompiledIn(LogLevel::DBG, kMinCompiledLogLevel), "");
+static_assert(isLogLevelCompiledIn(LogLevel::INFO, kMinCompiledLogLevel), "");
+static_assert(isLogLevelCompiledIn(LogLevel::FATAL, kMinCompiledLogLevel), "");
+
+TEST(XlogMinLevel, strippedStatementsDoNotLog)
+{
+    auto *category = LoggerDB::get().getCategory(__FILE__);
+    auto handler = std::make_shared<RecordingHandler>();
+    category->addHandler(handler);
+
+    // Even when DBG is enabled at runtime, the stripped statements are gone.
+    category->setLevel(LogLevel::DBG);
+    EXPECT_FALSE(XLOG_IS_ON(DBG));
+    EXPECT_TRUE(XLOG_IS_ON(INFO));
+
+    int evaluated = 0;
+    XLOG(DBG, "stripped ", ++evaluated);
+    logMarkers(1);
+    EXPECT_EQ(0, evaluated);
+    EXPECT_EQ(
+        (std::vector<std::string>{"tinylog-kept-xlog-marker 1"}), handler->getMessages());
+
+    category->clearHandlers();
+    category->setLevel(LogLevel::MAX_LEVEL);
+}
+
+TEST(XlogMinLevel, strippedStringsAreNotInBinary)
+{
+    auto binary = readOwnBinary();
+    ASSERT_FALSE(binary.empty());
+
+    // The kept statement's string is there, which shows the search works.
+    EXPECT_NE(std::string::npos, binary.find(marker("rekram-golx-tpek-golynit")));
+    EXPECT_EQ(std::string::npos, binary.find(marker("rekram-golx-deppirts-golynit")));
+    EXPECT_EQ(std::string::npos, binary.find(marker("rekram-fgolx-deppirts-golynit")));
+}
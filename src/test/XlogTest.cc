@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "xlog.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "LogCategory.h"
+#include "LogName.h"
+#include "LoggerDB.h"
+#include "src/test/TestLogHandler.h"
+#include "src/test/XlogHeader.h"
+
+using namespace tinylog;
+
+namespace
+{
+    using test::RecordingHandler;
+
+    /**
+     * Attach a RecordingHandler to this file's XLOG() category for the
+     * duration of a test.
+     */
+    class XlogTest : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            category_ = LoggerDB::get().getCategory(__FILE__);
+            category_->setLevel(LogLevel::INFO);
+            handler_ = std::make_shared<RecordingHandler>();
+            category_->addHandler(handler_);
+        }
+
+        void TearDown() override
+        {
+            category_->clearHandlers();
+            category_->setLevel(LogLevel::MAX_LEVEL);
+        }
+
+        LogCategory *category_{nullptr};
+        std::shared_ptr<RecordingHandler> handler_;
+    };
+
+    void logDebugAndInfo(int n)
+    {
+        XLOG(DBG, "dbg ", n);
+        XLOG(INFO, "info ", n);
+    }
+
+} // namespace
+
+TEST_F(XlogTest, log)
+{
+    XLOG(INFO, "x=", 5, ", y=", 1.5);
+    XLOG(WARN) << "streamed " << 7;
+    XLOG(ERROR, "mixed ", 1) << " and " << 2;
+    XLOGF(INFO, "formatted {} and {}", 3, "text");
+    XLOGF(INFO, "no arguments");
+
+    EXPECT_EQ(
+        (std::vector<std::string>{
+            "x=5, y=1.5",
+            "streamed 7",
+            "mixed 1 and 2",
+            "formatted 3 and text",
+            "no arguments",
+        }),
+        handler_->getMessages());
+
+    // Every statement logs to the category named after this file, with the
+    // calling function's name.
+    for (auto *category : handler_->getCategories())
+    {
+        EXPECT_EQ(category_, category);
+    }
+    EXPECT_EQ(LogName::canonicalize(__FILE__), category_->getName().str());
+    EXPECT_EQ("TestBody", handler_->getFunctions()[0]);
+}
+
+TEST_F(XlogTest, categoryName)
+{
+    // The category name is canonicalized and hashed at compile time.
+    constexpr auto &fileCategory = xlog_detail::xlogFileCategory;
+    static_assert(fileCategory.getHash() == LogName::hash(__FILE__), "");
+    EXPECT_EQ(LogName::canonicalize(__FILE__), fileCategory.getName().str());
+
+    XLOG(INFO, "from source");
+    test::xlogFromHeader(1);
+
+    auto *headerCategory = LoggerDB::get().getCategoryOrNull(test::xlogHeaderFileName());
+    ASSERT_NE(nullptr, headerCategory);
+    EXPECT_EQ(
+        LogName::canonicalize(test::xlogHeaderFileName()), headerCategory->getName().str());
+
+    // The header category is not a child of this file's category, so only
+    // the first message reached our handler.
+    EXPECT_EQ((std::vector<std::string>{"from source"}), handler_->getMessages());
+}
+
+TEST(XlogCategoryName, canonicalStorage)
+{
+    constexpr StringPiece filename{"/src/foo//bar.h"};
+    static constexpr XlogCategoryName<LogName::canonicalSize(filename)> name{
+        filename};
+    static_assert(name.getName().size() == 13, "stores only the canonical name");
+    EXPECT_EQ(StringPiece("src.foo.bar.h"), name.getName());
+    EXPECT_EQ(LogName::hash(filename), name.getHash());
+}
+
+TEST_F(XlogTest, disabledArgumentsAreNotEvaluated)
+{
+    int evaluated = 0;
+    auto sideEffect = [&]
+    {
+        ++evaluated;
+        return 1;
+    };
+
+    XLOG(DBG, "value ", sideEffect());
+    XLOG(DBG) << sideEffect();
+    XLOGF(DBG, "{}", sideEffect());
+    XLOG_IF(INFO, sideEffect() == 0, "not logged");
+    EXPECT_EQ(1, evaluated);
+
+    XLOG_IF(DBG, sideEffect() == 1, "not logged");
+    EXPECT_EQ(1, evaluated);
+
+    XLOG_IF(INFO, sideEffect() == 1, "logged");
+    XLOGF_IF(INFO, true, "logged {}", 2);
+    EXPECT_EQ(2, evaluated);
+    EXPECT_EQ(
+        (std::vector<std::string>{"logged", "logged 2"}), handler_->getMessages());
+}
+
+TEST_F(XlogTest, levelChanges)
+{
+    logDebugAndInfo(1);
+    EXPECT_TRUE(XLOG_IS_ON(INFO));
+    EXPECT_FALSE(XLOG_IS_ON(DBG));
+
+    // Statements that have already cached the category level see the change.
+    category_->setLevel(LogLevel::DBG);
+    logDebugAndInfo(2);
+    EXPECT_TRUE(XLOG_IS_ON(DBG));
+
+    // So do statements whose level is inherited from a parent category.
+    LoggerDB::get().setLevel(category_->getName(), LogLevel::MAX_LEVEL, true);
+    auto *parent = LoggerDB::get().getCategory(LogName::getParent(category_->getName()));
+    parent->setLevel(LogLevel::WARN);
+    logDebugAndInfo(3);
+    EXPECT_FALSE(XLOG_IS_ON(INFO));
+    parent->setLevel(LogLevel::MAX_LEVEL);
+    category_->setLevel(LogLevel::INFO);
+    logDebugAndInfo(4);
+
+    EXPECT_EQ(
+        (std::vector<std::string>{"info 1", "dbg 2", "info 2", "info 4"}),
+        handler_->getMessages());
+}
+
+TEST_F(XlogTest, unbracedIfElse)
+{
+    for (int n = 0; n < 2; ++n)
+    {
+        if (n == 0)
+            XLOG(INFO, "then");
+        else
+            XLOG(INFO, "else");
+    }
+    EXPECT_EQ((std::vector<std::string>{"then", "else"}), handler_->getMessages());
+}
+
+TEST_F(XlogTest, threads)
+{
+    // All threads race to initialize the same callsites.
+    constexpr int kNumThreads = 8;
+    constexpr int kNumMessages = 100;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; ++t)
+    {
+        threads.emplace_back([]
+                             {
+            for (int n = 0; n < kNumMessages; ++n)
+            {
+                XLOG(INFO, "thread message");
+                XLOG(DBG, "debug message");
+            } });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    auto messages = handler_->getMessages();
+    EXPECT_EQ(kNumThreads * kNumMessages, messages.size());
+    for (const auto &msg : messages)
+    {
+        EXPECT_EQ("thread message", msg);
+    }
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * tinylog-decode converts log files written with BinaryLogFormatter to text.
+ *
+ * Usage: tinylog-decode [FILE...]
+ *
+ * Reads standard input if no files are given, and writes one line per log
+ * message to standard output.
+ */
+
+#include <cstdio>
+#include <exception>
+#include <string>
+
+#include "BinaryLogFormat.h"
+
+namespace
+{
+    bool decodeFile(FILE *input, const char *name)
+    {
+        tinylog::BinaryLogDecoder decoder{[](const tinylog::DecodedLogRecord &record)
+                                          {
+            auto line = tinylog::BinaryLogDecoder::formatRecord(record);
+            fwrite(line.data(), 1, line.size(), stdout); }};
+
+        std::string buffer(64 * 1024, '\0');
+        try
+        {
+            while (true)
+            {
+                auto bytesRead = fread(&buffer[0], 1, buffer.size(), input);
+                if (bytesRead == 0)
+                {
+                    break;
+                }
+                decoder.feed(tinylog::StringPiece(buffer.data(), bytesRead));
+            }
+            if (ferror(input))
+            {
+                fprintf(stderr, "tinylog-decode: error reading %s\n", name);
+                return false;
+            }
+            decoder.finish();
+        }
+        catch (const std::exception &ex)
+        {
+            fprintf(stderr, "tinylog-decode: %s: %s\n", name, ex.what());
+            return false;
+        }
+        return true;
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return decodeFile(stdin, "<stdin>") ? 0 : 1;
+    }
+
+    int status = 0;
+    for (int idx = 1; idx < argc; ++idx)
+    {
+        FILE *input = fopen(argv[idx], "rb");
+        if (input == nullptr)
+        {
+            perror(argv[idx]);
+            status = 1;
+            continue;
+        }
+        if (!decodeFile(input, argv[idx]))
+        {
+            status = 1;
+        }
+        fclose(input);
+    }
+    return status;
+}
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "xlog.h"
+
+#include "LoggerDB.h"
+
+namespace tinylog
+{
+    bool XlogCallsite::initSlow(LogLevel level)
+    {
+        auto categoryLevel = LoggerDB::get().xlogInit(
+            callsite_.getCategoryName(), categoryHash_, &level_, &category_);
+        return level >= categoryLevel;
+    }
+
+} // namespace tinylog